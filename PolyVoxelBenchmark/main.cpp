@@ -0,0 +1,490 @@
+#include "Chunk.h"
+#include "World.h"
+#include "TerrainGenerator.h"
+#include "LightingEngine.h"
+#include "ThreadPool.h"
+#include "Profiler.h"
+#include "ChunkLifecycle.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Headless chunk pipeline benchmark.
+// Drives generation, lighting and meshing over a fixed seed and a fixed set of chunk coordinates.
+// With --world-ticks whole World streams chunks around origin instead, without mesh consumer.
+// With --verify-mesher meshes of binary and classic mesher are compared before timing, exit code is 1 when they differ.
+// No window, GL context, FaceInstancesVBO or TextureArray is created.
+
+enum StageIndex : size_t
+{
+	GENERATE_BLOCKS_STAGE,
+	LIGHTING_UPDATES_STAGE,
+	DARKNESS_FLOOD_FILL_STAGE,
+	LIGHTING_FLOOD_FILL_STAGE,
+	FETCH_FACES_STAGE,
+	GREEDY_MESHING_STAGE,
+	STAGES_COUNT
+};
+
+const char* stageNames[STAGES_COUNT] =
+{
+	"GenerateBlocks",
+	"LightingUpdates",
+	"DarknessFloodFill",
+	"LightingFloodFill",
+	"FetchFaces",
+	"GreedyMeshing"
+};
+
+struct BenchmarkSettings
+{
+	unsigned int seed = 1337;
+	int radius = 6;
+	int minY = -2;
+	int maxY = 12;
+	bool binaryGreedyMeshing = true;
+	int caveNoiseLatticeStep = Settings::DynamicSettings::caveNoiseLatticeStep;
+	size_t lightingThreads = ThreadPool::getDefaultThreadCount(); // 0 runs flood fills on main thread only
+	std::string csvPath = "";
+	std::string tracePath = "";
+	int worldTicks = 0; // World updates of world benchmark, 0 runs chunk stages
+	bool verifyMesher = false;
+};
+
+struct StageResult
+{
+	size_t samplesCount = 0;
+	uint64_t meanNS = 0;
+	uint64_t p50NS = 0;
+	uint64_t p99NS = 0;
+	uint64_t maxNS = 0;
+};
+
+template<typename TCallback>
+static uint64_t measure(TCallback&& callback)
+{
+	auto start = std::chrono::steady_clock::now();
+	callback();
+	auto end = std::chrono::steady_clock::now();
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+}
+
+static uint64_t percentile(const std::vector<uint64_t>& sortedSamples, double p)
+{
+	if (sortedSamples.empty())
+	{
+		return 0;
+	}
+	size_t index = (size_t)(p * (double)(sortedSamples.size() - 1) + 0.5);
+	return sortedSamples[index];
+}
+
+static StageResult calculateStageResult(std::vector<uint64_t>& samples)
+{
+	StageResult result;
+	result.samplesCount = samples.size();
+	if (samples.empty())
+	{
+		return result;
+	}
+
+	std::sort(samples.begin(), samples.end());
+
+	uint64_t sum = 0;
+	for (uint64_t sample : samples)
+	{
+		sum += sample;
+	}
+	result.meanNS = sum / samples.size();
+	result.p50NS = percentile(samples, 0.5);
+	result.p99NS = percentile(samples, 0.99);
+	result.maxNS = samples.back();
+	return result;
+}
+
+// meshes every chunk with both meshers through Chunk::generateMesh, faces counts and face instances must match byte for byte
+// returns count of chunks with different meshes
+static size_t verifyMeshers(const std::vector<Chunk*>& chunks)
+{
+	bool binaryGreedyMeshing = Settings::DynamicSettings::binaryGreedyMeshing;
+
+	ChunkMesh binaryMesh;
+	ChunkMesh classicMesh;
+	size_t mismatchesCount = 0;
+	for (Chunk* chunk : chunks)
+	{
+		Settings::DynamicSettings::binaryGreedyMeshing = true;
+		chunk->generateMesh(binaryMesh, nullptr);
+		Settings::DynamicSettings::binaryGreedyMeshing = false;
+		chunk->generateMesh(classicMesh, nullptr);
+
+		bool sameCounts = memcmp(binaryMesh.drawCommand.facesCount, classicMesh.drawCommand.facesCount, sizeof(binaryMesh.drawCommand.facesCount)) == 0;
+		bool sameFaces = binaryMesh.faceInstances.size() == classicMesh.faceInstances.size() &&
+			memcmp(binaryMesh.faceInstances.data(), classicMesh.faceInstances.data(), binaryMesh.faceInstances.size() * sizeof(FaceInstanceData)) == 0;
+		if (sameCounts && sameFaces)
+		{
+			continue;
+		}
+
+		if (mismatchesCount < 10)
+		{
+			std::cerr << "Meshes differ in chunk " << chunk->X << " " << chunk->Y << " " << chunk->Z
+				<< ", faces binary: " << binaryMesh.drawCommand.getFacesCount()
+				<< ", classic: " << classicMesh.drawCommand.getFacesCount() << std::endl;
+		}
+		mismatchesCount++;
+	}
+
+	Settings::DynamicSettings::binaryGreedyMeshing = binaryGreedyMeshing;
+	return mismatchesCount;
+}
+
+static bool parseArguments(int argc, char** argv, BenchmarkSettings& settings)
+{
+	for (int i = 1; i < argc; i++)
+	{
+		std::string arg = argv[i];
+		if (arg == "--verify-mesher")
+		{
+			settings.verifyMesher = true;
+			continue;
+		}
+		if (i + 1 >= argc)
+		{
+			std::cerr << "Missing value for argument: " << arg << std::endl;
+			return false;
+		}
+		std::string value = argv[++i];
+
+		// stoi and stoul throw on values that aren't numbers or don't fit
+		try
+		{
+			if (arg == "--seed")
+			{
+				settings.seed = (unsigned int)std::stoul(value);
+			}
+			else if (arg == "--radius")
+			{
+				settings.radius = std::stoi(value);
+			}
+			else if (arg == "--min-y")
+			{
+				settings.minY = std::stoi(value);
+			}
+			else if (arg == "--max-y")
+			{
+				settings.maxY = std::stoi(value);
+			}
+			else if (arg == "--mesher")
+			{
+				if (value == "binary")
+				{
+					settings.binaryGreedyMeshing = true;
+				}
+				else if (value == "classic")
+				{
+					settings.binaryGreedyMeshing = false;
+				}
+				else
+				{
+					std::cerr << "Unknown mesher: " << value << std::endl;
+					return false;
+				}
+			}
+			else if (arg == "--cave-step")
+			{
+				settings.caveNoiseLatticeStep = std::stoi(value);
+			}
+			else if (arg == "--lighting-threads")
+			{
+				settings.lightingThreads = (size_t)std::stoul(value);
+			}
+			else if (arg == "--csv")
+			{
+				settings.csvPath = value;
+			}
+			else if (arg == "--trace")
+			{
+				settings.tracePath = value;
+			}
+			else if (arg == "--world-ticks")
+			{
+				settings.worldTicks = std::stoi(value);
+			}
+			else
+			{
+				std::cerr << "Unknown argument: " << arg << std::endl;
+				return false;
+			}
+		}
+		catch (const std::exception&)
+		{
+			std::cerr << "Invalid value for argument " << arg << ": " << value << std::endl;
+			return false;
+		}
+	}
+	return true;
+}
+
+// World::update back to back at fixed position, like dedicated server without players moving
+// saved chunk changes and sky light height maps are neither loaded nor saved
+static int runWorldBenchmark(const BenchmarkSettings& settings)
+{
+	Settings::DynamicSettings::binaryGreedyMeshing = settings.binaryGreedyMeshing;
+	Settings::DynamicSettings::caveNoiseLatticeStep = settings.caveNoiseLatticeStep;
+
+	WorldData worldData;
+	worldData.seed = settings.seed; // player position at origin, height is found by worldDataGetPlayerY
+
+	std::vector<uint64_t> tickSamples;
+	tickSamples.reserve(settings.worldTicks);
+	uint64_t totalNS = 0;
+	{
+		World world(worldData);
+		World::worldDataGetPlayerY(worldData);
+		totalNS = measure([&]()
+			{
+				for (int tick = 0; tick < settings.worldTicks; tick++)
+				{
+					tickSamples.push_back(measure([&]() { world.update(worldData.playerPosition, false); }));
+				}
+			}
+		);
+	}
+	StageResult result = calculateStageResult(tickSamples);
+
+	std::cout << "Mesher: " << (settings.binaryGreedyMeshing ? "binary" : "classic") << ", cave noise step: " << settings.caveNoiseLatticeStep << std::endl;
+	std::cout << "Seed: " << settings.seed << ", world ticks: " << settings.worldTicks << ", total ms: " << totalNS / 1000000 << std::endl;
+	std::cout << std::left << std::setw(20) << "Stage"
+		<< std::right << std::setw(10) << "Samples"
+		<< std::setw(14) << "mean ns"
+		<< std::setw(14) << "p50 ns"
+		<< std::setw(14) << "p99 ns"
+		<< std::setw(14) << "max ns" << std::endl;
+	std::cout << std::left << std::setw(20) << "WorldTick"
+		<< std::right << std::setw(10) << result.samplesCount
+		<< std::setw(14) << result.meanNS
+		<< std::setw(14) << result.p50NS
+		<< std::setw(14) << result.p99NS
+		<< std::setw(14) << result.maxNS << std::endl;
+	ChunkLifecycle::report(std::cout);
+
+	if (!settings.csvPath.empty())
+	{
+		std::ofstream file(settings.csvPath, std::ios::trunc);
+		if (!file.is_open())
+		{
+			std::cerr << "Failed to open benchmark csv file" << std::endl;
+		}
+		else
+		{
+			file << "stage,samples,mean_ns,p50_ns,p99_ns,max_ns" << std::endl;
+			file << "WorldTick," << result.samplesCount << "," << result.meanNS << "," << result.p50NS << "," << result.p99NS << "," << result.maxNS << std::endl;
+		}
+	}
+
+	if (!settings.tracePath.empty())
+	{
+		Profiler::exportChromeTrace(settings.tracePath);
+	}
+	return 0;
+}
+
+int main(int argc, char** argv)
+{
+	Profiler::setThreadName("Main");
+
+	BenchmarkSettings settings;
+	if (!parseArguments(argc, argv, settings))
+	{
+		std::cerr << "Usage: PolyVoxelBenchmark [--seed N] [--radius N] [--min-y N] [--max-y N] [--mesher binary|classic] [--cave-step N] [--lighting-threads N] [--csv path] [--trace path] [--world-ticks N] [--verify-mesher]" << std::endl;
+		return 1;
+	}
+
+	// same terrain on every run, nothing is read from or written to world directory
+	Settings::DynamicSettings::chunkPersistence = false;
+
+	if (settings.worldTicks > 0)
+	{
+		return runWorldBenchmark(settings);
+	}
+
+	TerrainGenerator::init();
+	TerrainGenerator::seed = settings.seed;
+	Settings::DynamicSettings::binaryGreedyMeshing = settings.binaryGreedyMeshing;
+	Settings::DynamicSettings::caveNoiseLatticeStep = settings.caveNoiseLatticeStep;
+
+	Chunk::allocateMeshingBuffers();
+
+	std::unique_ptr<ThreadPool> lightingPool;
+	if (settings.lightingThreads > 0)
+	{
+		lightingPool = std::make_unique<ThreadPool>(settings.lightingThreads);
+		LightingEngine::setThreadPool(lightingPool.get());
+	}
+	Chunk::chunkMap.init(std::max(settings.radius, (settings.maxY - settings.minY + 1) / 2));
+
+	// fixed list of chunks
+	std::vector<glm::ivec2> columns;
+	for (int x = -settings.radius; x <= settings.radius; x++)
+	{
+		for (int z = -settings.radius; z <= settings.radius; z++)
+		{
+			columns.emplace_back(x, z);
+		}
+	}
+	TerrainGenerator::loadHeightMaps(columns.data(), columns.size());
+
+	std::vector<Chunk*> chunks;
+	for (int x = -settings.radius; x <= settings.radius; x++)
+	{
+		for (int z = -settings.radius; z <= settings.radius; z++)
+		{
+			for (int y = settings.minY; y <= settings.maxY; y++)
+			{
+				Chunk* chunk = new Chunk();
+				chunk->init(x, y, z);
+				chunk->state = Chunk::State::InLoadingQueue;
+				chunks.push_back(chunk);
+			}
+		}
+	}
+
+	std::vector<uint64_t> samples[STAGES_COUNT];
+	for (auto& stageSamples : samples)
+	{
+		stageSamples.reserve(chunks.size());
+	}
+
+	// generation and lighting, like World::update does it for each loaded chunk
+	for (Chunk* chunk : chunks)
+	{
+		samples[GENERATE_BLOCKS_STAGE].push_back(measure([chunk]() { chunk->generateBlocks(); }));
+		samples[LIGHTING_UPDATES_STAGE].push_back(measure([]() { World::applyLightingUpdates(); }));
+		samples[DARKNESS_FLOOD_FILL_STAGE].push_back(measure([]() { LightingEngine::propagateDarkness(); }));
+		samples[LIGHTING_FLOOD_FILL_STAGE].push_back(measure([]() { LightingEngine::propagateLighting(); }));
+	}
+
+	// resident block and lighting storage after lighting settled
+	size_t storageSize = 0;
+	for (Chunk* chunk : chunks)
+	{
+		storageSize += chunk->getAllocatedStorageSize();
+	}
+
+	int exitCode = 0;
+	if (settings.verifyMesher)
+	{
+		size_t mismatchesCount = verifyMeshers(chunks);
+		std::cout << "Mesher verification: " << (chunks.size() - mismatchesCount) << " of " << chunks.size() << " chunks have identical meshes" << std::endl;
+		if (mismatchesCount > 0)
+		{
+			exitCode = 1;
+		}
+	}
+
+	// meshing, skipping the same chunks as Chunk::generateMesh
+	size_t meshedChunksCount = 0;
+	uint64_t facesCount = 0;
+	const Chunk* lockedChunks[27];
+	for (Chunk* chunk : chunks)
+	{
+		chunk->drawCommand.resetFaces();
+		if (chunk->blocksCount == 0)
+		{
+			continue;
+		}
+
+		size_t lockedChunksCount = chunk->lockSurroundingStorages(lockedChunks);
+		if (chunk->isChunkClosed())
+		{
+			Chunk::unlockStorages(lockedChunks, lockedChunksCount);
+			continue;
+		}
+
+		if (settings.binaryGreedyMeshing)
+		{
+			samples[FETCH_FACES_STAGE].push_back(measure([chunk]() { chunk->fetchFacesBinary(); }));
+			samples[GREEDY_MESHING_STAGE].push_back(measure([chunk]() { chunk->binaryGreedyMeshing(chunk->drawCommand.facesCount); }));
+		}
+		else
+		{
+			samples[FETCH_FACES_STAGE].push_back(measure([chunk]() { chunk->fetchFaces(); }));
+			samples[GREEDY_MESHING_STAGE].push_back(measure([chunk]() { chunk->greedyMeshing(chunk->drawCommand.facesCount); }));
+		}
+		Chunk::unlockStorages(lockedChunks, lockedChunksCount);
+
+		meshedChunksCount++;
+		facesCount += chunk->drawCommand.getFacesCount();
+	}
+
+	// report
+	StageResult results[STAGES_COUNT];
+	for (size_t i = 0; i < STAGES_COUNT; i++)
+	{
+		results[i] = calculateStageResult(samples[i]);
+	}
+
+	std::cout << "Mesher: " << (settings.binaryGreedyMeshing ? "binary" : "classic") << ", cave noise step: " << settings.caveNoiseLatticeStep << ", lighting threads: " << settings.lightingThreads << std::endl;
+	std::cout << "Seed: " << settings.seed << ", chunks: " << chunks.size() << ", meshed chunks: " << meshedChunksCount << std::endl;
+	std::cout << "Faces/chunk: " << (meshedChunksCount > 0 ? (double)facesCount / (double)meshedChunksCount : 0.0) << std::endl;
+	std::cout << "Storage bytes/chunk: " << (chunks.empty() ? 0.0 : (double)storageSize / (double)chunks.size()) << std::endl;
+	std::cout << std::left << std::setw(20) << "Stage"
+		<< std::right << std::setw(10) << "Samples"
+		<< std::setw(14) << "ns/chunk"
+		<< std::setw(14) << "p50 ns"
+		<< std::setw(14) << "p99 ns"
+		<< std::setw(14) << "max ns" << std::endl;
+	for (size_t i = 0; i < STAGES_COUNT; i++)
+	{
+		const StageResult& result = results[i];
+		std::cout << std::left << std::setw(20) << stageNames[i]
+			<< std::right << std::setw(10) << result.samplesCount
+			<< std::setw(14) << result.meanNS
+			<< std::setw(14) << result.p50NS
+			<< std::setw(14) << result.p99NS
+			<< std::setw(14) << result.maxNS << std::endl;
+	}
+
+	if (!settings.csvPath.empty())
+	{
+		std::ofstream file(settings.csvPath, std::ios::trunc);
+		if (!file.is_open())
+		{
+			std::cerr << "Failed to open benchmark csv file" << std::endl;
+		}
+		else
+		{
+			file << "stage,samples,mean_ns,p50_ns,p99_ns,max_ns" << std::endl;
+			for (size_t i = 0; i < STAGES_COUNT; i++)
+			{
+				const StageResult& result = results[i];
+				file << stageNames[i] << "," << result.samplesCount << "," << result.meanNS << "," << result.p50NS << "," << result.p99NS << "," << result.maxNS << std::endl;
+			}
+			file << "faces_per_chunk," << meshedChunksCount << "," << (meshedChunksCount > 0 ? facesCount / meshedChunksCount : 0) << ",,," << std::endl;
+			file << "storage_bytes_per_chunk," << chunks.size() << "," << (chunks.empty() ? 0 : storageSize / chunks.size()) << ",,," << std::endl;
+		}
+	}
+
+	if (!settings.tracePath.empty())
+	{
+		Profiler::exportChromeTrace(settings.tracePath);
+	}
+
+	LightingEngine::setThreadPool(nullptr);
+	lightingPool.reset();
+
+	TerrainGenerator::clear();
+	for (Chunk* chunk : chunks)
+	{
+		delete chunk;
+	}
+	Chunk::chunkMap.clear();
+	return exitCode;
+}
@@ -73,6 +73,16 @@ bool Camera::isOnFrustum(const Box& shape) const
 	);
 }
 
+void Camera::getFrustumPlanes(glm::vec4* planes) const
+{
+	const Plane* frustumPlanes[6] = { &frustum.near, &frustum.far, &frustum.right, &frustum.left, &frustum.top, &frustum.bottom };
+	for (size_t i = 0; i < 6; i++)
+	{
+		const Plane& plane = *frustumPlanes[i];
+		planes[i] = glm::vec4(plane.normal, -glm::dot(plane.normal, plane.center));
+	}
+}
+
 //bool Camera::isOnFrustum(const Sphere& shape) const
 //{
 //	return 
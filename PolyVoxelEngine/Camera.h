@@ -3,6 +3,7 @@
 #include "Shapes.h"
 #include <GLFW/glfw3.h>
 #include <glm/mat4x4.hpp>
+#include <glm/vec4.hpp>
 
 #undef far
 #undef near
@@ -48,6 +49,7 @@ public:
 	void passPositionToShader(Shader* shader, const char* uniform) const;
 
 	bool isOnFrustum(const Box& shape) const;
+	void getFrustumPlanes(glm::vec4* planes) const; // 6 planes, xyz normal and w distance
 	//bool isOnFrustum(const Sphere& shape) const;
 };
 
@@ -2,19 +2,27 @@
 #include <iostream>
 #include "TerrainGenerator.h"
 #include "Profiler.h"
-#include <filesystem>
-#include <fstream>
-
-Face* Chunk::facesData = nullptr;
-FaceInstanceData* Chunk::faceInstancesData = nullptr;
-FaceInstancesVBO* Chunk::faceInstancesVBO = nullptr;
-std::unordered_map<int, Chunk*> Chunk::chunkMap;
+#include <bit>
+#include <algorithm>
+
+thread_local std::vector<Face> Chunk::facesData;
+thread_local std::vector<FaceInstanceData> Chunk::faceInstancesData;
+thread_local std::vector<uint16_t> Chunk::faceMasks;
+thread_local std::vector<uint64_t> Chunk::faceKeys;
+thread_local const Chunk* Chunk::meshingChunks[27] = {};
+
+// index of neighbours[side] in surroundingChunks
+static constexpr size_t SIDE_SURROUNDING_INDEXES[6] = { 14, 12, 16, 10, 22, 4 };
+ChunkIndex Chunk::chunkMap;
+RegionStorage Chunk::dataRegions(Settings::chunkSavesPath, true);
 std::vector<LightPropagationNode> Chunk::lightingFloodFillVector;
 std::vector<LightRemovalNode> Chunk::darknessFloodFillVector;
 std::vector<LightUpdate> Chunk::lightingUpdateVector;
 std::mutex Chunk::lightingFloodFillMutex;
 std::mutex Chunk::darknessFloodFillMutex;
 std::mutex Chunk::lightingUpdateMutex;
+std::vector<Chunk*> Chunk::dirtyChunks;
+std::mutex Chunk::dirtyChunksMutex;
 
 static inline constexpr int min_int(int a, int b)
 {
@@ -55,13 +63,9 @@ std::string toString(Chunk::State state)
 	}
 }
 
-Chunk::Chunk() : blocks{}, lightingMap{}, X(0), Y(0), Z(0), neighbours{ nullptr, nullptr, nullptr, nullptr, nullptr, nullptr }
+Chunk::Chunk() : X(0), Y(0), Z(0), neighbours{ nullptr, nullptr, nullptr, nullptr, nullptr, nullptr }, surroundingChunks{}
 {
 	blocksCount = 0;
-	for (size_t i = 0; i < Settings::CHUNK_SIZE_CUBED; i++)
-	{
-		blocks[i] = Block::Air;
-	}
 }
 
 Chunk::~Chunk()
@@ -69,7 +73,7 @@ Chunk::~Chunk()
 
 void Chunk::setDrawID(unsigned int ID)
 {
-	drawCommand.offset = unsigned int(ID * Settings::FACE_INSTANCES_PER_CHUNK);
+	drawSlot = ID;
 }
 
 void Chunk::init(int x, int y, int z)
@@ -77,8 +81,11 @@ void Chunk::init(int x, int y, int z)
 	X = x;
 	Y = y;
 	Z = z;
+	generationCancelled = false;
+	pendingLightingUpdates.clear();
+	sideConnections = ChunkVisibility::ALL_SIDES_CONNECTED;
 
-	chunkMap[posHash()] = this;
+	chunkMap.insert(this);
 
 	neighbours[0] = getChunkAt(X + 1, Y, Z);
 	neighbours[1] = getChunkAt(X - 1, Y, Z);
@@ -94,6 +101,20 @@ void Chunk::init(int x, int y, int z)
 			neighbours[i]->neighbours[i ^ 1] = this;
 		}
 	}
+
+	for (int i = 0; i < 27; i++)
+	{
+		Chunk* chunk = nullptr;
+		if (i != 13)
+		{
+			chunk = getChunkAt(X + i % 3 - 1, Y + (i / 3) % 3 - 1, Z + i / 9 - 1);
+		}
+		surroundingChunks[i] = chunk;
+		if (chunk)
+		{
+			chunk->surroundingChunks[26 - i] = this;
+		}
+	}
 }
 
 void Chunk::destroy()
@@ -104,22 +125,72 @@ void Chunk::destroy()
 		physicEntities.clear();
 	}
 
+	unlinkNeighbours();
+
+	if (hasDirtyCells)
+	{
+		hasDirtyCells = false;
+		std::lock_guard<std::mutex> lock(dirtyChunksMutex);
+		auto it = std::find(dirtyChunks.begin(), dirtyChunks.end(), this);
+		if (it != dirtyChunks.end())
+		{
+			*it = dirtyChunks.back();
+			dirtyChunks.pop_back();
+		}
+	}
+
+	// TODO: chunk may save while init
+	thread_local static std::vector<ChunkDelta::Run> runs;
+	blockChanges.collectRuns(runs, [this](size_t index)
+		{
+			return blocks.get(index);
+		}
+	);
+	saveData(runs, X, Y, Z);
+
+	clearStorage();
+}
+
+void Chunk::clearStorage()
+{
+	// pooled chunks shouldn't keep index arrays
+	blockChanges.clear();
+	std::vector<LightUpdate>().swap(pendingLightingUpdates);
+
+	std::unique_lock<std::shared_mutex> lock(storageMutex);
+	blocks.fill(Block::Air);
+	lightingMap.fill(0);
+	blocksCount = 0;
+}
+
+void Chunk::unlinkNeighbours()
+{
 	for (size_t i = 0; i < 6; i++)
 	{
 		if (neighbours[i])
 		{
 			neighbours[i]->neighbours[i ^ 1] = nullptr;
+			neighbours[i] = nullptr;
 		}
 	}
 
-	// TODO: chunk may save while init
-	saveData(blockChanges, X, Y, Z);
+	for (int i = 0; i < 27; i++)
+	{
+		if (surroundingChunks[i])
+		{
+			surroundingChunks[i]->surroundingChunks[26 - i] = nullptr;
+			surroundingChunks[i] = nullptr;
+		}
+	}
 }
 
-void Chunk::generateBlocks()
+Chunk* Chunk::getSurroundingChunk(int chunkX, int chunkY, int chunkZ) const
 {
-	Profiler::start(BLOCK_GENERATION_INDEX);
+	return surroundingChunks[(chunkX - X + 1) + (chunkY - Y + 1) * 3 + (chunkZ - Z + 1) * 9];
+}
 
+void Chunk::generateBlocks()
+{
 	state = State::Loading;
 
 	ChunkColumnData* chunkColumnData = TerrainGenerator::getHeightMap(X, Z);
@@ -130,21 +201,70 @@ void Chunk::generateBlocks()
 	}
 
 	chunkColumnData->startUsing();
+	generateTerrain(chunkColumnData);
+	chunkColumnData->stopUsing();
+
+	finishLoading();
+}
+
+void Chunk::generateTerrain(const ChunkColumnData* chunkColumnData)
+{
+	// pooled chunk may still be read by outdated meshing of its old neighbours
+	std::unique_lock<std::shared_mutex> lock(storageMutex);
+
+	PROFILER_ZONE(generationZone, "BlockGeneration");
+
+	blocks.fill(Block::Air);
+	lightingMap.fill(0);
+	blocksCount = 0;
+
+	int chunkBottomY = Y * Settings::CHUNK_SIZE;
+	int chunkTopY = chunkBottomY + Settings::CHUNK_SIZE - 1;
 
-	int chunkMaxY = INT_MIN;
+	int minSlmh = INT_MAX;
+	int maxSlmh = INT_MIN;
+	for (size_t index = 0; index < Settings::CHUNK_SIZE_SQUARED; index++)
 	{
-		int globalY = Y * Settings::CHUNK_SIZE;
-		int globalMaxY = INT_MIN;
-		for (size_t index = 0; index < Settings::CHUNK_SIZE_SQUARED; index++)
-		{
-			globalMaxY = std::max(globalMaxY, chunkColumnData->getHeightAtByIndex(index));
-		}
-		chunkMaxY = (int)floorf((float)globalMaxY / (float)Settings::CHUNK_SIZE);
+		int slmh = chunkColumnData->getSlMHAtByIndex(index);
+		minSlmh = std::min(minSlmh, slmh);
+		maxSlmh = std::max(maxSlmh, slmh);
 	}
 
 	Biome biome = chunkColumnData->getBiome();
 
-	if (Y <= chunkMaxY)
+	// classify by column heights, see TerrainGenerator::getBlock
+	if (chunkBottomY > chunkColumnData->getMaxHeight())
+	{
+		// all air, storage is already filled
+	}
+	else if (chunkTopY < chunkColumnData->getMinHeight() - TerrainGenerator::CAVE_DEPTH)
+	{
+		// stone with caves only
+		TerrainGenerator::generateChunkCaveNoise(X, Y, Z);
+		if (chunkTopY < minSlmh)
+		{
+			// whole chunk is under sky light max height, so placing stone there can't change lighting
+			blocks.fill(Block::Stone);
+			size_t count = Settings::CHUNK_SIZE_CUBED;
+			for (size_t index = 0; index < Settings::CHUNK_SIZE_CUBED; index++)
+			{
+				if (TerrainGenerator::isCaveAtIndex(index))
+				{
+					blocks.set(index, Block::Air);
+					count--;
+				}
+			}
+			blocksCount = (uint16_t)count;
+		}
+		else
+		{
+			for (size_t index = 0; index < Settings::CHUNK_SIZE_CUBED; index++)
+			{
+				setBlockByIndexNoSave(index, TerrainGenerator::isCaveAtIndex(index) ? Block::Air : Block::Stone);
+			}
+		}
+	}
+	else
 	{
 		TerrainGenerator::generateChunkCaveNoise(X, Y, Z);
 		for (size_t z = 0; z < Settings::CHUNK_SIZE; z++)
@@ -164,203 +284,400 @@ void Chunk::generateBlocks()
 			}
 		}
 	}
+
+	generationZone.end();
+
+	PROFILER_ZONE(loadDataZone, "ChunkLoadData");
+	thread_local static std::vector<ChunkDelta::Run> loadedRuns;
+	loadData(loadedRuns, X, Y, Z);
+	loadDataZone.end();
+
+	applyChanges(loadedRuns);
+
+	// lighting
+	PROFILER_ZONE(lightingZone, "ChunkLighting");
+	if (chunkTopY < minSlmh)
+	{
+		// storage is already filled with darkness
+	}
+	else if (chunkBottomY >= maxSlmh && blocksCount == 0)
+	{
+		lightingMap.fill(240);
+	}
 	else
 	{
-		for (size_t z = 0; z < Settings::CHUNK_SIZE; z++)
-		{
-			for (size_t y = 0; y < Settings::CHUNK_SIZE; y++)
-			{
-				for (size_t x = 0; x < Settings::CHUNK_SIZE; x++)
-				{
-					setBlockAtNoSave(x, y, z, Block::Air);
-				}
-			}
-		}
+		initSkyLighting(chunkColumnData);
 	}
 
-	Profiler::end(BLOCK_GENERATION_INDEX);
+	// block changes may have removed everything but one block
+	blocks.compact();
+	lightingMap.compact();
+}
 
-	Profiler::start(CHUNK_LOAD_DATA_INDEX);
-	loadData(blockChanges, X, Y, Z);
-	Profiler::end(CHUNK_LOAD_DATA_INDEX);
+void Chunk::finishLoading()
+{
+	PROFILER_ZONE(zone, "ChunkLighting");
 
-	applyChanges();
+	state = State::Loaded;
 
-	// lighting
-	// TODO: rework
-	Profiler::start(CHUNK_LIGHTING_INDEX);
-	for (size_t x = 0; x < Settings::CHUNK_SIZE; x++)
+	if (!pendingLightingUpdates.empty())
 	{
-		for (size_t z = 0; z < Settings::CHUNK_SIZE; z++)
+		std::lock_guard<std::mutex> lock(lightingUpdateMutex);
+		lightingUpdateVector.insert(lightingUpdateVector.end(), pendingLightingUpdates.begin(), pendingLightingUpdates.end());
+	}
+	std::vector<LightUpdate>().swap(pendingLightingUpdates);
+
+	publishBoundaryLighting();
+}
+
+void Chunk::initSkyLighting(const ChunkColumnData* chunkColumnData)
+{
+	// storage is locked and chunk is loading, so blocks are read directly
+	thread_local static std::vector<uint8_t> skyLighting(Settings::CHUNK_SIZE_CUBED);
+	thread_local static std::vector<uint8_t> transparentCells(Settings::CHUNK_SIZE_CUBED);
+	thread_local static std::vector<uint16_t> queue;
+	constexpr size_t shift = floorlog2(Settings::CHUNK_SIZE);
+	constexpr size_t mask = Settings::CHUNK_SIZE - 1;
+
+	// straight down sunlight, row of 16 cells along x at a time
+	Block row[Settings::CHUNK_SIZE];
+	int slmhRow[Settings::CHUNK_SIZE];
+	for (size_t z = 0; z < Settings::CHUNK_SIZE; z++)
+	{
+		for (size_t x = 0; x < Settings::CHUNK_SIZE; x++)
 		{
-			int slmh = chunkColumnData->getSlMHAt(x, z);
+			slmhRow[x] = chunkColumnData->getSlMHAt(x, z);
+		}
 
-			for (size_t y = 0; y < Settings::CHUNK_SIZE; y++)
-			{
-				int globalY = (int)y + Y * Settings::CHUNK_SIZE;
+		for (size_t y = 0; y < Settings::CHUNK_SIZE; y++)
+		{
+			int globalY = (int)y + Y * Settings::CHUNK_SIZE;
+			size_t rowStart = getIndex(0, y, z);
+			blocks.getBlocks(rowStart, Settings::CHUNK_SIZE, row);
 
-				Block block = getBlockAtInBoundaries(x, y, z);
-				size_t index = getIndex(x, y, z);
-				if (ALL_BLOCK_DATA[(size_t)block].transparent)
-				{
-					if (globalY < slmh)
-					{
-						lightingMap[index] = 0;
-					}
-					else
-					{
-						lightingMap[index] = 240;
-					}
-				}
-				else
-				{
-					lightingMap[index] = 0;
-				}
+			uint8_t* transparentRow = transparentCells.data() + rowStart;
+			uint8_t* skyRow = skyLighting.data() + rowStart;
+			for (size_t x = 0; x < Settings::CHUNK_SIZE; x++)
+			{
+				transparentRow[x] = ALL_BLOCK_DATA[(size_t)row[x]].transparent;
+			}
+			// branchless, so compiler can vectorize it
+			for (size_t x = 0; x < Settings::CHUNK_SIZE; x++)
+			{
+				skyRow[x] = (uint8_t)(transparentRow[x] & (globalY >= slmhRow[x])) * 15;
 			}
 		}
 	}
 
-	chunkColumnData->stopUsing();
-
-	state = State::Loaded;
-
-	// get lighting from neighbours
-	for (int x = -1; x <= Settings::CHUNK_SIZE; x += (Settings::CHUNK_SIZE + 1))
+	// spread sunlight sideways and under overhangs inside chunk
+	// only lit cells next to darker transparent cell start the search
+	queue.clear();
+	for (size_t index = 0; index < Settings::CHUNK_SIZE_CUBED; index++)
 	{
-		size_t neighbourIndex = x == -1 ? 1 : 0;
-		const Chunk* neighbour = neighbours[neighbourIndex];
-		if (neighbour == nullptr || neighbour->state != State::Loaded)
+		if (skyLighting[index] != 15)
 		{
 			continue;
 		}
 
-		int inBoundaryX = x & (Settings::CHUNK_SIZE - 1);
-		int globalX = x + X * Settings::CHUNK_SIZE;
-		for (int z = 0; z < Settings::CHUNK_SIZE; z++)
+		size_t coords[3] = { index & mask, (index >> shift) & mask, index >> (shift << 1) };
+		for (size_t side = 0; side < 6; side++)
 		{
-			int globalZ = z + Z * Settings::CHUNK_SIZE;
-			for (int y = 0; y < Settings::CHUNK_SIZE; y++)
+			size_t axis = side >> 1;
+			bool negative = side & 1;
+			if (negative ? coords[axis] == 0 : coords[axis] == Settings::CHUNK_SIZE - 1)
 			{
-				int globalY = y + Y * Settings::CHUNK_SIZE;
-
-				uint8_t lighting = neighbour->getLightingAtInBoundaries(inBoundaryX, y, z) & 15;
-				if (lighting > 1)
-				{
-					std::lock_guard<std::mutex> lock(lightingFloodFillMutex);
-					lightingFloodFillVector.emplace_back
-					(
-						globalX, globalY, globalZ, false
-					);
-				}
+				continue;
+			}
+			size_t neighbourIndex = negative ? index - ((size_t)1 << (shift * axis)) : index + ((size_t)1 << (shift * axis));
+			if (transparentCells[neighbourIndex] && skyLighting[neighbourIndex] < 14)
+			{
+				queue.push_back((uint16_t)index);
+				break;
 			}
 		}
 	}
-	for (int y = -1; y <= Settings::CHUNK_SIZE; y += (Settings::CHUNK_SIZE + 1))
+
+	for (size_t i = 0; i < queue.size(); i++)
 	{
-		size_t neighbourIndex = y == -1 ? 3 : 2;
-		const Chunk* neighbour = neighbours[neighbourIndex];
-		if (neighbour == nullptr || neighbour->state != State::Loaded)
+		size_t index = queue[i];
+		uint8_t lightLevel = skyLighting[index];
+		if (lightLevel <= 1)
 		{
 			continue;
 		}
 
-		int inBoundaryY = y & (Settings::CHUNK_SIZE - 1);
-		int globalY = y + Y * Settings::CHUNK_SIZE;
-		for (int z = 0; z < Settings::CHUNK_SIZE; z++)
+		size_t coords[3] = { index & mask, (index >> shift) & mask, index >> (shift << 1) };
+		for (size_t side = 0; side < 6; side++)
 		{
-			int globalZ = z + Z * Settings::CHUNK_SIZE;
-			for (int x = 0; x < Settings::CHUNK_SIZE; x++)
+			size_t axis = side >> 1;
+			bool negative = side & 1;
+			if (negative ? coords[axis] == 0 : coords[axis] == Settings::CHUNK_SIZE - 1)
 			{
-				int globalX = x + X * Settings::CHUNK_SIZE;
-
-				uint8_t lighting = neighbour->getLightingAtInBoundaries(x, inBoundaryY, z) & 15;
-				if (lighting > 1)
-				{
-					std::lock_guard<std::mutex> lock(lightingFloodFillMutex);
-					lightingFloodFillVector.emplace_back
-					(
-						globalX, globalY, globalZ, false
-					);
-				}
+				continue;
+			}
+			size_t neighbourIndex = negative ? index - ((size_t)1 << (shift * axis)) : index + ((size_t)1 << (shift * axis));
+			if (transparentCells[neighbourIndex] && skyLighting[neighbourIndex] + 1 < lightLevel)
+			{
+				skyLighting[neighbourIndex] = lightLevel - 1;
+				queue.push_back((uint16_t)neighbourIndex);
 			}
 		}
 	}
-	for (int z = -1; z <= Settings::CHUNK_SIZE; z += (Settings::CHUNK_SIZE + 1))
+
+	for (size_t index = 0; index < Settings::CHUNK_SIZE_CUBED; index++)
+	{
+		lightingMap.set(index, skyLighting[index] << 4);
+	}
+}
+
+void Chunk::publishBoundaryLighting()
+{
+	// light crosses border only where one side is brighter by more than one level
+	// seeds are collected first and published with single lock
+	thread_local static std::vector<LightPropagationNode> seeds;
+	seeds.clear();
+
+	for (size_t side = 0; side < 6; side++)
 	{
-		size_t neighbourIndex = z == -1 ? 5 : 4;
-		const Chunk* neighbour = neighbours[neighbourIndex];
+		const Chunk* neighbour = neighbours[side];
 		if (neighbour == nullptr || neighbour->state != State::Loaded)
 		{
 			continue;
 		}
 
-		int inBoundaryZ = z & (Settings::CHUNK_SIZE - 1);
-		int globalZ = z + Z * Settings::CHUNK_SIZE;
-		for (int x = 0; x < Settings::CHUNK_SIZE; x++)
+		size_t axis = side >> 1;
+		size_t u = (axis + 1) % 3;
+		size_t v = (axis + 2) % 3;
+		int borderCoord = (side & 1) ? 0 : Settings::CHUNK_SIZE - 1;
+		int neighbourBorderCoord = (Settings::CHUNK_SIZE - 1) - borderCoord;
+		int chunkPos[3] = { X * Settings::CHUNK_SIZE, Y * Settings::CHUNK_SIZE, Z * Settings::CHUNK_SIZE };
+		int neighbourOffset = (side & 1) ? -1 : 1;
+
+		for (int a = 0; a < Settings::CHUNK_SIZE; a++)
 		{
-			int globalX = x + X * Settings::CHUNK_SIZE;
-			for (int y = 0; y < Settings::CHUNK_SIZE; y++)
+			for (int b = 0; b < Settings::CHUNK_SIZE; b++)
 			{
-				int globalY = y + Y * Settings::CHUNK_SIZE;
-
-				uint8_t lighting = neighbour->getLightingAtInBoundaries(x, y, inBoundaryZ) & 15;
-				if (lighting > 1)
+				int coords[3];
+				coords[axis] = borderCoord;
+				coords[u] = a;
+				coords[v] = b;
+				int neighbourCoords[3] = { coords[0], coords[1], coords[2] };
+				neighbourCoords[axis] = neighbourBorderCoord;
+
+				BlockAndLighting own = getBlockAndLightingAtInBoundaries(coords[0], coords[1], coords[2]);
+				BlockAndLighting other = neighbour->getBlockAndLightingAtInBoundaries(neighbourCoords[0], neighbourCoords[1], neighbourCoords[2]);
+				bool ownTransparent = ALL_BLOCK_DATA[(size_t)own.block].transparent;
+				bool otherTransparent = ALL_BLOCK_DATA[(size_t)other.block].transparent;
+
+				for (int blockOrSky = 0; blockOrSky < 2; blockOrSky++)
 				{
-					std::lock_guard<std::mutex> lock(lightingFloodFillMutex);
-					lightingFloodFillVector.emplace_back
-					(
-						globalX, globalY, globalZ, false
-					);
+					uint8_t ownLevel = (own.lighting >> (4 * blockOrSky)) & 15;
+					uint8_t otherLevel = (other.lighting >> (4 * blockOrSky)) & 15;
+					if (ownTransparent && otherLevel > ownLevel + 1)
+					{
+						int globalCoords[3] = { chunkPos[0] + coords[0], chunkPos[1] + coords[1], chunkPos[2] + coords[2] };
+						globalCoords[axis] += neighbourOffset;
+						seeds.emplace_back(globalCoords[0], globalCoords[1], globalCoords[2], (bool)blockOrSky);
+					}
+					else if (otherTransparent && ownLevel > otherLevel + 1)
+					{
+						seeds.emplace_back(chunkPos[0] + coords[0], chunkPos[1] + coords[1], chunkPos[2] + coords[2], (bool)blockOrSky);
+					}
 				}
 			}
 		}
 	}
 
-	Profiler::end(CHUNK_LIGHTING_INDEX);
+	if (!seeds.empty())
+	{
+		std::lock_guard<std::mutex> lock(lightingFloodFillMutex);
+		lightingFloodFillVector.insert(lightingFloodFillVector.end(), seeds.begin(), seeds.end());
+	}
 }
 
-void Chunk::generateFaces()
+void Chunk::generateMesh(ChunkMesh& mesh, ChunkMeshConsumer* consumer) const
 {
-	drawCommand.resetFaces();
-	hasAnyFaces = false;
+	PROFILER_ZONE(zone, "GenerateMesh");
+	mesh.drawCommand.resetFaces();
+	mesh.faceInstances.clear();
+	mesh.isStaged = false;
+	mesh.sideConnections = ChunkVisibility::ALL_SIDES_CONNECTED;
 
-	if (blocksCount == 0 || isChunkClosed())
+	if (blocksCount == 0)
 	{
 		return;
 	}
 
-	fetchFaces();
-	greedyMeshing();
+	const Chunk* lockedChunks[27];
+	size_t lockedChunksCount = lockSurroundingStorages(lockedChunks);
 
-	hasAnyFaces = drawCommand.anyFaces();
-	if (hasAnyFaces)
+	// closed chunk has no faces, but still blocks view
+	mesh.sideConnections = calculateSideConnections();
+
+	if (isChunkClosed())
 	{
-		updateFacesData();
+		unlockStorages(lockedChunks, lockedChunksCount);
+		return;
+	}
+
+	allocateMeshingBuffers();
+	if (Settings::DynamicSettings::binaryGreedyMeshing)
+	{
+		fetchFacesBinary();
+		binaryGreedyMeshing(mesh.drawCommand.facesCount);
+	}
+	else
+	{
+		fetchFaces();
+		greedyMeshing(mesh.drawCommand.facesCount);
+	}
+
+	unlockStorages(lockedChunks, lockedChunksCount);
+
+	// only generated faces are kept until upload, straight in consumer memory (mapped GPU buffer) when there is room
+	size_t facesCount = mesh.drawCommand.getFacesCount();
+	FaceInstanceData* stagedFaces = nullptr;
+	if (consumer && facesCount > 0)
+	{
+		stagedFaces = consumer->allocateMeshFaces(facesCount, mesh.stagingOffset);
+		mesh.isStaged = stagedFaces != nullptr;
+	}
+	if (!mesh.isStaged)
+	{
+		mesh.faceInstances.reserve(facesCount);
+	}
+
+	for (size_t i = 0; i < 12; i++)
+	{
+		size_t count = mesh.drawCommand.facesCount[i];
+		const FaceInstanceData* faces = faceInstancesData.data() + getFacesOffset(i, count);
+		if (mesh.isStaged)
+		{
+			memcpy(stagedFaces, faces, count * sizeof(FaceInstanceData));
+			stagedFaces += count;
+		}
+		else
+		{
+			mesh.faceInstances.insert(mesh.faceInstances.end(), faces, faces + count);
+		}
 	}
 }
 
-void Chunk::updateFacesData() const
+size_t Chunk::getFacesOffset(size_t facesGroup, size_t count)
 {
-	for (size_t i = 0; i < 6; i++)
+	// solid faces fill side range from start, transparent ones from end
+	constexpr size_t sideSize = Settings::FACE_INSTANCES_PER_CHUNK / 6;
+	if (facesGroup < 6)
+	{
+		return facesGroup * sideSize;
+	}
+	return (facesGroup - 5) * sideSize - count;
+}
+
+size_t Chunk::lockSurroundingStorages(const Chunk** lockedChunks) const
+{
+	// main thread may repack storage of loaded chunks, generating chunks aren't read at all
+	// surroundingChunks is read once, main thread may unlink or unload chunks while they are meshed
+	size_t count = 0;
+	for (size_t i = 0; i < 27; i++)
+	{
+		const Chunk* chunk = i == 13 ? this : surroundingChunks[i];
+		meshingChunks[i] = nullptr;
+		if (chunk && chunk->state == State::Loaded)
+		{
+			meshingChunks[i] = chunk;
+			lockedChunks[count++] = chunk;
+		}
+	}
+
+	// locking in address order, so meshing workers can't deadlock with each other
+	std::sort(lockedChunks, lockedChunks + count);
+	for (size_t i = 0; i < count; i++)
+	{
+		lockedChunks[i]->storageMutex.lock_shared();
+	}
+
+	// chunk unloaded before it was locked may be reused at other position, storage isn't cleared while it's locked
+	for (int i = 0; i < 27; i++)
 	{
-		size_t count = drawCommand.facesCount[i];
-		size_t offset = i * (Settings::FACE_INSTANCES_PER_CHUNK / 6);
-		faceInstancesVBO->setData(faceInstancesData + offset, drawCommand.offset + offset, count);
+		const Chunk* chunk = meshingChunks[i];
+		if (
+			chunk && (chunk->state != State::Loaded ||
+			chunk->X != X + i % 3 - 1 || chunk->Y != Y + (i / 3) % 3 - 1 || chunk->Z != Z + i / 9 - 1)
+			)
+		{
+			meshingChunks[i] = nullptr;
+		}
+	}
+	return count;
+}
 
-		count = drawCommand.facesCount[6 + i];
-		offset = (i + 1) * (Settings::FACE_INSTANCES_PER_CHUNK / 6) - count;
-		faceInstancesVBO->setData(faceInstancesData + offset, drawCommand.offset + offset, count);
+void Chunk::unlockStorages(const Chunk** lockedChunks, size_t count)
+{
+	std::fill(meshingChunks, meshingChunks + 27, nullptr);
+	for (size_t i = 0; i < count; i++)
+	{
+		lockedChunks[i]->storageMutex.unlock_shared();
 	}
 }
 
-Chunk* Chunk::getChunkAt(int x, int y, int z)
+size_t Chunk::getAllocatedStorageSize() const
+{
+	return blocks.getAllocatedSize() + lightingMap.getAllocatedSize();
+}
+
+uint16_t Chunk::calculateSideConnections() const
+{
+	if (blocks.isUniform())
+	{
+		return ALL_BLOCK_DATA[(size_t)blocks.get(0)].transparent ? ChunkVisibility::ALL_SIDES_CONNECTED : 0;
+	}
+
+	uint64_t opaqueCells[Settings::CHUNK_SIZE_CUBED / 64]{0};
+	Block row[Settings::CHUNK_SIZE];
+	for (size_t rowStart = 0; rowStart < Settings::CHUNK_SIZE_CUBED; rowStart += Settings::CHUNK_SIZE)
+	{
+		blocks.getBlocks(rowStart, Settings::CHUNK_SIZE, row);
+		for (size_t x = 0; x < Settings::CHUNK_SIZE; x++)
+		{
+			size_t index = rowStart + x;
+			opaqueCells[index >> 6] |= (uint64_t)!ALL_BLOCK_DATA[(size_t)row[x]].transparent << (index & 63);
+		}
+	}
+	return ChunkVisibility::calculateSideConnections(opaqueCells);
+}
+
+void Chunk::applyMesh(const ChunkMesh& mesh)
+{
+	sideConnections = mesh.sideConnections;
+	memcpy(drawCommand.facesCount, mesh.drawCommand.facesCount, sizeof(drawCommand.facesCount));
+
+	hasAnyFaces = drawCommand.anyFaces();
+}
+
+void Chunk::allocateMeshingBuffers()
 {
-	const auto& it = chunkMap.find(pos3_hash(x, y, z));
-	if (it == chunkMap.end())
+	if (faceInstancesData.empty())
+	{
+		faceInstancesData.resize(Settings::FACE_INSTANCES_PER_CHUNK);
+	}
+	if (Settings::DynamicSettings::binaryGreedyMeshing)
+	{
+		if (faceMasks.empty())
+		{
+			faceMasks.resize(Settings::CHUNK_SIZE_SQUARED * 6);
+			faceKeys.resize(Settings::CHUNK_SIZE_CUBED * 6);
+		}
+	}
+	else if (facesData.empty())
 	{
-		return nullptr;
+		facesData.resize(Settings::CHUNK_SIZE_CUBED * 6);
 	}
-	return it->second;
+}
+
+Chunk* Chunk::getChunkAt(int x, int y, int z)
+{
+	return chunkMap.find(x, y, z);
 }
 
 char Chunk::getAO(int x, int y, int z, char side, const char* packOffsets) const
@@ -532,14 +849,27 @@ char Chunk::getAOandSmoothLighting(bool maxAO, int x, int y, int z, size_t side,
 		(ao3 << (packOffsets[3] << 1));
 }
 
+Block Chunk::setStoredBlock(size_t index, Block block)
+{
+	// even write that doesn't resize may reuse palette entry meshing worker is decoding through
+	// generation writes through blocks directly, it already holds storage lock
+	std::unique_lock<std::shared_mutex> lock(storageMutex);
+	return blocks.set(index, block);
+}
+
+void Chunk::setStoredLighting(size_t index, uint8_t lighting)
+{
+	std::unique_lock<std::shared_mutex> lock(storageMutex);
+	lightingMap.set(index, lighting);
+}
+
 void Chunk::setBlockByIndexNoSave(size_t index, Block block)
 {
-	Block prevBlock = blocks[index];
+	Block prevBlock = blocks.set(index, block);
 	if (prevBlock == block)
 	{
 		return;
 	}
-	blocks[index] = block;
 	if (prevBlock == Block::Air)
 	{
 		blocksCount++;
@@ -556,12 +886,11 @@ void Chunk::setBlockByIndexNoSave(size_t index, Block block)
 void Chunk::setBlockAtNoSave(size_t x, size_t y, size_t z, Block block)
 {
 	size_t index = getIndex(x, y, z);
-	Block prevBlock = blocks[index];
+	Block prevBlock = blocks.set(index, block);
 	if (prevBlock == block)
 	{
 		return;
 	}
-	blocks[index] = block;
 	if (prevBlock == Block::Air)
 	{
 		blocksCount++;
@@ -574,136 +903,80 @@ void Chunk::setBlockAtNoSave(size_t x, size_t y, size_t z, Block block)
 	updateLightingAt(x, y, z, block, prevBlock);
 }
 
-void Chunk::loadData(std::unordered_map<Block, Vector<uint16_t, Settings::CHUNK_SIZE_CUBED>>& blockChanges, int X, int Y, int Z)
+void Chunk::loadData(std::vector<ChunkDelta::Run>& runs, int X, int Y, int Z)
 {
-	blockChanges.clear();
-
-	std::string filepath = getFilepath(X, Y, Z);
-	if (!std::filesystem::exists(filepath))
+	runs.clear();
+	if (!Settings::DynamicSettings::chunkPersistence)
 	{
 		return;
 	}
 
-	std::ifstream file(filepath, std::ios::binary);
-	if (!file.is_open())
+	thread_local static std::vector<char> data;
+	if (!dataRegions.read(X, Y, Z, data))
 	{
-		std::cerr << "Failed to open chunk data file" << std::endl;
 		return;
 	}
 
-	size_t sizeOfBlock = 0;
-	unsigned int mapSize = 0;
-
-	file.read(reinterpret_cast<char*>(&sizeOfBlock), 1);
-	file.read(reinterpret_cast<char*>(&mapSize), sizeOfBlock);
-
-	Vector<uint16_t, Settings::CHUNK_SIZE_CUBED> indexes;
+	ChunkDelta::decode(data, runs);
+}
 
-	for (unsigned int i = 0; i < mapSize; i++)
+void Chunk::saveData(const std::vector<ChunkDelta::Run>& runs, int X, int Y, int Z)
+{
+	if (runs.empty() || !Settings::DynamicSettings::chunkPersistence)
 	{
-		Block block;
-		uint16_t count;
-
-		file.read(reinterpret_cast<char*>(&count), sizeof(count));
-		if (count == 0)
-		{
-			std::cerr << "Chunk::loadData: block count is 0" << std::endl;
-			continue;
-		}
-
-		file.read(reinterpret_cast<char*>(&block), sizeOfBlock);
-
-		indexes.resize(count);
-		file.read
-		(
-			reinterpret_cast<char*>(indexes.getData()),
-			count * sizeof(indexes[0])
-		);
-
-		blockChanges[block] = std::move(indexes);
+		return;
 	}
 
-	file.close();
+	std::vector<char> data;
+	ChunkDelta::encode(runs, data);
+	dataRegions.writeAsync(X, Y, Z, std::move(data));
 }
 
-void Chunk::saveData(std::unordered_map<Block, Vector<uint16_t, Settings::CHUNK_SIZE_CUBED>>& blockChanges, int X, int Y, int Z)
+void Chunk::applyChanges(const std::vector<ChunkDelta::Run>& runs)
 {
-	if (blockChanges.empty())
+	blockChanges.clear();
+	for (const auto& run : runs)
 	{
-		return;
+		size_t end = (size_t)run.start + run.length;
+		for (size_t index = run.start; index < end; index++)
+		{
+			setBlockByIndexNoSave(index, run.block);
+			blockChanges.markEdited(index);
+		}
 	}
+}
 
-	std::string filepath = getFilepath(X, Y, Z);
-	std::ofstream file(filepath, std::ios::binary | std::ios::trunc);
-	if (!file.is_open())
-	{
-		std::cerr << "Failed to open chunk data file " << std::endl;
-		return;
-	}
+bool Chunk::isUniformSolid() const
+{
+	return blocks.isUniform() && !ALL_BLOCK_DATA[(size_t)blocks.get(0)].transparent;
+}
 
-	try 
+bool Chunk::canSkipMeshing() const
+{
+	if (blocksCount == 0)
 	{
-		size_t sizeOfBlock = sizeof(Block);
-		Block mapSize = (Block)blockChanges.size();
-
-		file.write
-		(
-			reinterpret_cast<const char*>(&sizeOfBlock),
-			1
-		);
-		file.write
-		(
-			reinterpret_cast<const char*>(&mapSize),
-			sizeOfBlock
-		);
-
-		for (const auto& pair : blockChanges)
-		{
-			const auto& indexes = pair.second;
-			Block block = pair.first;
-			uint16_t count = (uint16_t)indexes.getSize();
-
-			file.write
-			(
-				reinterpret_cast<const char*>(&count),
-				sizeof(count)
-			);
-			file.write
-			(
-				reinterpret_cast<const char*>(&block),
-				sizeOfBlock
-			);
-			file.write
-			(
-				reinterpret_cast<const char*>(indexes.getData()),
-				indexes.getSize() * sizeof(indexes[0])
-			);
-		}
+		return true;
 	}
-	catch (const std::exception& e) 
+	if (!isUniformSolid())
 	{
-		std::cerr << "Failed to write to chunk data file: " << e.what() << std::endl;
+		return false;
 	}
-	file.close();
-}
 
-void Chunk::applyChanges()
-{
-	for (const auto& pair : blockChanges)
+	// like isChunkClosed, missing neighbours don't open chunk
+	for (const Chunk* neighbour : neighbours)
 	{
-		const Block& block = pair.first;
-		const auto& vector = pair.second;
-		for (uint16_t index : vector)
+		if (neighbour && (neighbour->state != State::Loaded || !neighbour->isUniformSolid()))
 		{
-			setBlockByIndexNoSave(index, block);
+			return false;
 		}
 	}
+	return true;
 }
 
 bool Chunk::isChunkClosed() const
 {
 	// right
-	const Chunk* neighbour = neighbours[0];
+	const Chunk* neighbour = meshingChunks[SIDE_SURROUNDING_INDEXES[0]];
 	if (neighbour)
 	{
 		for (int y = 0; y < Settings::CHUNK_SIZE; y++)
@@ -719,7 +992,7 @@ bool Chunk::isChunkClosed() const
 		}
 	}
 	// left
-	neighbour = neighbours[1];
+	neighbour = meshingChunks[SIDE_SURROUNDING_INDEXES[1]];
 	if (neighbour)
 	{
 		for (int y = 0; y < Settings::CHUNK_SIZE; y++)
@@ -735,7 +1008,7 @@ bool Chunk::isChunkClosed() const
 		}
 	}
 	// top
-	neighbour = neighbours[2];
+	neighbour = meshingChunks[SIDE_SURROUNDING_INDEXES[2]];
 	if (neighbour)
 	{
 		for (int x = 0; x < Settings::CHUNK_SIZE; x++)
@@ -751,7 +1024,7 @@ bool Chunk::isChunkClosed() const
 		}
 	}
 	// bottom
-	neighbour = neighbours[3];
+	neighbour = meshingChunks[SIDE_SURROUNDING_INDEXES[3]];
 	if (neighbour)
 	{
 		for (int x = 0; x < Settings::CHUNK_SIZE; x++)
@@ -767,7 +1040,7 @@ bool Chunk::isChunkClosed() const
 		}
 	}
 	// front
-	neighbour = neighbours[4];
+	neighbour = meshingChunks[SIDE_SURROUNDING_INDEXES[4]];
 	if (neighbour)
 	{
 		for (int x = 0; x < Settings::CHUNK_SIZE; x++)
@@ -783,7 +1056,7 @@ bool Chunk::isChunkClosed() const
 		}
 	}
 	// front
-	neighbour = neighbours[5];
+	neighbour = meshingChunks[SIDE_SURROUNDING_INDEXES[5]];
 	if (neighbour)
 	{
 		for (int x = 0; x < Settings::CHUNK_SIZE; x++)
@@ -801,20 +1074,20 @@ bool Chunk::isChunkClosed() const
 	return true;
 }
 
-inline void Chunk::fetchFaces()
+static const char packOffsets[6][4] =
 {
-	const char packOffsets[6][4] =
-	{
-		// offset = 3 - order
-		{1, 2, 3, 0},
-		{0, 3, 2, 1},
-		{3, 2, 1, 0},
-		{0, 1, 2, 3},
-		{0, 3, 2, 1},
-		{1, 2, 3, 0}
-	};
-
-	Profiler::start(FACE_FETCHING_INDEX);
+	// offset = 3 - order
+	{1, 2, 3, 0},
+	{0, 3, 2, 1},
+	{3, 2, 1, 0},
+	{0, 1, 2, 3},
+	{0, 3, 2, 1},
+	{1, 2, 3, 0}
+};
+
+void Chunk::fetchFaces() const
+{
+	PROFILER_ZONE(zone, "FetchingFaces");
 	for (size_t x = 0; x < Settings::CHUNK_SIZE; x++)
 	{
 		for (size_t y = 0; y < Settings::CHUNK_SIZE; y++)
@@ -837,7 +1110,7 @@ inline void Chunk::fetchFaces()
 					offCoords[planeIndex] += (normalID & 1) ? -1 : 1;
 					// TODO: in other methods: replace offsets with offCoords
 
-					BlockAndLighting faceBAL = getBlockAndLightingAtSideCheck(offCoords[0], offCoords[1], offCoords[2], normalID);
+					BlockAndLighting faceBAL = getBlockAndLightingAtMeshingSide(offCoords[0], offCoords[1], offCoords[2], normalID);
 					Block faceBlock = faceBAL.block;
 					if (faceBlock != Block::Void && faceBlock != block && ALL_BLOCK_DATA[(size_t)faceBlock].transparent)
 					{
@@ -861,10 +1134,9 @@ inline void Chunk::fetchFaces()
 			}
 		}
 	}
-	Profiler::end(FACE_FETCHING_INDEX);
 }
 
-void Chunk::greedyMeshing()
+void Chunk::greedyMeshing(unsigned int* facesCount) const
 {
 	auto getFaceIndex = [](const size_t* coords, size_t normalID)
 		{
@@ -874,11 +1146,9 @@ void Chunk::greedyMeshing()
 	const size_t wIndexes[3] = { 1, 0, 0 };
 	const size_t hIndexes[3] = { 2, 2, 1 };
 
-	unsigned int* facesCount = drawCommand.facesCount;
-
 	size_t coords[3] = { 0, 0, 0 };
 
-	Profiler::start(GREEDY_MESHING_INDEX);
+	PROFILER_ZONE(zone, "GreedyMeshing");
 	for (coords[0] = 0; coords[0] < Settings::CHUNK_SIZE; coords[0]++)
 	{
 		for (coords[1] = 0; coords[1] < Settings::CHUNK_SIZE; coords[1]++)
@@ -976,11 +1246,352 @@ void Chunk::greedyMeshing()
 			}
 		}
 	}
-	Profiler::end(GREEDY_MESHING_INDEX);
+}
+
+// same fields as Face::operator== compares
+static inline uint64_t packFaceKey(unsigned int textureID, uint8_t lighting, char ao, const uint8_t* smoothLighting)
+{
+	uint64_t key = (uint64_t)(textureID & 0xFFFF) | ((uint64_t)lighting << 16) | ((uint64_t)(uint8_t)ao << 24);
+	if (smoothLighting)
+	{
+		key |= ((uint64_t)smoothLighting[0] << 32) | ((uint64_t)smoothLighting[1] << 40) | ((uint64_t)smoothLighting[2] << 48) | ((uint64_t)smoothLighting[3] << 56);
+	}
+	return key;
+}
+
+void Chunk::fetchFacesBinary() const
+{
+	constexpr int PADDED_SIZE = Settings::CHUNK_SIZE + 2;
+	static_assert(Settings::CHUNK_SIZE <= 16, "Column masks are stored in 16 bits");
+
+	auto getPaddedIndex = [](int x, int y, int z)
+		{
+			return x + (y + z * PADDED_SIZE) * PADDED_SIZE;
+		};
+
+	PROFILER_ZONE(zone, "FetchingFaces");
+
+	// blocks with border from face neighbours, edges and corners are never looked at
+	Block paddedBlocks[PADDED_SIZE * PADDED_SIZE * PADDED_SIZE];
+	std::fill(std::begin(paddedBlocks), std::end(paddedBlocks), Block::Void);
+	for (int z = 0; z < Settings::CHUNK_SIZE; z++)
+	{
+		for (int y = 0; y < Settings::CHUNK_SIZE; y++)
+		{
+			for (int x = 0; x < Settings::CHUNK_SIZE; x++)
+			{
+				paddedBlocks[getPaddedIndex(x + 1, y + 1, z + 1)] = blocks.get(getIndex(x, y, z));
+			}
+		}
+	}
+	for (size_t side = 0; side < 6; side++)
+	{
+		const Chunk* neighbour = meshingChunks[SIDE_SURROUNDING_INDEXES[side]];
+		if (neighbour == nullptr)
+		{
+			continue;
+		}
+
+		size_t plane = side >> 1;
+		size_t uAxis = plane == 0 ? 1 : 0;
+		size_t vAxis = plane == 2 ? 1 : 2;
+		int padded[3];
+		int local[3];
+		padded[plane] = (side & 1) ? 0 : Settings::CHUNK_SIZE + 1;
+		local[plane] = (side & 1) ? Settings::CHUNK_SIZE - 1 : 0;
+		for (int v = 0; v < Settings::CHUNK_SIZE; v++)
+		{
+			padded[vAxis] = v + 1;
+			local[vAxis] = v;
+			for (int u = 0; u < Settings::CHUNK_SIZE; u++)
+			{
+				padded[uAxis] = u + 1;
+				local[uAxis] = u;
+				paddedBlocks[getPaddedIndex(padded[0], padded[1], padded[2])] = neighbour->blocks.get(getIndex(local[0], local[1], local[2]));
+			}
+		}
+	}
+
+	// column masks, bit is z + 1
+	uint32_t createFacesMasks[PADDED_SIZE][PADDED_SIZE]{};
+	uint32_t transparentMasks[PADDED_SIZE][PADDED_SIZE]{};
+	uint32_t sameAsNextXMasks[PADDED_SIZE][PADDED_SIZE]{};
+	uint32_t sameAsNextYMasks[PADDED_SIZE][PADDED_SIZE]{};
+	uint32_t sameAsNextZMasks[PADDED_SIZE][PADDED_SIZE]{};
+	for (int z = 0; z < PADDED_SIZE; z++)
+	{
+		uint32_t bit = 1u << z;
+		for (int y = 0; y < PADDED_SIZE; y++)
+		{
+			for (int x = 0; x < PADDED_SIZE; x++)
+			{
+				Block block = paddedBlocks[getPaddedIndex(x, y, z)];
+				const BlockData& blockData = ALL_BLOCK_DATA[(size_t)block];
+				if (blockData.createFaces)
+				{
+					createFacesMasks[x][y] |= bit;
+				}
+				if (blockData.transparent && block != Block::Void)
+				{
+					transparentMasks[x][y] |= bit;
+				}
+				if (x + 1 < PADDED_SIZE && block == paddedBlocks[getPaddedIndex(x + 1, y, z)])
+				{
+					sameAsNextXMasks[x][y] |= bit;
+				}
+				if (y + 1 < PADDED_SIZE && block == paddedBlocks[getPaddedIndex(x, y + 1, z)])
+				{
+					sameAsNextYMasks[x][y] |= bit;
+				}
+				if (z + 1 < PADDED_SIZE && block == paddedBlocks[getPaddedIndex(x, y, z + 1)])
+				{
+					sameAsNextZMasks[x][y] |= bit;
+				}
+			}
+		}
+	}
+
+	// face is visible, when neighbour block is transparent, isn't Void and isn't the same block
+	for (int x = 0; x < Settings::CHUNK_SIZE; x++)
+	{
+		int px = x + 1;
+		for (int y = 0; y < Settings::CHUNK_SIZE; y++)
+		{
+			int py = y + 1;
+			uint32_t create = createFacesMasks[px][py];
+			uint32_t visible[6] =
+			{
+				create & transparentMasks[px + 1][py] & ~sameAsNextXMasks[px][py],
+				create & transparentMasks[px - 1][py] & ~sameAsNextXMasks[px - 1][py],
+				create & transparentMasks[px][py + 1] & ~sameAsNextYMasks[px][py],
+				create & transparentMasks[px][py - 1] & ~sameAsNextYMasks[px][py - 1],
+				create & (transparentMasks[px][py] >> 1) & ~sameAsNextZMasks[px][py],
+				create & (transparentMasks[px][py] << 1) & ~(sameAsNextZMasks[px][py] << 1)
+			};
+			for (size_t normalID = 0; normalID < 6; normalID++)
+			{
+				faceMasks[normalID * Settings::CHUNK_SIZE_SQUARED + x * Settings::CHUNK_SIZE + y] = (uint16_t)(visible[normalID] >> 1);
+			}
+		}
+	}
+
+	// keys only for visible faces
+	for (size_t normalID = 0; normalID < 6; normalID++)
+	{
+		size_t planeIndex = normalID >> 1;
+		for (int x = 0; x < Settings::CHUNK_SIZE; x++)
+		{
+			for (int y = 0; y < Settings::CHUNK_SIZE; y++)
+			{
+				uint32_t mask = faceMasks[normalID * Settings::CHUNK_SIZE_SQUARED + x * Settings::CHUNK_SIZE + y];
+				while (mask)
+				{
+					int z = std::countr_zero(mask);
+					mask &= mask - 1;
+
+					Block block = paddedBlocks[getPaddedIndex(x + 1, y + 1, z + 1)];
+					const BlockData& blockData = ALL_BLOCK_DATA[(size_t)block];
+					bool maxAO = blockData.lightPower > 0;
+
+					int offCoords[3] = { x, y, z };
+					offCoords[planeIndex] += (normalID & 1) ? -1 : 1;
+					BlockAndLighting faceBAL = getBlockAndLightingAtMeshingSide(offCoords[0], offCoords[1], offCoords[2], normalID);
+
+					size_t keyIndex = normalID * Settings::CHUNK_SIZE_CUBED + (z + (y + x * Settings::CHUNK_SIZE) * Settings::CHUNK_SIZE);
+#if ENABLE_SMOOTH_LIGHTING
+					uint8_t smoothLighting[4] = { 0, 0, 0, 0 };
+					char ao = getAOandSmoothLighting(maxAO, offCoords[0], offCoords[1], offCoords[2], planeIndex, packOffsets[normalID], smoothLighting, faceBAL);
+					faceKeys[keyIndex] = packFaceKey(blockData.textures[normalID], faceBAL.lighting, ao, smoothLighting);
+#else
+					char ao = 255;
+					if (blockData.lightPower == 0)
+					{
+						ao = getAO(offCoords[0], offCoords[1], offCoords[2], planeIndex, packOffsets[normalID]);
+					}
+					faceKeys[keyIndex] = packFaceKey(blockData.textures[normalID], faceBAL.lighting, ao, nullptr);
+#endif
+				}
+			}
+		}
+	}
+}
+
+void Chunk::binaryGreedyMeshing(unsigned int* facesCount) const
+{
+	// slices are merged in the same order as greedyMeshing visits faces, so output is identical
+	// quads are emitted in origin order afterwards
+	constexpr size_t ORIGIN_WORDS_COUNT = Settings::CHUNK_SIZE_CUBED / 64;
+	constexpr uint32_t ROW_FULL_MASK = (1u << Settings::CHUNK_SIZE) - 1;
+
+	PROFILER_ZONE(zone, "GreedyMeshing");
+	for (size_t normalID = 0; normalID < 6; normalID++)
+	{
+		size_t plane = normalID >> 1;
+		const uint16_t* masks = faceMasks.data() + normalID * Settings::CHUNK_SIZE_SQUARED;
+		const uint64_t* keys = faceKeys.data() + normalID * Settings::CHUNK_SIZE_CUBED;
+
+		uint64_t quadOrigins[ORIGIN_WORDS_COUNT]{};
+		uint8_t quadSizes[Settings::CHUNK_SIZE_CUBED];
+
+		// w and h axes are the same as in greedyMeshing
+		auto getFaceIndex = [plane](int slice, int w, int h)
+			{
+				int coords[3];
+				if (plane == 0)
+				{
+					coords[0] = slice; coords[1] = w; coords[2] = h;
+				}
+				else if (plane == 1)
+				{
+					coords[0] = w; coords[1] = slice; coords[2] = h;
+				}
+				else
+				{
+					coords[0] = w; coords[1] = h; coords[2] = slice;
+				}
+				return (size_t)(coords[2] + (coords[1] + coords[0] * Settings::CHUNK_SIZE) * Settings::CHUNK_SIZE);
+			};
+
+		for (int slice = 0; slice < Settings::CHUNK_SIZE; slice++)
+		{
+			// rows of not merged faces, bit is h
+			uint32_t rows[Settings::CHUNK_SIZE];
+			for (int w = 0; w < Settings::CHUNK_SIZE; w++)
+			{
+				if (plane == 0)
+				{
+					rows[w] = masks[slice * Settings::CHUNK_SIZE + w];
+				}
+				else if (plane == 1)
+				{
+					rows[w] = masks[w * Settings::CHUNK_SIZE + slice];
+				}
+				else
+				{
+					uint32_t row = 0;
+					for (int h = 0; h < Settings::CHUNK_SIZE; h++)
+					{
+						row |= ((masks[w * Settings::CHUNK_SIZE + h] >> slice) & 1u) << h;
+					}
+					rows[w] = row;
+				}
+			}
+
+			for (int w = 0; w < Settings::CHUNK_SIZE; w++)
+			{
+				while (rows[w])
+				{
+					int h = std::countr_zero(rows[w]);
+					uint64_t key = keys[getFaceIndex(slice, w, h)];
+
+					// expand W
+					int currentW = 1;
+					while (w + currentW < Settings::CHUNK_SIZE && (rows[w + currentW] >> h) & 1u && keys[getFaceIndex(slice, w + currentW, h)] == key)
+					{
+						currentW++;
+					}
+
+					// expand H, candidates are bits present in every merged row
+					uint32_t common = ROW_FULL_MASK;
+					for (int dw = 0; dw < currentW; dw++)
+					{
+						common &= rows[w + dw];
+					}
+					int currentH = 1;
+					while (h + currentH < Settings::CHUNK_SIZE && (common >> (h + currentH)) & 1u)
+					{
+						bool sameKeys = true;
+						for (int dw = 0; dw < currentW; dw++)
+						{
+							if (keys[getFaceIndex(slice, w + dw, h + currentH)] != key)
+							{
+								sameKeys = false;
+								break;
+							}
+						}
+						if (!sameKeys)
+						{
+							break;
+						}
+						currentH++;
+					}
+
+					// fill
+					uint32_t quadMask = (((1u << currentH) - 1) << h);
+					for (int dw = 0; dw < currentW; dw++)
+					{
+						rows[w + dw] &= ~quadMask;
+					}
+
+					size_t originIndex = getFaceIndex(slice, w, h);
+					quadOrigins[originIndex >> 6] |= 1ull << (originIndex & 63);
+					quadSizes[originIndex] = (uint8_t)((currentW - 1) | ((currentH - 1) << 4));
+				}
+			}
+		}
+
+		// add faces
+		for (size_t word = 0; word < ORIGIN_WORDS_COUNT; word++)
+		{
+			uint64_t bits = quadOrigins[word];
+			while (bits)
+			{
+				size_t originIndex = (word << 6) + std::countr_zero(bits);
+				bits &= bits - 1;
+
+				size_t z = originIndex % Settings::CHUNK_SIZE;
+				size_t y = (originIndex / Settings::CHUNK_SIZE) % Settings::CHUNK_SIZE;
+				size_t x = originIndex / Settings::CHUNK_SIZE_SQUARED;
+				int currentW = (quadSizes[originIndex] & 15) + 1;
+				int currentH = (quadSizes[originIndex] >> 4) + 1;
+				uint64_t key = keys[originIndex];
+
+				size_t index;
+				if (ALL_BLOCK_DATA[(size_t)blocks.get(getIndex(x, y, z))].transparent)
+				{
+					size_t faceIndex = facesCount[6 + normalID]++;
+					index = (normalID + 1) * (Settings::FACE_INSTANCES_PER_CHUNK / 6) - 1 - faceIndex;
+				}
+				else
+				{
+					size_t faceIndex = facesCount[normalID]++;
+					index = normalID * (Settings::FACE_INSTANCES_PER_CHUNK / 6) + faceIndex;
+				}
+
+				unsigned int textureID = (unsigned int)(key & 0xFFFF);
+				int lighting = (int)((key >> 16) & 0xFF);
+				char ao = (char)((key >> 24) & 0xFF);
+#if ENABLE_SMOOTH_LIGHTING
+				uint8_t smoothLighting[4] =
+				{
+					(uint8_t)(key >> 32), (uint8_t)(key >> 40), (uint8_t)(key >> 48), (uint8_t)(key >> 56)
+				};
+				faceInstancesData[index].set(
+					x, y, z, currentW, currentH, normalID, ao, textureID, lighting, smoothLighting
+				);
+#else
+				faceInstancesData[index].set(
+					x, y, z, currentW, currentH, normalID, ao, textureID, lighting
+				);
+#endif
+			}
+		}
+	}
 }
 
 void Chunk::updateLightingAt(size_t x, size_t y, size_t z, Block block, Block prevBlock)
 {
+	// chunk may be generated on worker thread, updates are published in finishLoading
+	if (state == State::Loading)
+	{
+		pendingLightingUpdates.emplace_back
+		(
+			this, x, y, z,
+			block, prevBlock
+		);
+		return;
+	}
+
 	std::lock_guard<std::mutex> lock(lightingUpdateMutex);
 	lightingUpdateVector.emplace_back
 	(
@@ -995,18 +1606,23 @@ Block Chunk::getBlockAtInBoundaries(size_t x, size_t y, size_t z) const
 	{
 		return Block::Void;
 	}
-	return blocks[getIndex(x, y, z)];
+	return blocks.get(getIndex(x, y, z));
 }
 
 bool Chunk::setBlockAtInBoundaries(size_t x, size_t y, size_t z, Block block)
 {
+	// generating chunk is written by its worker, edit would be overwritten anyway
+	if (state != State::Loaded)
+	{
+		return false;
+	}
+
 	size_t index = getIndex(x, y, z);
-	Block prevBlock = blocks[index];
+	Block prevBlock = setStoredBlock(index, block);
 	if (prevBlock == block)
 	{
 		return false;
 	}
-	blocks[index] = block;
 	if (prevBlock == Block::Air)
 	{
 		blocksCount++;
@@ -1020,21 +1636,8 @@ bool Chunk::setBlockAtInBoundaries(size_t x, size_t y, size_t z, Block block)
 	updateLightingAt(x, y, z, block, prevBlock);
 
 	// save changes
-	uint16_t saveIndex = (uint16_t)index;
-
-	const auto& it = blockChanges.find(prevBlock);
-	if (it != blockChanges.end())
-	{
-		auto& prevVec = it->second;
-
-		prevVec.remove(saveIndex);
-		if (prevVec.getSize() == 0)
-		{
-			blockChanges.erase(it);
-		}
-	}
-
-	blockChanges[block].push(saveIndex);
+	blockChanges.markEdited(index);
+	markDirty(x, y, z);
 	return true;
 }
 
@@ -1107,8 +1710,8 @@ Block Chunk::getBlockAt(int x, int y, int z) const
 		z &= (Settings::CHUNK_SIZE - 1);
 	}
 
-	const Chunk* chunk = getChunkAt(chX, chY, chZ);
-	if (!chunk || chunk->state != State::Loaded)
+	const Chunk* chunk = meshingChunks[(chX - X + 1) + (chY - Y + 1) * 3 + (chZ - Z + 1) * 9];
+	if (!chunk)
 	{
 		return Block::Void;
 	}
@@ -1149,7 +1752,7 @@ uint8_t Chunk::getLightingAtInBoundaries(size_t x, size_t y, size_t z) const
 	{
 		return 0;
 	}
-	return lightingMap[getIndex(x, y, z)];
+	return lightingMap.get(getIndex(x, y, z));
 }
 
 void Chunk::setLightingAtInBoundaries(size_t x, size_t y, size_t z, uint8_t lightPower, bool lightOrSky)
@@ -1159,7 +1762,42 @@ void Chunk::setLightingAtInBoundaries(size_t x, size_t y, size_t z, uint8_t ligh
 		return;
 	}
 	size_t index = getIndex(x, y, z);
-	lightingMap[index] = (lightingMap[index] & (15 << (4 * !lightOrSky))) | (lightPower << (4 * lightOrSky));
+	uint8_t lighting = lightingMap.get(index);
+	uint8_t newLighting = (lighting & (15 << (4 * !lightOrSky))) | (lightPower << (4 * lightOrSky));
+	if (newLighting == lighting)
+	{
+		return;
+	}
+	setStoredLighting(index, newLighting);
+	markDirty(x, y, z);
+}
+
+void Chunk::markDirty(size_t x, size_t y, size_t z)
+{
+	if (state != State::Loaded)
+	{
+		return;
+	}
+
+	size_t coords[3] = { x, y, z };
+	if (!hasDirtyCells)
+	{
+		hasDirtyCells = true;
+		for (size_t axis = 0; axis < 3; axis++)
+		{
+			dirtyMin[axis] = (uint8_t)coords[axis];
+			dirtyMax[axis] = (uint8_t)coords[axis];
+		}
+		std::lock_guard<std::mutex> lock(dirtyChunksMutex);
+		dirtyChunks.push_back(this);
+		return;
+	}
+
+	for (size_t axis = 0; axis < 3; axis++)
+	{
+		dirtyMin[axis] = std::min(dirtyMin[axis], (uint8_t)coords[axis]);
+		dirtyMax[axis] = std::max(dirtyMax[axis], (uint8_t)coords[axis]);
+	}
 }
 
 uint8_t Chunk::getLightingAt(int x, int y, int z) const
@@ -1208,7 +1846,7 @@ uint8_t Chunk::getLightingAt(int x, int y, int z) const
 		z &= (Settings::CHUNK_SIZE - 1);
 	}
 
-	const Chunk* chunk = getChunkAt(chX, chY, chZ);
+	const Chunk* chunk = getSurroundingChunk(chX, chY, chZ);
 	if (!chunk || chunk->state != State::Loaded)
 	{
 		return 0;
@@ -1263,7 +1901,7 @@ void Chunk::setLightingAt(int x, int y, int z, uint8_t lightPower, bool lightOrS
 		z &= (Settings::CHUNK_SIZE - 1);
 	}
 
-	Chunk* chunk = getChunkAt(chX, chY, chZ);
+	Chunk* chunk = getSurroundingChunk(chX, chY, chZ);
 	if (!chunk || chunk->state != State::Loaded)
 	{
 		return;
@@ -1321,7 +1959,7 @@ Chunk::BlockAndLighting Chunk::getBlockAndLightingAtInBoundaries(size_t x, size_
 		return { Block::Void, 0 };
 	}
 	size_t index = getIndex(x, y, z);
-	return {blocks[index], lightingMap[index]};
+	return {blocks.get(index), lightingMap.get(index)};
 }
 
 Chunk::BlockAndLighting Chunk::getBlockAndLightingAt(int x, int y, int z) const
@@ -1370,15 +2008,15 @@ Chunk::BlockAndLighting Chunk::getBlockAndLightingAt(int x, int y, int z) const
 		z &= (Settings::CHUNK_SIZE - 1);
 	}
 
-	const Chunk* chunk = getChunkAt(chX, chY, chZ);
-	if (!chunk || chunk->state != State::Loaded)
+	const Chunk* chunk = meshingChunks[(chX - X + 1) + (chY - Y + 1) * 3 + (chZ - Z + 1) * 9];
+	if (!chunk)
 	{
 		return {Block::Void, 0};
 	}
 	return chunk->getBlockAndLightingAtInBoundaries(x, y, z);
 }
 
-Chunk::BlockAndLighting Chunk::getBlockAndLightingAtSideCheck(int x, int y, int z, size_t side) const
+Chunk::BlockAndLighting Chunk::getBlockAndLightingAtMeshingSide(int x, int y, int z, size_t side) const
 {
 	if (
 		x >= 0 && x < Settings::CHUNK_SIZE &&
@@ -1388,8 +2026,8 @@ Chunk::BlockAndLighting Chunk::getBlockAndLightingAtSideCheck(int x, int y, int
 	{
 		return getBlockAndLightingAtInBoundaries(x, y, z);
 	}
-	const Chunk* chunk = neighbours[side];
-	if (!chunk || chunk->state != State::Loaded)
+	const Chunk* chunk = meshingChunks[SIDE_SURROUNDING_INDEXES[side]];
+	if (!chunk)
 	{
 		return {Block::Void, 0};
 	}
@@ -1399,21 +2037,25 @@ Chunk::BlockAndLighting Chunk::getBlockAndLightingAtSideCheck(int x, int y, int
 	return chunk->getBlockAndLightingAtInBoundaries(x, y, z);
 }
 
-int Chunk::posHash() const
-{
-	return pos3_hash(X, Y, Z);
-}
-
-std::string Chunk::getFilepath(int X, int Y, int Z)
+Chunk::BlockAndLighting Chunk::getBlockAndLightingAtSideCheck(int x, int y, int z, size_t side) const
 {
-	std::string path = Settings::chunkSavesPath;
-	path += std::to_string(X);
-	path += "_";
-	path += std::to_string(Y);
-	path += "_";
-	path += std::to_string(Z);
-	path += ".bin";
-	return path;
+	if (
+		x >= 0 && x < Settings::CHUNK_SIZE &&
+		y >= 0 && y < Settings::CHUNK_SIZE &&
+		z >= 0 && z < Settings::CHUNK_SIZE
+		)
+	{
+		return getBlockAndLightingAtInBoundaries(x, y, z);
+	}
+	const Chunk* chunk = neighbours[side];
+	if (!chunk || chunk->state != State::Loaded)
+	{
+		return {Block::Void, 0};
+	}
+	x &= Settings::CHUNK_SIZE - 1;
+	y &= Settings::CHUNK_SIZE - 1;
+	z &= Settings::CHUNK_SIZE - 1;
+	return chunk->getBlockAndLightingAtInBoundaries(x, y, z);
 }
 
 DrawCommand::DrawCommand()
@@ -1430,6 +2072,26 @@ bool DrawCommand::anyFaces() const
 		facesCount[6] || facesCount[7] || facesCount[8] || facesCount[9] || facesCount[10] || facesCount[11];
 }
 
+unsigned int DrawCommand::getFacesCount() const
+{
+	unsigned int count = 0;
+	for (unsigned int faces : facesCount)
+	{
+		count += faces;
+	}
+	return count;
+}
+
+unsigned int DrawCommand::getGroupOffset(size_t group) const
+{
+	unsigned int groupOffset = offset;
+	for (size_t i = 0; i < group; i++)
+	{
+		groupOffset += facesCount[i];
+	}
+	return groupOffset;
+}
+
 PhysicEntityCollider::PhysicEntityCollider(glm::vec3& position, glm::vec3& size, glm::vec3& dpos) : position(position), size(size), dpos(dpos)
 {}
 
@@ -1,23 +1,34 @@
 #pragma once
 #include "settings.h"
-#include "FaceInstancesVBO.h"
+#include "DrawData.h"
 #include <unordered_map>
 #include "Block.h"
 #include "Vector.h"
+#include "ChunkStorage.h"
+#include "ChunkIndex.h"
+#include "ChunkDelta.h"
+#include "RegionFile.h"
+#include "ChunkVisibility.h"
+#include "ChunkLifecycle.h"
+#include "ChunkMeshConsumer.h"
 #include <mutex>
+#include <shared_mutex>
+#include <atomic>
 #include <glm/vec3.hpp>
 
 int pos3_hash(int x, int y, int z) noexcept;
 
 struct DrawCommand
 {
-	unsigned int offset = 0;
+	unsigned int offset = 0; // first face instance of mesh in face buffer of ChunkMeshConsumer
 	unsigned int facesCount[12]{0};
 
 	DrawCommand();
 
 	void resetFaces();
 	bool anyFaces() const;
+	unsigned int getFacesCount() const;
+	unsigned int getGroupOffset(size_t group) const; // first instance of faces group, groups are packed in facesCount order
 };
 
 struct Face
@@ -35,6 +46,8 @@ struct Face
 };
 
 class PhysicEntity;
+class ChunkColumnData;
+struct ChunkMesh;
 
 struct PhysicEntityCollider
 {
@@ -89,21 +102,27 @@ public:
 		uint8_t lighting;
 	};
 private:
-	Block blocks[Settings::CHUNK_SIZE_CUBED];
-	uint8_t lightingMap[Settings::CHUNK_SIZE_CUBED]; // sky lighting in left bits, source lighting in right bits
-	std::unordered_map<Block, Vector<uint16_t, Settings::CHUNK_SIZE_CUBED>> blockChanges;
+	PalettedBlockStorage blocks;
+	LightingStorage lightingMap; // sky lighting in left bits, source lighting in right bits
+	// meshing workers hold it shared while reading, every write to storage takes it exclusively
+	mutable std::shared_mutex storageMutex;
+	ChunkDelta blockChanges;
+	std::vector<LightUpdate> pendingLightingUpdates;
 
 	char getAO(int x, int y, int z, char side, const char* packOffsets) const;
 	char getAOandSmoothLighting(bool maxAO, int x, int y, int z, size_t side, const char* packOffsets, uint8_t* smoothLighting, const BlockAndLighting& centerBal) const;
 
+	Block setStoredBlock(size_t index, Block block);
+	void setStoredLighting(size_t index, uint8_t lighting);
+
+	// generation only, storage must be locked
 	void setBlockByIndexNoSave(size_t index, Block block);
 	void setBlockAtNoSave(size_t x, size_t y, size_t z, Block block);
-	void applyChanges();
-	bool isChunkClosed() const;
-	inline void fetchFaces();
-	void greedyMeshing();
+	void applyChanges(const std::vector<ChunkDelta::Run>& runs);
 	void updateLightingAt(size_t x, size_t y, size_t z, Block block, Block prevBlock);
-	static std::string getFilepath(int X, int Y, int Z);
+	void initSkyLighting(const ChunkColumnData* chunkColumnData); // storage must be locked
+	void publishBoundaryLighting(); // main thread
+	uint16_t calculateSideConnections() const; // storage must be locked
 public:
 	enum class State
 	{
@@ -113,10 +132,14 @@ public:
 		Loaded
 	};
 
-	static Face* facesData;
-	static FaceInstanceData* faceInstancesData;
-	static FaceInstancesVBO* faceInstancesVBO;
-	static std::unordered_map<int, Chunk*> chunkMap;
+	// per thread meshing scratch
+	thread_local static const Chunk* meshingChunks[27]; // surrounding chunks locked by lockSurroundingStorages, others are read as Void
+	thread_local static std::vector<Face> facesData;
+	thread_local static std::vector<FaceInstanceData> faceInstancesData;
+	thread_local static std::vector<uint16_t> faceMasks; // binary mesher: visible faces per column, bit is z
+	thread_local static std::vector<uint64_t> faceKeys; // binary mesher: packed texture, lighting and ao of visible faces
+	static ChunkIndex chunkMap;
+	static RegionStorage dataRegions; // saved block changes
 
 	static std::vector<LightPropagationNode> lightingFloodFillVector;
 	static std::vector<LightRemovalNode> darknessFloodFillVector;
@@ -124,13 +147,25 @@ public:
 	static std::mutex lightingFloodFillMutex;
 	static std::mutex darknessFloodFillMutex;
 	static std::mutex lightingUpdateMutex;
+	static std::vector<Chunk*> dirtyChunks; // chunks with changed cells, main thread turns them into remesh requests
+	static std::mutex dirtyChunksMutex;
 
 	State state = State::NotLoaded;
 	bool hasAnyFaces = false; // Removing it doesnt change class size
 	uint16_t blocksCount = 0;
+	unsigned int meshingID = 0; // main thread, meshes with other ID are outdated
+	uint16_t sideConnections = ChunkVisibility::ALL_SIDES_CONNECTED; // from last applied mesh, unmeshed chunks don't block view
+	unsigned int visibilityFrame = 0; // frame ChunkVisibility last reached this chunk
+	ChunkLifecycle::Timestamps lifecycle;
+	bool hasDirtyCells = false;
+	uint8_t dirtyMin[3]{0}, dirtyMax[3]{0}; // bounds of cells changed since chunk was put to dirtyChunks
+	std::atomic<bool> generationCancelled = false; // set by main thread when chunk leaves load radius while generating
 	int X, Y, Z;
+	unsigned int drawSlot = 0; // index of culling data, mesh itself is allocated by size
+	size_t chunkIndexPosition = 0; // maintained by chunkMap
 	DrawCommand drawCommand;
 	Chunk* neighbours[6];
+	Chunk* surroundingChunks[27]; // (dx + 1) + (dy + 1) * 3 + (dz + 1) * 9, lets meshing workers avoid chunkMap
 	Vector<const PhysicEntityCollider*, Settings::MAX_ENTITIES_PER_CHUNK> physicEntities;
 
 	Chunk();
@@ -138,35 +173,65 @@ public:
 	void setDrawID(unsigned int ID);
 	void init(int x, int y, int z);
 	void destroy();
+	void unlinkNeighbours();
+	void clearStorage(); // before chunk goes back to pool without destroy, changes aren't saved
 
 	void generateBlocks();
-	void generateFaces();
-	void updateFacesData() const;
+	void generateTerrain(const ChunkColumnData* chunkColumnData); // touches only this chunk, safe on worker threads
+	void finishLoading(); // main thread
+	void generateMesh(ChunkMesh& mesh, ChunkMeshConsumer* consumer) const; // doesn't touch GL, safe on worker threads, consumer may be nullptr
+	void applyMesh(const ChunkMesh& mesh); // main thread, only chunk state, faces are taken by ChunkMeshConsumer
+	// meshing reads neighbours only between these calls, lockedChunks must fit 27 chunks
+	size_t lockSurroundingStorages(const Chunk** lockedChunks) const;
+	static void unlockStorages(const Chunk** lockedChunks, size_t count);
+	bool isChunkClosed() const; // storages must be locked
+	bool isUniformSolid() const;
+	bool canSkipMeshing() const; // main thread, cheap check for chunks that can't have faces
+	void fetchFaces() const;
+	void greedyMeshing(unsigned int* facesCount) const;
+	void fetchFacesBinary() const;
+	void binaryGreedyMeshing(unsigned int* facesCount) const;
+	static void allocateMeshingBuffers();
+	static size_t getFacesOffset(size_t facesGroup, size_t count); // in faceInstancesData, groups are solid then transparent faces per side
+	size_t getAllocatedStorageSize() const;
 
 	Block getBlockAtInBoundaries(size_t x, size_t y, size_t z) const;
 	bool setBlockAtInBoundaries(size_t x, size_t y, size_t z, Block block);
-	Block getBlockAt(int x, int y, int z) const;
+	Block getBlockAt(int x, int y, int z) const; // meshing only, storages must be locked
 	Block getBlockAtSideCheck(int x, int y, int z, size_t side) const;
 
 	uint8_t getLightingAtInBoundaries(size_t x, size_t y, size_t z) const;
 	void setLightingAtInBoundaries(size_t x, size_t y, size_t z, uint8_t lightPower, bool lightOrSky);
+	void markDirty(size_t x, size_t y, size_t z); // only one thread may write chunk at a time
 	uint8_t getLightingAt(int x, int y, int z) const;
 	void setLightingAt(int x, int y, int z, uint8_t lightPower, bool lightOrSky);
 	uint8_t getLightingAtSideCheck(int x, int y, int z, size_t side) const;
 	void setLightingAtSideCheck(int x, int y, int z, size_t side, uint8_t lightPower, bool lightOrSky);
 
 	BlockAndLighting getBlockAndLightingAtInBoundaries(size_t x, size_t y, size_t z) const;
-	BlockAndLighting getBlockAndLightingAt(int x, int y, int z) const;
+	BlockAndLighting getBlockAndLightingAt(int x, int y, int z) const; // meshing only, storages must be locked
 	BlockAndLighting getBlockAndLightingAtSideCheck(int x, int y, int z, size_t side) const;
+	BlockAndLighting getBlockAndLightingAtMeshingSide(int x, int y, int z, size_t side) const; // meshing only, storages must be locked
 	
 	static Chunk* getChunkAt(int x, int y, int z);
+	Chunk* getSurroundingChunk(int chunkX, int chunkY, int chunkZ) const;
 	bool canSideBeSeen(const glm::vec3& position, size_t side) const;
 
-	int posHash() const;
 	static size_t getIndex(size_t x, size_t y, size_t z);
 	static SizeT3 getCoordinatesByIndex(size_t index);
-	static void loadData(std::unordered_map<Block, Vector<uint16_t, Settings::CHUNK_SIZE_CUBED>>& blockChanges, int X, int Y, int Z);
-	static void saveData(std::unordered_map<Block, Vector<uint16_t, Settings::CHUNK_SIZE_CUBED>>& blockChanges, int X, int Y, int Z);
+	static void loadData(std::vector<ChunkDelta::Run>& runs, int X, int Y, int Z);
+	static void saveData(const std::vector<ChunkDelta::Run>& runs, int X, int Y, int Z);
+};
+
+struct ChunkMesh
+{
+	Chunk* chunk = nullptr;
+	unsigned int meshingID = 0;
+	DrawCommand drawCommand;
+	std::vector<FaceInstanceData> faceInstances; // used when consumer gave no memory for faces
+	bool isStaged = false; // faces are in memory of ChunkMeshConsumer::allocateMeshFaces
+	size_t stagingOffset = 0;
+	uint16_t sideConnections = ChunkVisibility::ALL_SIDES_CONNECTED;
 };
 
 std::string toString(Chunk::State state);
\ No newline at end of file
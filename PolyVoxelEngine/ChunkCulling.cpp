@@ -0,0 +1,92 @@
+#include "ChunkCulling.h"
+#include "settings.h"
+#include <glm/glm.hpp>
+
+bool ChunkCulling::isChunkOnFrustum(int chunkX, int chunkY, int chunkZ, const glm::vec4* frustumPlanes)
+{
+	// same test as isBoxOnOrForwardPlane
+	glm::vec3 extents(Settings::HALF_CHUNK_SIZE);
+	glm::vec3 center = (glm::vec3(chunkX, chunkY, chunkZ) + 0.5f) * (float)Settings::CHUNK_SIZE;
+	for (size_t i = 0; i < 6; i++)
+	{
+		glm::vec3 normal(frustumPlanes[i]);
+		if (glm::dot(normal, center) + frustumPlanes[i].w < -glm::dot(extents, glm::abs(normal)))
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+bool ChunkCulling::isChunkOnFrustum(const ChunkCullingMeta& chunk, const glm::vec4* frustumPlanes)
+{
+	return isChunkOnFrustum(chunk.x, chunk.y, chunk.z, frustumPlanes);
+}
+
+bool ChunkCulling::canSideBeSeen(const ChunkCullingMeta& chunk, const glm::vec3& position, size_t side)
+{
+	// same test as Chunk::canSideBeSeen
+	int chunkPos[3] = { chunk.x, chunk.y, chunk.z };
+	size_t axis = side >> 1;
+	if (side & 1)
+	{
+		return position[axis] < (chunkPos[axis] + 1) * Settings::CHUNK_SIZE - 1;
+	}
+	return position[axis] > chunkPos[axis] * Settings::CHUNK_SIZE + 1;
+}
+
+size_t ChunkCulling::cullChunks(
+	const ChunkCullingMeta* chunks, size_t chunksCount, const unsigned int* visibleSlots,
+	const glm::vec4* frustumPlanes, const glm::vec3& position,
+	DrawArraysIndirectCommand* commands, unsigned int* positionIndexes, glm::vec3* positions, size_t& positionsCount
+)
+{
+	size_t commandsCount = 0;
+	positionsCount = 0;
+	for (size_t slot = 0; slot < chunksCount; slot++)
+	{
+		if (visibleSlots && !((visibleSlots[slot >> 5] >> (slot & 31)) & 1))
+		{
+			continue;
+		}
+
+		const ChunkCullingMeta& chunk = chunks[slot];
+		unsigned int facesCount = 0;
+		for (size_t side = 0; side < 6; side++)
+		{
+			facesCount += chunk.facesCount[side];
+		}
+		if (facesCount == 0 || !isChunkOnFrustum(chunk, frustumPlanes))
+		{
+			continue;
+		}
+
+		// faces of chunk are packed by side, solid sides first
+		bool anySide = false;
+		unsigned int nextBaseInstance = chunk.offset;
+		for (size_t side = 0; side < 6; side++)
+		{
+			unsigned int sideFacesCount = chunk.facesCount[side];
+			unsigned int baseInstance = nextBaseInstance;
+			nextBaseInstance += sideFacesCount;
+			if (sideFacesCount == 0 || !canSideBeSeen(chunk, position, side))
+			{
+				continue;
+			}
+
+			size_t index = commandsCount++;
+			DrawArraysIndirectCommand& command = commands[index];
+			command.count = 4;
+			command.first = 0;
+			command.instancesCount = sideFacesCount;
+			command.baseInstance = baseInstance;
+			positionIndexes[index] = (unsigned int)positionsCount;
+			anySide = true;
+		}
+		if (anySide)
+		{
+			positions[positionsCount++] = glm::vec3(chunk.x, chunk.y, chunk.z) * (float)Settings::CHUNK_SIZE;
+		}
+	}
+	return commandsCount;
+}
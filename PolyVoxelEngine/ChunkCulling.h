@@ -0,0 +1,33 @@
+#pragma once
+#include <cstddef>
+#include <glm/vec3.hpp>
+#include <glm/vec4.hpp>
+#include "DrawData.h"
+
+// chunk data of one draw slot, kept resident on GPU
+// layout matches ChunkCullingMeta in chunkCulling.comp (std430)
+struct ChunkCullingMeta
+{
+	int x = 0, y = 0, z = 0; // chunk coordinates
+	unsigned int offset = 0; // first face instance of chunk mesh, faces are packed in facesCount order
+	unsigned int facesCount[12]{0}; // solid faces per side, then transparent faces per side
+};
+
+// CPU reference of chunkCulling.comp, doesn't touch GL
+// frustum planes are xyz normal and w distance, point is in front of plane when dot(normal, point) + w >= 0
+class ChunkCulling
+{
+public:
+	static bool isChunkOnFrustum(int chunkX, int chunkY, int chunkZ, const glm::vec4* frustumPlanes);
+	static bool isChunkOnFrustum(const ChunkCullingMeta& chunk, const glm::vec4* frustumPlanes);
+	static bool canSideBeSeen(const ChunkCullingMeta& chunk, const glm::vec3& position, size_t side);
+
+	// solid faces only, every slot with visible side gets one position, commands of slot point at it
+	// visibleSlots has bit per slot, slots without it are skipped, nullptr keeps all
+	// output is in slot order, GPU output has the same commands in any order
+	static size_t cullChunks(
+		const ChunkCullingMeta* chunks, size_t chunksCount, const unsigned int* visibleSlots,
+		const glm::vec4* frustumPlanes, const glm::vec3& position,
+		DrawArraysIndirectCommand* commands, unsigned int* positionIndexes, glm::vec3* positions, size_t& positionsCount
+	);
+};
@@ -0,0 +1,289 @@
+#include "ChunkDelta.h"
+#include <iostream>
+#include <algorithm>
+#include <cstring>
+
+// high bit separates it from old format, which starts with block size
+static constexpr uint8_t DELTA_FORMAT = 0x80 | 2;
+static constexpr uint8_t RUNS_ENCODING = 0;
+static constexpr uint8_t MASK_ENCODING = 1;
+static constexpr size_t MASK_BYTES = Settings::CHUNK_SIZE_CUBED / 8;
+
+void ChunkDelta::markEdited(size_t index)
+{
+	if (editedMask.empty())
+	{
+		editedMask.resize(MASK_WORDS, 0);
+	}
+	editedMask[index >> 6] |= 1ull << (index & 63);
+}
+
+bool ChunkDelta::isEdited(size_t index) const
+{
+	if (editedMask.empty())
+	{
+		return false;
+	}
+	return (editedMask[index >> 6] >> (index & 63)) & 1;
+}
+
+bool ChunkDelta::isEmpty() const
+{
+	return editedMask.empty();
+}
+
+void ChunkDelta::clear()
+{
+	editedMask.clear();
+}
+
+static void writeVarint(std::vector<char>& data, size_t value)
+{
+	while (value >= 0x80)
+	{
+		data.push_back((char)((value & 0x7F) | 0x80));
+		value >>= 7;
+	}
+	data.push_back((char)value);
+}
+
+void ChunkDelta::encode(const std::vector<Run>& runs, std::vector<char>& data)
+{
+	data.clear();
+	if (runs.empty())
+	{
+		return;
+	}
+
+	// group by block, stable sort keeps runs of one block sorted by start
+	thread_local static std::vector<Run> sortedRuns;
+	thread_local static std::vector<char> runsData;
+	sortedRuns.assign(runs.begin(), runs.end());
+	std::stable_sort(sortedRuns.begin(), sortedRuns.end(), [](const Run& a, const Run& b)
+		{
+			return a.block < b.block;
+		}
+	);
+
+	data.push_back((char)DELTA_FORMAT);
+	data.push_back(0); // groups count
+	uint8_t groupsCount = 0;
+
+	size_t groupStart = 0;
+	while (groupStart < sortedRuns.size())
+	{
+		Block block = sortedRuns[groupStart].block;
+		size_t groupEnd = groupStart + 1;
+		while (groupEnd < sortedRuns.size() && sortedRuns[groupEnd].block == block)
+		{
+			groupEnd++;
+		}
+
+		runsData.clear();
+		writeVarint(runsData, groupEnd - groupStart);
+		size_t prevEnd = 0;
+		for (size_t i = groupStart; i < groupEnd; i++)
+		{
+			const Run& run = sortedRuns[i];
+			writeVarint(runsData, run.start - prevEnd);
+			writeVarint(runsData, run.length - 1);
+			prevEnd = run.start + run.length;
+		}
+
+		data.push_back((char)block);
+		if (runsData.size() <= MASK_BYTES)
+		{
+			data.push_back((char)RUNS_ENCODING);
+			data.insert(data.end(), runsData.begin(), runsData.end());
+		}
+		else
+		{
+			// dense edits
+			uint64_t mask[MASK_WORDS]{0};
+			for (size_t i = groupStart; i < groupEnd; i++)
+			{
+				const Run& run = sortedRuns[i];
+				for (size_t index = run.start; index < run.start + run.length; index++)
+				{
+					mask[index >> 6] |= 1ull << (index & 63);
+				}
+			}
+			data.push_back((char)MASK_ENCODING);
+			const char* bytes = reinterpret_cast<const char*>(mask);
+			data.insert(data.end(), bytes, bytes + MASK_BYTES);
+		}
+
+		groupsCount++;
+		groupStart = groupEnd;
+	}
+
+	data[1] = (char)groupsCount;
+}
+
+bool ChunkDelta::decode(const std::vector<char>& data, std::vector<Run>& runs)
+{
+	runs.clear();
+	if (data.empty())
+	{
+		return true;
+	}
+
+	size_t position = 0;
+	auto read = [&](void* dst, size_t size)
+		{
+			if (position + size > data.size())
+			{
+				return false;
+			}
+			memcpy(dst, data.data() + position, size);
+			position += size;
+			return true;
+		};
+	auto readVarint = [&](size_t& value)
+		{
+			value = 0;
+			for (size_t shift = 0; shift < 21; shift += 7)
+			{
+				if (position >= data.size())
+				{
+					return false;
+				}
+				uint8_t byte = (uint8_t)data[position++];
+				value |= (size_t)(byte & 0x7F) << shift;
+				if ((byte & 0x80) == 0)
+				{
+					return true;
+				}
+			}
+			return false;
+		};
+
+	uint8_t format = (uint8_t)data[position++];
+
+	// old format
+	if (format != DELTA_FORMAT)
+	{
+		size_t sizeOfBlock = format;
+		uint32_t mapSize = 0;
+		if (sizeOfBlock == 0 || sizeOfBlock > sizeof(mapSize) || !read(&mapSize, sizeOfBlock))
+		{
+			std::cerr << "ChunkDelta::decode: corrupted data" << std::endl;
+			return false;
+		}
+
+		for (uint32_t i = 0; i < mapSize; i++)
+		{
+			uint16_t count = 0;
+			uint32_t block = 0;
+			if (!read(&count, sizeof(count)) || count > Settings::CHUNK_SIZE_CUBED || !read(&block, sizeOfBlock) || block >= (uint32_t)Block::Count)
+			{
+				std::cerr << "ChunkDelta::decode: corrupted data" << std::endl;
+				return false;
+			}
+			for (uint16_t j = 0; j < count; j++)
+			{
+				uint16_t index = 0;
+				if (!read(&index, sizeof(index)) || index >= Settings::CHUNK_SIZE_CUBED)
+				{
+					std::cerr << "ChunkDelta::decode: corrupted data" << std::endl;
+					return false;
+				}
+				runs.push_back({ index, 1, (Block)block });
+			}
+		}
+		return true;
+	}
+
+	uint8_t groupsCount = 0;
+	if (!read(&groupsCount, 1))
+	{
+		std::cerr << "ChunkDelta::decode: corrupted data" << std::endl;
+		return false;
+	}
+
+	for (uint8_t i = 0; i < groupsCount; i++)
+	{
+		uint8_t block = 0;
+		uint8_t encoding = 0;
+		if (!read(&block, 1) || block >= (uint8_t)Block::Count || !read(&encoding, 1))
+		{
+			std::cerr << "ChunkDelta::decode: corrupted data" << std::endl;
+			return false;
+		}
+
+		if (encoding == RUNS_ENCODING)
+		{
+			size_t runsCount = 0;
+			if (!readVarint(runsCount) || runsCount > Settings::CHUNK_SIZE_CUBED)
+			{
+				std::cerr << "ChunkDelta::decode: corrupted data" << std::endl;
+				return false;
+			}
+
+			size_t prevEnd = 0;
+			for (size_t j = 0; j < runsCount; j++)
+			{
+				size_t gap = 0;
+				size_t length = 0;
+				if (!readVarint(gap) || !readVarint(length))
+				{
+					std::cerr << "ChunkDelta::decode: corrupted data" << std::endl;
+					return false;
+				}
+				size_t start = prevEnd + gap;
+				length++;
+				if (start + length > Settings::CHUNK_SIZE_CUBED)
+				{
+					std::cerr << "ChunkDelta::decode: corrupted data" << std::endl;
+					return false;
+				}
+				runs.push_back({ (uint16_t)start, (uint16_t)length, (Block)block });
+				prevEnd = start + length;
+			}
+		}
+		else if (encoding == MASK_ENCODING)
+		{
+			uint64_t mask[MASK_WORDS];
+			if (!read(mask, MASK_BYTES))
+			{
+				std::cerr << "ChunkDelta::decode: corrupted data" << std::endl;
+				return false;
+			}
+
+			// bits into runs
+			size_t runStart = 0;
+			size_t runLength = 0;
+			for (size_t word = 0; word < MASK_WORDS; word++)
+			{
+				uint64_t bits = mask[word];
+				while (bits)
+				{
+					size_t index = (word << 6) | (size_t)std::countr_zero(bits);
+					bits &= bits - 1;
+
+					if (runLength > 0 && runStart + runLength == index)
+					{
+						runLength++;
+						continue;
+					}
+					if (runLength > 0)
+					{
+						runs.push_back({ (uint16_t)runStart, (uint16_t)runLength, (Block)block });
+					}
+					runStart = index;
+					runLength = 1;
+				}
+			}
+			if (runLength > 0)
+			{
+				runs.push_back({ (uint16_t)runStart, (uint16_t)runLength, (Block)block });
+			}
+		}
+		else
+		{
+			std::cerr << "ChunkDelta::decode: unknown encoding " << (int)encoding << std::endl;
+			return false;
+		}
+	}
+	return true;
+}
@@ -0,0 +1,67 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+#include <bit>
+#include "Block.h"
+#include "settings.h"
+
+// player changes of chunk
+// only mask of edited cells is kept, edited blocks are taken from chunk (or any other block source) when saving
+// encoded format: format byte, groups count, per block type: block, encoding, cells as runs (varint gap and length) or bit mask
+// old format (block size byte, then index list per block type) is still decoded
+class ChunkDelta
+{
+	static constexpr size_t MASK_WORDS = Settings::CHUNK_SIZE_CUBED / 64;
+
+	std::vector<uint64_t> editedMask; // allocated on first edit
+public:
+	struct Run
+	{
+		uint16_t start = 0;
+		uint16_t length = 0;
+		Block block = Block::Air;
+	};
+
+	void markEdited(size_t index);
+	bool isEdited(size_t index) const;
+	bool isEmpty() const;
+	void clear();
+
+	// runs are sorted by start, neighbour cells with same block are merged
+	template<typename GetBlock>
+	void collectRuns(std::vector<Run>& runs, GetBlock getBlock) const
+	{
+		runs.clear();
+		if (editedMask.empty())
+		{
+			return;
+		}
+
+		for (size_t word = 0; word < MASK_WORDS; word++)
+		{
+			uint64_t bits = editedMask[word];
+			while (bits)
+			{
+				size_t index = (word << 6) | (size_t)std::countr_zero(bits);
+				bits &= bits - 1;
+
+				Block block = getBlock(index);
+				if (!runs.empty())
+				{
+					Run& last = runs.back();
+					if (last.block == block && (size_t)last.start + last.length == index)
+					{
+						last.length++;
+						continue;
+					}
+				}
+				runs.push_back({ (uint16_t)index, 1, block });
+			}
+		}
+	}
+
+	// runs must be sorted by start
+	static void encode(const std::vector<Run>& runs, std::vector<char>& data);
+	// runs are sorted only inside one block type, returns false if data is corrupted (decoded runs are kept)
+	static bool decode(const std::vector<char>& data, std::vector<Run>& runs);
+};
@@ -0,0 +1,164 @@
+#include "ChunkIndex.h"
+#include "Chunk.h"
+#include <iostream>
+#include <algorithm>
+
+ChunkIndex::~ChunkIndex()
+{
+	delete[] grid;
+}
+
+void ChunkIndex::init(int radius)
+{
+	// every chunk within radius of loader gets own slot
+	int side = 1;
+	gridShift = 0;
+	while (side < radius * 2 + 2)
+	{
+		side <<= 1;
+		gridShift++;
+	}
+	gridMask = side - 1;
+
+	delete[] grid;
+	grid = new Chunk*[(size_t)side * side * side]();
+
+	std::vector<Chunk*> prevChunks;
+	prevChunks.swap(chunks);
+	fallbackMap.clear();
+	for (Chunk* chunk : prevChunks)
+	{
+		insert(chunk);
+	}
+}
+
+size_t ChunkIndex::getGridIndex(int x, int y, int z) const
+{
+	return (size_t)(x & gridMask) | ((size_t)(y & gridMask) << gridShift) | ((size_t)(z & gridMask) << (gridShift << 1));
+}
+
+Chunk* ChunkIndex::find(int x, int y, int z) const
+{
+	if (grid)
+	{
+		Chunk* chunk = grid[getGridIndex(x, y, z)];
+		if (chunk && chunk->X == x && chunk->Y == y && chunk->Z == z)
+		{
+			return chunk;
+		}
+	}
+	if (fallbackMap.empty())
+	{
+		return nullptr;
+	}
+
+	const auto& it = fallbackMap.find(getKey(x, y, z));
+	if (it == fallbackMap.end())
+	{
+		return nullptr;
+	}
+	// key keeps 21 bits per axis, far chunks may share it, so coordinates are compared like for grid
+	Chunk* chunk = it->second;
+	if (chunk->X != x || chunk->Y != y || chunk->Z != z)
+	{
+		return nullptr;
+	}
+	return chunk;
+}
+
+void ChunkIndex::insert(Chunk* chunk)
+{
+	chunk->chunkIndexPosition = chunks.size();
+	chunks.push_back(chunk);
+
+	if (grid)
+	{
+		Chunk*& slot = grid[getGridIndex(chunk->X, chunk->Y, chunk->Z)];
+		if (slot == nullptr)
+		{
+			slot = chunk;
+			return;
+		}
+	}
+	fallbackMap[getKey(chunk->X, chunk->Y, chunk->Z)] = chunk;
+}
+
+void ChunkIndex::erase(Chunk* chunk)
+{
+	size_t position = chunk->chunkIndexPosition;
+	if (position >= chunks.size() || chunks[position] != chunk)
+	{
+		std::cerr << "Chunk isn't in chunk index" << std::endl;
+		return;
+	}
+	chunks[position] = chunks.back();
+	chunks[position]->chunkIndexPosition = position;
+	chunks.pop_back();
+
+	if (grid)
+	{
+		size_t gridIndex = getGridIndex(chunk->X, chunk->Y, chunk->Z);
+		Chunk*& slot = grid[gridIndex];
+		if (slot == chunk)
+		{
+			slot = nullptr;
+
+			// move colliding chunk from fallback into freed slot
+			for (auto it = fallbackMap.begin(); it != fallbackMap.end(); it++)
+			{
+				Chunk* fallbackChunk = it->second;
+				if (getGridIndex(fallbackChunk->X, fallbackChunk->Y, fallbackChunk->Z) == gridIndex)
+				{
+					slot = fallbackChunk;
+					fallbackMap.erase(it);
+					break;
+				}
+			}
+			return;
+		}
+	}
+	fallbackMap.erase(getKey(chunk->X, chunk->Y, chunk->Z));
+}
+
+void ChunkIndex::clear()
+{
+	if (grid)
+	{
+		size_t side = (size_t)gridMask + 1;
+		std::fill(grid, grid + side * side * side, nullptr);
+	}
+	fallbackMap.clear();
+	chunks.clear();
+}
+
+size_t ChunkIndex::size() const
+{
+	return chunks.size();
+}
+
+size_t ChunkIndex::getFallbackSize() const
+{
+	return fallbackMap.size();
+}
+
+std::vector<Chunk*>::const_iterator ChunkIndex::begin() const
+{
+	return chunks.begin();
+}
+
+std::vector<Chunk*>::const_iterator ChunkIndex::end() const
+{
+	return chunks.end();
+}
+
+Chunk* ChunkIndex::operator[](size_t index) const
+{
+	return chunks[index];
+}
+
+uint64_t ChunkIndex::getKey(int x, int y, int z)
+{
+	// 21 bits per axis
+	constexpr uint64_t mask = (1ull << 21) - 1;
+	return ((uint64_t)x & mask) | (((uint64_t)y & mask) << 21) | (((uint64_t)z & mask) << 42);
+}
@@ -0,0 +1,43 @@
+#pragma once
+#include <unordered_map>
+#include <vector>
+#include <cstdint>
+
+class Chunk;
+
+// chunk lookup by chunk coordinates
+// chunks are kept in toroidal 3d grid (coordinates are wrapped by mask), grid slot stores chunk only if it is free
+// chunks that collide with occupied slot (far from loader, still loading) are kept in map with full 64-bit key
+class ChunkIndex
+{
+	Chunk** grid = nullptr;
+	int gridMask = 0;
+	int gridShift = 0;
+	std::unordered_map<uint64_t, Chunk*> fallbackMap;
+	std::vector<Chunk*> chunks;
+
+	size_t getGridIndex(int x, int y, int z) const;
+public:
+	ChunkIndex() = default;
+	~ChunkIndex();
+
+	ChunkIndex(const ChunkIndex&) = delete;
+	ChunkIndex& operator=(const ChunkIndex&) = delete;
+
+	void init(int radius);
+
+	Chunk* find(int x, int y, int z) const;
+	void insert(Chunk* chunk);
+	void erase(Chunk* chunk);
+	void clear();
+
+	size_t size() const;
+	size_t getFallbackSize() const;
+
+	// chunks in no particular order, erase moves last chunk into erased position
+	std::vector<Chunk*>::const_iterator begin() const;
+	std::vector<Chunk*>::const_iterator end() const;
+	Chunk* operator[](size_t index) const;
+
+	static uint64_t getKey(int x, int y, int z);
+};
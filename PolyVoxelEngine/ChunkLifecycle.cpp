@@ -0,0 +1,143 @@
+#include "ChunkLifecycle.h"
+#include <algorithm>
+#include <bit>
+#include <chrono>
+#include <iomanip>
+#include <string>
+
+std::vector<uint32_t> ChunkLifecycle::samples[STAGES_COUNT];
+uint64_t ChunkLifecycle::samplesCount[STAGES_COUNT] = {};
+
+int64_t ChunkLifecycle::getTimeNS()
+{
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void ChunkLifecycle::queued(Timestamps& timestamps)
+{
+	timestamps.queuedNS = getTimeNS();
+	timestamps.recordedStages = 0;
+}
+
+void ChunkLifecycle::record(Timestamps& timestamps, Stage stage)
+{
+	uint8_t bit = 1 << (size_t)stage;
+	if (timestamps.queuedNS == 0 || (timestamps.recordedStages & bit))
+	{
+		return;
+	}
+	timestamps.recordedStages |= bit;
+
+	int64_t latencyUS = (getTimeNS() - timestamps.queuedNS) / 1000;
+	uint32_t sample = (uint32_t)std::clamp<int64_t>(latencyUS, 0, UINT32_MAX);
+
+	std::vector<uint32_t>& stageSamples = samples[(size_t)stage];
+	uint64_t& count = samplesCount[(size_t)stage];
+	if (stageSamples.size() < SAMPLES_PER_STAGE)
+	{
+		stageSamples.push_back(sample);
+	}
+	else
+	{
+		stageSamples[count % SAMPLES_PER_STAGE] = sample;
+	}
+	count++;
+}
+
+const char* ChunkLifecycle::getStageName(Stage stage)
+{
+	switch (stage)
+	{
+	case Stage::Loading: return "Loading";
+	case Stage::Loaded: return "Loaded";
+	case Stage::Meshing: return "Meshing";
+	case Stage::Meshed: return "Meshed";
+	case Stage::Drawn: return "Drawn";
+	default: return "Unknown";
+	}
+}
+
+size_t ChunkLifecycle::getSamplesCount(Stage stage)
+{
+	return samples[(size_t)stage].size();
+}
+
+uint32_t ChunkLifecycle::getPercentile(Stage stage, float percentile)
+{
+	const std::vector<uint32_t>& stageSamples = samples[(size_t)stage];
+	if (stageSamples.empty())
+	{
+		return 0;
+	}
+
+	thread_local static std::vector<uint32_t> sorted;
+	sorted = stageSamples;
+	size_t index = std::min((size_t)(percentile * sorted.size()), sorted.size() - 1);
+	std::nth_element(sorted.begin(), sorted.begin() + index, sorted.end());
+	return sorted[index];
+}
+
+void ChunkLifecycle::report(std::ostream& stream)
+{
+	std::ios::fmtflags flags = stream.flags();
+	std::streamsize precision = stream.precision();
+	stream << "Chunk latency since queued, ms (latest " << SAMPLES_PER_STAGE << " loads)" << std::endl;
+	stream << std::left << std::setw(10) << "stage"
+		<< std::right << std::setw(10) << "samples"
+		<< std::setw(10) << "p50"
+		<< std::setw(10) << "p90"
+		<< std::setw(10) << "p99"
+		<< std::setw(10) << "max" << std::endl;
+
+	stream << std::fixed << std::setprecision(1);
+	for (size_t i = 0; i < STAGES_COUNT; i++)
+	{
+		Stage stage = (Stage)i;
+		const std::vector<uint32_t>& stageSamples = samples[i];
+		uint32_t maxSample = stageSamples.empty() ? 0 : *std::max_element(stageSamples.begin(), stageSamples.end());
+		stream << std::left << std::setw(10) << getStageName(stage)
+			<< std::right << std::setw(10) << stageSamples.size()
+			<< std::setw(10) << getPercentile(stage, 0.5f) * 1e-3f
+			<< std::setw(10) << getPercentile(stage, 0.9f) * 1e-3f
+			<< std::setw(10) << getPercentile(stage, 0.99f) * 1e-3f
+			<< std::setw(10) << maxSample * 1e-3f << std::endl;
+	}
+
+	// histogram of last stage, bucket n holds [2^(n-1), 2^n) ms
+	const std::vector<uint32_t>& drawnSamples = samples[(size_t)Stage::Drawn];
+	if (!drawnSamples.empty())
+	{
+		size_t buckets[HISTOGRAM_BUCKETS_COUNT] = {};
+		for (uint32_t sample : drawnSamples)
+		{
+			uint32_t ms = sample / 1000;
+			size_t bucket = ms == 0 ? 0 : std::min((size_t)std::bit_width(ms), HISTOGRAM_BUCKETS_COUNT - 1);
+			buckets[bucket]++;
+		}
+		size_t maxBucket = *std::max_element(std::begin(buckets), std::end(buckets));
+
+		stream << "Drawn latency histogram, ms" << std::endl;
+		for (size_t i = 0; i < HISTOGRAM_BUCKETS_COUNT; i++)
+		{
+			if (buckets[i] == 0)
+			{
+				continue;
+			}
+			size_t from = i == 0 ? 0 : (size_t)1 << (i - 1);
+			std::string range = i == HISTOGRAM_BUCKETS_COUNT - 1 ? std::to_string(from) + "+" : std::to_string(from) + "-" + std::to_string((size_t)1 << i);
+			stream << std::right << std::setw(12) << range << std::setw(8) << buckets[i] << " "
+				<< std::string(buckets[i] * 40 / maxBucket, '#') << std::endl;
+		}
+	}
+	stream.flags(flags);
+	stream.precision(precision);
+}
+
+void ChunkLifecycle::reset()
+{
+	for (size_t i = 0; i < STAGES_COUNT; i++)
+	{
+		samples[i].clear();
+		samplesCount[i] = 0;
+	}
+}
@@ -0,0 +1,45 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <vector>
+
+// latency of chunk stages since chunk was pushed to generation queue, main thread only
+// every stage is recorded once per load, later remeshing and redrawing don't count
+class ChunkLifecycle
+{
+public:
+	enum class Stage : uint8_t
+	{
+		Loading, // taken from generation queue
+		Loaded, // generated chunk processed by main thread
+		Meshing, // first mesh task started
+		Meshed, // first mesh uploaded
+		Drawn, // first frame chunk passed culling
+		Count
+	};
+
+	struct Timestamps
+	{
+		int64_t queuedNS = 0; // 0 - not queued, nothing is recorded
+		uint8_t recordedStages = 0;
+	};
+private:
+	static constexpr size_t STAGES_COUNT = (size_t)Stage::Count;
+	static constexpr size_t SAMPLES_PER_STAGE = 4096; // only latest loads are kept
+	static constexpr size_t HISTOGRAM_BUCKETS_COUNT = 14; // below 1 ms, then powers of two up to 4 s
+
+	static std::vector<uint32_t> samples[STAGES_COUNT]; // microseconds, ring
+	static uint64_t samplesCount[STAGES_COUNT];
+
+	static int64_t getTimeNS();
+public:
+	static void queued(Timestamps& timestamps);
+	static void record(Timestamps& timestamps, Stage stage);
+
+	static const char* getStageName(Stage stage);
+	static size_t getSamplesCount(Stage stage);
+	static uint32_t getPercentile(Stage stage, float percentile); // microseconds, 0 without samples
+	static void report(std::ostream& stream); // p50/p90/p99 and histogram of every stage
+	static void reset();
+};
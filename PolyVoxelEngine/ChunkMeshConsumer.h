@@ -0,0 +1,23 @@
+#pragma once
+#include <cstddef>
+#include "DrawData.h"
+
+class Chunk;
+struct ChunkMesh;
+
+// receives chunk meshes from World, so World doesn't depend on GL and runs without it when no consumer is set
+// main thread, except allocateMeshFaces that is called by meshing workers
+class ChunkMeshConsumer
+{
+public:
+	virtual ~ChunkMeshConsumer() = default;
+
+	// memory for faces of mesh being built, nullptr keeps them in ChunkMesh::faceInstances
+	virtual FaceInstanceData* allocateMeshFaces(size_t count, size_t& offset) = 0;
+	// World is done with mesh whose faces were allocated, called for applied and outdated meshes
+	virtual void releaseMeshFaces(size_t offset) = 0;
+
+	virtual void freeChunkMesh(Chunk* chunk) = 0; // chunk still has faces counts of old mesh, they are reset after this call
+	virtual void applyChunkMesh(Chunk* chunk, const ChunkMesh& mesh) = 0; // after Chunk::applyMesh, also for meshes without faces
+	virtual void unloadChunk(Chunk* chunk) = 0; // after freeChunkMesh, draw slot of chunk will be given to other chunk
+};
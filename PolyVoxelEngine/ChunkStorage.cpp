@@ -0,0 +1,251 @@
+#include "ChunkStorage.h"
+#include <iostream>
+#include <cstring>
+
+static uint8_t getBitsForPaletteSize(size_t paletteSize)
+{
+	if (paletteSize <= 1)
+	{
+		return 0;
+	}
+	uint8_t bits = 1;
+	while (((size_t)1 << bits) < paletteSize)
+	{
+		bits <<= 1;
+	}
+	return bits;
+}
+
+static size_t getWordsCount(uint8_t bitsPerBlock)
+{
+	return Settings::CHUNK_SIZE_CUBED * bitsPerBlock / 64;
+}
+
+PalettedBlockStorage::PalettedBlockStorage()
+{
+	fill(Block::Air);
+}
+
+PalettedBlockStorage::~PalettedBlockStorage()
+{
+	delete[] data;
+}
+
+void PalettedBlockStorage::setPaletteIndex(size_t index, uint8_t paletteIndex)
+{
+	size_t bitIndex = index * bitsPerBlock;
+	uint64_t& word = data[bitIndex >> 6];
+	size_t shift = bitIndex & 63;
+	uint64_t mask = (((uint64_t)1 << bitsPerBlock) - 1) << shift;
+	word = (word & ~mask) | ((uint64_t)paletteIndex << shift);
+}
+
+uint8_t PalettedBlockStorage::addToPalette(Block block)
+{
+	// reuse entry of block that isn't in chunk anymore
+	for (uint8_t i = 0; i < paletteSize; i++)
+	{
+		Block paletteBlock = palette[i];
+		if (blockCounts[(size_t)paletteBlock] == 0)
+		{
+			paletteIndexes[(size_t)paletteBlock] = NO_PALETTE_INDEX;
+			palette[i] = block;
+			paletteIndexes[(size_t)block] = i;
+			return i;
+		}
+	}
+
+	uint8_t newBitsPerBlock = getBitsForPaletteSize(paletteSize + 1);
+	if (newBitsPerBlock != bitsPerBlock)
+	{
+		resize(newBitsPerBlock);
+	}
+
+	uint8_t paletteIndex = paletteSize++;
+	palette[paletteIndex] = block;
+	paletteIndexes[(size_t)block] = paletteIndex;
+	return paletteIndex;
+}
+
+void PalettedBlockStorage::resize(uint8_t newBitsPerBlock)
+{
+	uint64_t* newData = nullptr;
+	if (newBitsPerBlock > 0)
+	{
+		newData = new uint64_t[getWordsCount(newBitsPerBlock)]();
+		if (bitsPerBlock > 0)
+		{
+			for (size_t index = 0; index < Settings::CHUNK_SIZE_CUBED; index++)
+			{
+				size_t bitIndex = index * newBitsPerBlock;
+				newData[bitIndex >> 6] |= (uint64_t)getPaletteIndex(index) << (bitIndex & 63);
+			}
+		}
+	}
+
+	delete[] data;
+	data = newData;
+	bitsPerBlock = newBitsPerBlock;
+}
+
+void PalettedBlockStorage::getBlocks(size_t start, size_t count, Block* result) const
+{
+	if (bitsPerBlock == 0)
+	{
+		for (size_t i = 0; i < count; i++)
+		{
+			result[i] = palette[0];
+		}
+		return;
+	}
+	for (size_t i = 0; i < count; i++)
+	{
+		result[i] = palette[getPaletteIndex(start + i)];
+	}
+}
+
+Block PalettedBlockStorage::set(size_t index, Block block)
+{
+	Block prevBlock = get(index);
+	if (prevBlock == block)
+	{
+		return prevBlock;
+	}
+
+	uint8_t paletteIndex = paletteIndexes[(size_t)block];
+	if (paletteIndex == NO_PALETTE_INDEX)
+	{
+		paletteIndex = addToPalette(block);
+	}
+	setPaletteIndex(index, paletteIndex);
+
+	blockCounts[(size_t)prevBlock]--;
+	blockCounts[(size_t)block]++;
+	return prevBlock;
+}
+
+void PalettedBlockStorage::fill(Block block)
+{
+	delete[] data;
+	data = nullptr;
+	bitsPerBlock = 0;
+
+	memset(paletteIndexes, NO_PALETTE_INDEX, sizeof(paletteIndexes));
+	memset(blockCounts, 0, sizeof(blockCounts));
+	palette[0] = block;
+	paletteSize = 1;
+	paletteIndexes[(size_t)block] = 0;
+	blockCounts[(size_t)block] = Settings::CHUNK_SIZE_CUBED;
+}
+
+void PalettedBlockStorage::compact()
+{
+	// drop blocks that aren't in chunk anymore and use smallest index size
+	uint8_t newPaletteIndexes[(size_t)Block::Count];
+	Block newPalette[(size_t)Block::Count];
+	uint8_t newPaletteSize = 0;
+	memset(newPaletteIndexes, NO_PALETTE_INDEX, sizeof(newPaletteIndexes));
+	for (uint8_t i = 0; i < paletteSize; i++)
+	{
+		Block block = palette[i];
+		if (blockCounts[(size_t)block] > 0)
+		{
+			newPaletteIndexes[(size_t)block] = newPaletteSize;
+			newPalette[newPaletteSize++] = block;
+		}
+	}
+
+	if (newPaletteSize == paletteSize)
+	{
+		return;
+	}
+	if (newPaletteSize == 1)
+	{
+		fill(newPalette[0]);
+		return;
+	}
+
+	uint8_t newBitsPerBlock = getBitsForPaletteSize(newPaletteSize);
+	uint64_t* newData = new uint64_t[getWordsCount(newBitsPerBlock)]();
+	for (size_t index = 0; index < Settings::CHUNK_SIZE_CUBED; index++)
+	{
+		uint8_t paletteIndex = newPaletteIndexes[(size_t)palette[getPaletteIndex(index)]];
+		size_t bitIndex = index * newBitsPerBlock;
+		newData[bitIndex >> 6] |= (uint64_t)paletteIndex << (bitIndex & 63);
+	}
+
+	delete[] data;
+	data = newData;
+	bitsPerBlock = newBitsPerBlock;
+	paletteSize = newPaletteSize;
+	memcpy(palette, newPalette, sizeof(palette));
+	memcpy(paletteIndexes, newPaletteIndexes, sizeof(paletteIndexes));
+}
+
+bool PalettedBlockStorage::isUniform() const
+{
+	return bitsPerBlock == 0;
+}
+
+uint8_t PalettedBlockStorage::getBitsPerBlock() const
+{
+	return bitsPerBlock;
+}
+
+size_t PalettedBlockStorage::getAllocatedSize() const
+{
+	return getWordsCount(bitsPerBlock) * sizeof(uint64_t);
+}
+
+LightingStorage::~LightingStorage()
+{
+	delete[] data;
+}
+
+void LightingStorage::set(size_t index, uint8_t value)
+{
+	if (data == nullptr)
+	{
+		if (value == uniformValue)
+		{
+			return;
+		}
+		data = new uint8_t[Settings::CHUNK_SIZE_CUBED];
+		memset(data, uniformValue, Settings::CHUNK_SIZE_CUBED);
+	}
+	data[index] = value;
+}
+
+void LightingStorage::fill(uint8_t value)
+{
+	delete[] data;
+	data = nullptr;
+	uniformValue = value;
+}
+
+void LightingStorage::compact()
+{
+	if (data == nullptr)
+	{
+		return;
+	}
+	uint8_t value = data[0];
+	for (size_t i = 1; i < Settings::CHUNK_SIZE_CUBED; i++)
+	{
+		if (data[i] != value)
+		{
+			return;
+		}
+	}
+	fill(value);
+}
+
+bool LightingStorage::isUniform() const
+{
+	return data == nullptr;
+}
+
+size_t LightingStorage::getAllocatedSize() const
+{
+	return data == nullptr ? 0 : Settings::CHUNK_SIZE_CUBED;
+}
@@ -0,0 +1,83 @@
+#pragma once
+#include "settings.h"
+#include "Block.h"
+
+// blocks are stored as indexes into small palette
+// 0 bits per block means that chunk is filled with single block and no index array is allocated
+class PalettedBlockStorage
+{
+	static constexpr uint8_t NO_PALETTE_INDEX = 255;
+
+	uint64_t* data = nullptr;
+	uint8_t bitsPerBlock = 0;
+	uint8_t paletteSize = 1;
+	Block palette[(size_t)Block::Count];
+	uint8_t paletteIndexes[(size_t)Block::Count];
+	uint16_t blockCounts[(size_t)Block::Count];
+
+	uint8_t getPaletteIndex(size_t index) const;
+	void setPaletteIndex(size_t index, uint8_t paletteIndex);
+	uint8_t addToPalette(Block block);
+	void resize(uint8_t newBitsPerBlock);
+public:
+	PalettedBlockStorage();
+	~PalettedBlockStorage();
+
+	PalettedBlockStorage(const PalettedBlockStorage&) = delete;
+	PalettedBlockStorage& operator=(const PalettedBlockStorage&) = delete;
+
+	Block get(size_t index) const;
+	void getBlocks(size_t start, size_t count, Block* result) const;
+	Block set(size_t index, Block block);
+	void fill(Block block);
+	void compact();
+
+	bool isUniform() const;
+	uint8_t getBitsPerBlock() const;
+	size_t getAllocatedSize() const;
+};
+
+// lighting array is allocated only when chunk lighting isn't uniform
+class LightingStorage
+{
+	uint8_t* data = nullptr;
+	uint8_t uniformValue = 0;
+public:
+	LightingStorage() = default;
+	~LightingStorage();
+
+	LightingStorage(const LightingStorage&) = delete;
+	LightingStorage& operator=(const LightingStorage&) = delete;
+
+	uint8_t get(size_t index) const;
+	void set(size_t index, uint8_t value);
+	void fill(uint8_t value);
+	void compact();
+
+	bool isUniform() const;
+	size_t getAllocatedSize() const;
+};
+
+inline uint8_t PalettedBlockStorage::getPaletteIndex(size_t index) const
+{
+	size_t bitIndex = index * bitsPerBlock; // bitsPerBlock is power of two, so index never crosses words
+	return uint8_t(data[bitIndex >> 6] >> (bitIndex & 63)) & uint8_t((1u << bitsPerBlock) - 1);
+}
+
+inline Block PalettedBlockStorage::get(size_t index) const
+{
+	if (bitsPerBlock == 0)
+	{
+		return palette[0];
+	}
+	return palette[getPaletteIndex(index)];
+}
+
+inline uint8_t LightingStorage::get(size_t index) const
+{
+	if (data == nullptr)
+	{
+		return uniformValue;
+	}
+	return data[index];
+}
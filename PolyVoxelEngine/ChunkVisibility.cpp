@@ -0,0 +1,167 @@
+#include "ChunkVisibility.h"
+#include "Chunk.h"
+#include "ChunkCulling.h"
+#include <bit>
+#include <cstring>
+
+static constexpr size_t CHUNK_SIZE_SHIFT = std::countr_zero((unsigned int)Settings::CHUNK_SIZE);
+static constexpr size_t OPAQUE_CELLS_WORDS = Settings::CHUNK_SIZE_CUBED / 64;
+static constexpr uint8_t NO_SIDE = 6;
+
+size_t ChunkVisibility::getSidesPairBit(size_t sideA, size_t sideB)
+{
+	if (sideA > sideB)
+	{
+		std::swap(sideA, sideB);
+	}
+	// pairs are numbered (0, 1), (0, 2) ... (0, 5), (1, 2) ... (4, 5)
+	return sideA * (11 - sideA) / 2 + sideB - sideA - 1;
+}
+
+bool ChunkVisibility::areSidesConnected(uint16_t sideConnections, size_t sideA, size_t sideB)
+{
+	if (sideA == sideB)
+	{
+		return true;
+	}
+	return (sideConnections >> getSidesPairBit(sideA, sideB)) & 1;
+}
+
+uint16_t ChunkVisibility::calculateSideConnections(const uint64_t* opaqueCells)
+{
+	size_t opaqueCount = 0;
+	for (size_t i = 0; i < OPAQUE_CELLS_WORDS; i++)
+	{
+		opaqueCount += std::popcount(opaqueCells[i]);
+	}
+	if (opaqueCount == 0)
+	{
+		return ALL_SIDES_CONNECTED;
+	}
+	if (opaqueCount == Settings::CHUNK_SIZE_CUBED)
+	{
+		return 0;
+	}
+
+	// opaque cells are never entered, so they start as visited
+	uint64_t visited[OPAQUE_CELLS_WORDS];
+	memcpy(visited, opaqueCells, sizeof(visited));
+
+	thread_local static std::vector<uint16_t> queue;
+	constexpr size_t mask = Settings::CHUNK_SIZE - 1;
+	uint16_t sideConnections = 0;
+	for (size_t start = 0; start < Settings::CHUNK_SIZE_CUBED; start++)
+	{
+		if ((visited[start >> 6] >> (start & 63)) & 1)
+		{
+			continue;
+		}
+
+		visited[start >> 6] |= 1ull << (start & 63);
+		queue.clear();
+		queue.push_back((uint16_t)start);
+		uint8_t touchedSides = 0;
+		for (size_t head = 0; head < queue.size(); head++)
+		{
+			size_t index = queue[head];
+			size_t coords[3] = { index & mask, (index >> CHUNK_SIZE_SHIFT) & mask, index >> (CHUNK_SIZE_SHIFT << 1) };
+			for (size_t side = 0; side < 6; side++)
+			{
+				size_t axis = side >> 1;
+				size_t step = (size_t)1 << (axis * CHUNK_SIZE_SHIFT);
+				size_t neighbourIndex;
+				if (side & 1)
+				{
+					if (coords[axis] == 0)
+					{
+						touchedSides |= 1 << side;
+						continue;
+					}
+					neighbourIndex = index - step;
+				}
+				else
+				{
+					if (coords[axis] == mask)
+					{
+						touchedSides |= 1 << side;
+						continue;
+					}
+					neighbourIndex = index + step;
+				}
+
+				uint64_t bit = 1ull << (neighbourIndex & 63);
+				if (visited[neighbourIndex >> 6] & bit)
+				{
+					continue;
+				}
+				visited[neighbourIndex >> 6] |= bit;
+				queue.push_back((uint16_t)neighbourIndex);
+			}
+		}
+
+		for (size_t sideA = 0; sideA < 6; sideA++)
+		{
+			if (!(touchedSides & (1 << sideA)))
+			{
+				continue;
+			}
+			for (size_t sideB = sideA + 1; sideB < 6; sideB++)
+			{
+				if (touchedSides & (1 << sideB))
+				{
+					sideConnections |= 1 << getSidesPairBit(sideA, sideB);
+				}
+			}
+		}
+		if (sideConnections == ALL_SIDES_CONNECTED)
+		{
+			break;
+		}
+	}
+	return sideConnections;
+}
+
+void ChunkVisibility::findVisibleChunks(Chunk* cameraChunk, const glm::vec4* frustumPlanes, unsigned int frame, std::vector<Chunk*>& visibleChunks)
+{
+	struct Node
+	{
+		Chunk* chunk;
+		uint8_t enteredSide; // side of this chunk search came through
+		uint8_t directions; // bit per side, directions search went since camera chunk
+	};
+	static std::vector<Node> queue;
+
+	queue.clear();
+	cameraChunk->visibilityFrame = frame;
+	visibleChunks.push_back(cameraChunk);
+	queue.push_back({ cameraChunk, NO_SIDE, 0 });
+	for (size_t head = 0; head < queue.size(); head++)
+	{
+		Node node = queue[head];
+		for (size_t side = 0; side < 6; side++)
+		{
+			if (node.directions & (1 << (side ^ 1)))
+			{
+				continue;
+			}
+			if (node.enteredSide != NO_SIDE && !areSidesConnected(node.chunk->sideConnections, node.enteredSide, side))
+			{
+				continue;
+			}
+
+			Chunk* neighbour = node.chunk->neighbours[side];
+			if (!neighbour || neighbour->state != Chunk::State::Loaded || neighbour->visibilityFrame == frame)
+			{
+				continue;
+			}
+			if (!ChunkCulling::isChunkOnFrustum(neighbour->X, neighbour->Y, neighbour->Z, frustumPlanes))
+			{
+				continue;
+			}
+
+			neighbour->visibilityFrame = frame;
+			visibleChunks.push_back(neighbour);
+			queue.push_back({ neighbour, (uint8_t)(side ^ 1), (uint8_t)(node.directions | (1 << side)) });
+		}
+	}
+}
@@ -0,0 +1,28 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <glm/vec4.hpp>
+
+class Chunk;
+
+// cave culling, chunk is drawn only when camera can look into it through transparent cells of chunks in between
+// side connections have one bit for every pair of chunk sides (+x, -x, +y, -y, +z, -z), set when cells of both sides
+// are in the same transparent area of chunk
+// doesn't touch GL
+class ChunkVisibility
+{
+public:
+	static constexpr uint16_t ALL_SIDES_CONNECTED = (1 << 15) - 1;
+
+	static size_t getSidesPairBit(size_t sideA, size_t sideB);
+	static bool areSidesConnected(uint16_t sideConnections, size_t sideA, size_t sideB);
+
+	// opaqueCells has bit per cell, in Chunk::getIndex order
+	static uint16_t calculateSideConnections(const uint64_t* opaqueCells);
+
+	// BFS over loaded chunks from camera chunk, chunk is left only through side connected with side it was entered by
+	// and never toward camera, so search can't go around wall and look at it from behind
+	// reached chunks in frustum get visibilityFrame = frame and are appended to visibleChunks, main thread
+	static void findVisibleChunks(Chunk* cameraChunk, const glm::vec4* frustumPlanes, unsigned int frame, std::vector<Chunk*>& visibleChunks);
+};
@@ -0,0 +1,21 @@
+#include "DrawData.h"
+
+FaceInstanceData::FaceInstanceData()
+{}
+
+#if ENABLE_SMOOTH_LIGHTING
+void FaceInstanceData::set(int x, int y, int z, int w, int h, int normalID, char ao, unsigned int textureID, int lighting, const uint8_t* softLighting)
+{
+    data1 = x | (y << 4) | (z << 8) | ((w - 1) << 12) | ((h - 1) << 16) |
+        (normalID << 20) | (ao << 23); // 31 bits
+    data2 = textureID | (lighting << 8); // 16 bits
+    data3 = softLighting[0] | (softLighting[1] << 8) | (softLighting[2] << 16) | (softLighting[3] << 24);
+}
+#else
+void FaceInstanceData::set(int x, int y, int z, int w, int h, int normalID, char ao, unsigned int textureID, int lighting)
+{
+    data1 = x | (y << 4) | (z << 8) | ((w - 1) << 12) | ((h - 1) << 16) |
+        (normalID << 20) | (ao << 23); // 31 bits
+    data2 = textureID | (lighting << 8); // 16 bits
+}
+#endif
\ No newline at end of file
@@ -0,0 +1,28 @@
+#pragma once
+#include <cstdint>
+#include "settings.h"
+
+// layouts of GPU buffers, kept free of GL so simulation and benchmark don't depend on it
+struct FaceInstanceData
+{
+	int data1 = 0;
+	int data2 = 0;
+#if ENABLE_SMOOTH_LIGHTING
+	int data3 = 0;
+#endif
+
+	FaceInstanceData();
+#if ENABLE_SMOOTH_LIGHTING
+	void set(int x, int y, int z, int w, int h, int normalID, char ao, unsigned int textureID, int lighting, const uint8_t* softLighting);
+#else
+	void set(int x, int y, int z, int w, int h, int normalID, char ao, unsigned int textureID, int lighting);
+#endif
+};
+
+struct DrawArraysIndirectCommand
+{
+	unsigned int count; // verticesCount
+	unsigned int instancesCount;
+	unsigned int first;	// vertex index
+	unsigned int baseInstance;
+};
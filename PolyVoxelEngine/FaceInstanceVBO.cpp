@@ -1,4 +1,5 @@
 #include "FaceInstancesVBO.h"
+#include "StreamBuffer.h"
 #include <glad/glad.h>
 
 FaceInstancesVBO::FaceInstancesVBO(size_t instancesCount, size_t layoutOffset)
@@ -20,7 +21,17 @@ FaceInstancesVBO::FaceInstancesVBO(size_t instancesCount, size_t layoutOffset)
 
 void FaceInstancesVBO::setData(const FaceInstanceData* instancesData, size_t offset, size_t count)
 {
-    glBufferSubData(GL_ARRAY_BUFFER, offset * sizeof(FaceInstanceData), count * sizeof(FaceInstanceData), instancesData);
+    glNamedBufferSubData(ID, offset * sizeof(FaceInstanceData), count * sizeof(FaceInstanceData), instancesData);
+}
+
+void FaceInstancesVBO::copyData(const StreamBuffer& source, size_t sourceOffset, size_t offset, size_t count)
+{
+    glCopyNamedBufferSubData(source.getID(), ID, sourceOffset, offset * sizeof(FaceInstanceData), count * sizeof(FaceInstanceData));
+}
+
+void FaceInstancesVBO::copyData(const FaceInstancesVBO& source, size_t sourceOffset, size_t offset, size_t count)
+{
+    glCopyNamedBufferSubData(source.ID, ID, sourceOffset * sizeof(FaceInstanceData), offset * sizeof(FaceInstanceData), count * sizeof(FaceInstanceData));
 }
 
 void FaceInstancesVBO::linkFloat(unsigned int num_components)
@@ -55,23 +66,3 @@ void FaceInstancesVBO::clean() const
 {
     glDeleteBuffers(1, &ID);
 }
-
-FaceInstanceData::FaceInstanceData()
-{}
-
-#if ENABLE_SMOOTH_LIGHTING
-void FaceInstanceData::set(int x, int y, int z, int w, int h, int normalID, char ao, unsigned int textureID, int lighting, const uint8_t* softLighting)
-{
-    data1 = x | (y << 4) | (z << 8) | ((w - 1) << 12) | ((h - 1) << 16) |
-        (normalID << 20) | (ao << 23); // 31 bits
-    data2 = textureID | (lighting << 8); // 16 bits
-    data3 = softLighting[0] | (softLighting[1] << 8) | (softLighting[2] << 16) | (softLighting[3] << 24);
-}
-#else
-void FaceInstanceData::set(int x, int y, int z, int w, int h, int normalID, char ao, unsigned int textureID, int lighting)
-{
-    data1 = x | (y << 4) | (z << 8) | ((w - 1) << 12) | ((h - 1) << 16) |
-        (normalID << 20) | (ao << 23); // 31 bits
-    data2 = textureID | (lighting << 8); // 16 bits
-}
-#endif
\ No newline at end of file
@@ -1,21 +1,7 @@
 #pragma once
-#include "settings.h"
+#include "DrawData.h"
 
-struct FaceInstanceData
-{
-	int data1 = 0;
-	int data2 = 0;
-#if ENABLE_SMOOTH_LIGHTING
-	int data3 = 0;
-#endif
-
-	FaceInstanceData();
-#if ENABLE_SMOOTH_LIGHTING
-	void set(int x, int y, int z, int w, int h, int normalID, char ao, unsigned int textureID, int lighting, const uint8_t* softLighting);
-#else
-	void set(int x, int y, int z, int w, int h, int normalID, char ao, unsigned int textureID, int lighting);
-#endif
-};
+class StreamBuffer;
 
 class FaceInstancesVBO
 {
@@ -25,6 +11,8 @@ class FaceInstancesVBO
 public:
 	FaceInstancesVBO(size_t instancesCount, size_t layoutOffset);
 	void setData(const FaceInstanceData* instancesData, size_t offset, size_t count);
+	void copyData(const StreamBuffer& source, size_t sourceOffset, size_t offset, size_t count); // GPU side copy, sourceOffset in bytes
+	void copyData(const FaceInstancesVBO& source, size_t sourceOffset, size_t offset, size_t count); // GPU side copy
 
 	void linkFloat(unsigned int num_components);
 	void linkInt(int num_components);
@@ -0,0 +1,128 @@
+#include "FlythroughTrace.h"
+#include <iostream>
+
+std::ofstream FlythroughTrace::recordingFile;
+uint32_t FlythroughTrace::recordedTicksCount = 0;
+
+template<typename T>
+static void writeValue(std::ofstream& file, const T& value)
+{
+	file.write(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+template<typename T>
+static bool readValue(std::ifstream& file, T& value)
+{
+	return (bool)file.read(reinterpret_cast<char*>(&value), sizeof(T));
+}
+
+bool FlythroughTrace::load(const std::string& path)
+{
+	ticks.clear();
+	edits.clear();
+
+	std::ifstream file(path, std::ios::binary);
+	if (!file.is_open())
+	{
+		std::cerr << "Failed to open flythrough trace: " << path << std::endl;
+		return false;
+	}
+
+	uint32_t magic = 0, version = 0;
+	if (!readValue(file, magic) || !readValue(file, version) || magic != MAGIC || version != VERSION)
+	{
+		std::cerr << "Flythrough trace has wrong header: " << path << std::endl;
+		return false;
+	}
+	if (!readValue(file, seed) || !readValue(file, ticksPerSecond) || ticksPerSecond == 0)
+	{
+		std::cerr << "Flythrough trace is truncated: " << path << std::endl;
+		return false;
+	}
+
+	RecordType type;
+	while (readValue(file, type))
+	{
+		if (type == RecordType::Tick)
+		{
+			TickState tick;
+			if (!readValue(file, tick.position) || !readValue(file, tick.rotation))
+			{
+				break;
+			}
+			ticks.push_back(tick);
+		}
+		else if (type == RecordType::BlockEdit)
+		{
+			BlockEdit edit;
+			edit.tick = (uint32_t)ticks.size();
+			if (!readValue(file, edit.x) || !readValue(file, edit.y) || !readValue(file, edit.z) || !readValue(file, edit.block))
+			{
+				break;
+			}
+			edits.push_back(edit);
+		}
+		else
+		{
+			std::cerr << "Unknown flythrough trace record: " << (int)type << std::endl;
+			return false;
+		}
+	}
+	return !ticks.empty();
+}
+
+bool FlythroughTrace::startRecording(const std::string& path, unsigned int seed, uint32_t ticksPerSecond)
+{
+	stopRecording();
+	recordingFile.open(path, std::ios::binary | std::ios::trunc);
+	if (!recordingFile.is_open())
+	{
+		std::cerr << "Failed to open flythrough trace: " << path << std::endl;
+		return false;
+	}
+	writeValue(recordingFile, MAGIC);
+	writeValue(recordingFile, VERSION);
+	writeValue(recordingFile, seed);
+	writeValue(recordingFile, ticksPerSecond);
+	recordedTicksCount = 0;
+	return true;
+}
+
+void FlythroughTrace::stopRecording()
+{
+	if (recordingFile.is_open())
+	{
+		recordingFile.close();
+		std::cout << "Flythrough trace with " << recordedTicksCount << " ticks saved" << std::endl;
+	}
+}
+
+bool FlythroughTrace::isRecording()
+{
+	return recordingFile.is_open();
+}
+
+void FlythroughTrace::recordTick(const glm::vec3& position, const glm::vec2& rotation)
+{
+	if (!recordingFile.is_open())
+	{
+		return;
+	}
+	writeValue(recordingFile, RecordType::Tick);
+	writeValue(recordingFile, position);
+	writeValue(recordingFile, rotation);
+	recordedTicksCount++;
+}
+
+void FlythroughTrace::recordBlockEdit(int x, int y, int z, Block block)
+{
+	if (!recordingFile.is_open())
+	{
+		return;
+	}
+	writeValue(recordingFile, RecordType::BlockEdit);
+	writeValue(recordingFile, x);
+	writeValue(recordingFile, y);
+	writeValue(recordingFile, z);
+	writeValue(recordingFile, block);
+}
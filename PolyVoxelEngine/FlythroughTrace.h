@@ -0,0 +1,52 @@
+#pragma once
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <glm/vec2.hpp>
+#include <glm/vec3.hpp>
+#include "Block.h"
+
+// player position and rotation of every physic tick and block edits made by player
+// file: magic, version, seed, ticks per second, then records (type byte and its data) until end of file
+class FlythroughTrace
+{
+	enum class RecordType : uint8_t
+	{
+		Tick,
+		BlockEdit
+	};
+
+	static constexpr uint32_t MAGIC = 0x54465650; // "PVFT"
+	static constexpr uint32_t VERSION = 1;
+
+	static std::ofstream recordingFile;
+	static uint32_t recordedTicksCount;
+public:
+	struct TickState
+	{
+		glm::vec3 position{};
+		glm::vec2 rotation{};
+	};
+
+	struct BlockEdit
+	{
+		uint32_t tick = 0; // applied before this tick
+		int x = 0, y = 0, z = 0;
+		Block block = Block::Air;
+	};
+
+	unsigned int seed = 0;
+	uint32_t ticksPerSecond = 0;
+	std::vector<TickState> ticks;
+	std::vector<BlockEdit> edits; // in recorded order
+
+	bool load(const std::string& path);
+
+	// main thread
+	static bool startRecording(const std::string& path, unsigned int seed, uint32_t ticksPerSecond);
+	static void stopRecording();
+	static bool isRecording();
+	static void recordTick(const glm::vec3& position, const glm::vec2& rotation);
+	static void recordBlockEdit(int x, int y, int z, Block block);
+};
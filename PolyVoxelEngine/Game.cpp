@@ -2,8 +2,11 @@
 #include "settings.h"
 #include "Camera.h"
 #include "World.h"
+#include "WorldRenderer.h"
 #include "TerrainGenerator.h"
 #include "Profiler.h"
+#include "Metrics.h"
+#include "FlythroughTrace.h"
 #include <format>
 #include <thread>
 #include <math.h>
@@ -103,6 +106,8 @@ Game::Game()
 
 void Game::run()
 {
+	Profiler::setThreadName("Main");
+
 	// callbacks
 	glfwSetWindowUserPointer(GraphicController::window, (void*)this);
 	glfwSetKeyCallback(GraphicController::window, &gameKeyCallback);
@@ -112,6 +117,7 @@ void Game::run()
 	// world
 	WorldData worldData = World::loadWorldData();
 	World world(worldData);
+	WorldRenderer worldRenderer(world);
 	World::worldDataGetPlayerY(worldData);
 
 	// player
@@ -128,10 +134,11 @@ void Game::run()
 	}
 
 	// Ticks
-	Tick worldTick(20);
-	Tick playerTick(40);
+	Tick worldTick(Settings::WORLD_TICK_RATE);
+	Tick playerTick(Settings::PLAYER_TICK_RATE);
 	Tick guiTick(10);
 	Tick profilerTick(40);
+	Tick metricsTick(2);
 
 	//
 	std::string guiPerfomanceText;
@@ -174,6 +181,7 @@ void Game::run()
 		}
 		guiTick.add(deltaTime);
 		profilerTick.add(deltaTime);
+		metricsTick.add(deltaTime);
 
 		while (playerTick.checkLoop())
 		{
@@ -210,7 +218,28 @@ void Game::run()
 			guiPerfomanceText += std::to_string(vram->used >> 20);
 
 			guiPerfomanceText += "\nDrawCommands: ";
-			guiPerfomanceText += std::to_string(world.drawCommandsCount);
+			guiPerfomanceText += std::to_string(worldRenderer.drawCommandsCount);
+
+			const RangeAllocator& facesAllocator = worldRenderer.getFaceInstancesAllocator();
+			guiPerfomanceText += "\nFaces MB: ";
+			guiPerfomanceText += std::to_string((facesAllocator.getUsedSize() * sizeof(FaceInstanceData)) >> 20);
+			guiPerfomanceText += " / ";
+			guiPerfomanceText += std::to_string((facesAllocator.getCapacity() * sizeof(FaceInstanceData)) >> 20);
+
+			// sampled metrics
+			guiPerfomanceText += "\nGenerate/Mesh/Light queues: ";
+			guiPerfomanceText += std::to_string(Metrics::getSampledValue("ChunkGenerateQueue"));
+			guiPerfomanceText += " / ";
+			guiPerfomanceText += std::to_string(Metrics::getSampledValue("GenerateFacesSet"));
+			guiPerfomanceText += " / ";
+			guiPerfomanceText += std::to_string(Metrics::getSampledValue("LightingUpdates"));
+
+			guiPerfomanceText += "\nPop-in ms p50/p90/p99: ";
+			guiPerfomanceText += std::to_string(Metrics::getSampledValue("ChunkDrawnLatencyP50Us") / 1000);
+			guiPerfomanceText += " / ";
+			guiPerfomanceText += std::to_string(Metrics::getSampledValue("ChunkDrawnLatencyP90Us") / 1000);
+			guiPerfomanceText += " / ";
+			guiPerfomanceText += std::to_string(Metrics::getSampledValue("ChunkDrawnLatencyP99Us") / 1000);
 		}
 
 		if (profilerTick.checkOnce())
@@ -218,12 +247,19 @@ void Game::run()
 			Profiler::saveToMemory();
 		}
 
+		if (metricsTick.checkOnce())
+		{
+			world.updateMetrics();
+			worldRenderer.updateMetrics();
+			Metrics::sample(currentTime);
+		}
+
 		GraphicController::beforeRender();
 		{
 			player->BeforeRender();
 
-			world.draw(player->camera);
-			player->draw();
+			worldRenderer.draw(player->camera);
+			player->draw(worldRenderer.blockTextures);
 
 			// profiler
 			rectangleVAO.bind();
@@ -251,12 +287,12 @@ void Game::run()
 							tableIndex -= PROFILER_MEMORY_TABLE_SIZE;
 						}
 						float yProgress = 0.0f;
-						for (size_t i = 0; i < PROFILER_SAMPLES_COUNT; i++)
+						for (size_t i = 0; i < Profiler::getZonesCount(); i++)
 						{
 							float time = (float)Profiler::memoryTable[tableIndex][i] / (float)Profiler::maxTime;
 							if (time > 0.0f)
 							{
-								const auto& color = profilerSamplesColors[i];
+								const auto& color = Profiler::getZoneColor(i);
 								GraphicController::rectangleProgram->setUniformFloat2("position", left + barIndex * barWidth, bottom + yProgress * PROFILER_DRAW_HEIGHT);
 								GraphicController::rectangleProgram->setUniformFloat2("scale", barWidth, PROFILER_DRAW_HEIGHT * time);
 								GraphicController::rectangleProgram->setUniformFloat3("color", color.x, color.y, color.z);
@@ -269,9 +305,9 @@ void Game::run()
 
 				// colors
 				GraphicController::rectangleProgram->setUniformFloat2("scale", PROFILER_DRAW_COLOR_RECT_SIZE, PROFILER_DRAW_COLOR_RECT_SIZE);
-				for (size_t i = 0; i < PROFILER_SAMPLES_COUNT; i++)
+				for (size_t i = 0; i < Profiler::getZonesCount(); i++)
 				{
-					const auto& color = profilerSamplesColors[i];
+					const auto& color = Profiler::getZoneColor(i);
 					GraphicController::rectangleProgram->setUniformFloat2("position", left, bottom + PROFILER_DRAW_HEIGHT + 0.01f + i * (PROFILER_DRAW_COLOR_RECT_Y_OFFSET + PROFILER_DRAW_COLOR_RECT_SIZE));
 					GraphicController::rectangleProgram->setUniformFloat3("color", color.x, color.y, color.z);
 					glDrawArrays(GL_TRIANGLE_FAN, 0, 4);
@@ -325,9 +361,9 @@ void Game::run()
 				{
 					const float left = -GraphicController::aspectRatio;
 					const float bottom = -1.0f;
-					for (size_t i = 0; i < PROFILER_SAMPLES_COUNT; i++)
+					for (size_t i = 0; i < Profiler::getZonesCount(); i++)
 					{
-						TextRenderer::renderText(profilerSamplesNames[i],
+						TextRenderer::renderText(Profiler::getZoneName(i),
 							left + PROFILER_DRAW_COLOR_RECT_SIZE + 0.01f,
 							bottom + PROFILER_DRAW_HEIGHT + 0.01f + i * (PROFILER_DRAW_COLOR_RECT_Y_OFFSET + PROFILER_DRAW_COLOR_RECT_SIZE) + PROFILER_DRAW_COLOR_RECT_SIZE,
 							PROFILER_DRAW_COLOR_RECT_SIZE * 0.5f,
@@ -370,4 +406,6 @@ void Game::run()
 	player->clean(); delete player;
 
 	Profiler::clean();
+	Metrics::stopRecording();
+	FlythroughTrace::stopRecording();
 }
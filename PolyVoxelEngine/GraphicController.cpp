@@ -12,6 +12,7 @@ Shader* GraphicController::framebufferProgram = nullptr;
 GLFWwindow* GraphicController::window = nullptr;
 Shader* GraphicController::chunkProgram = nullptr;
 Shader* GraphicController::deferredChunkProgram = nullptr;
+Shader* GraphicController::chunkCullingProgram = nullptr;
 Shader* GraphicController::textProgram = nullptr;
 Shader* GraphicController::voxelGhostProgram = nullptr;
 Shader* GraphicController::hotbarProgram = nullptr;
@@ -136,6 +137,8 @@ int GraphicController::init(const GraphicSettings& graphicSettings, const GameSe
 	deferredChunkProgram = new Shader("chunk", "#define Z_PRE_PASS");
 #endif
 
+	chunkCullingProgram = new Shader("chunkCulling", "", ShaderType::Compute);
+
 	framebufferProgram = new Shader("frameBuffer");
 	framebufferProgram->bind();
 	framebufferProgram->setUniformInt("screenTexture", 0);
@@ -235,6 +238,7 @@ void GraphicController::clean()
 	framebufferProgram->clean(); delete framebufferProgram;
 	chunkProgram->clean(); delete chunkProgram;
 	deferredChunkProgram->clean(); delete deferredChunkProgram;
+	chunkCullingProgram->clean(); delete chunkCullingProgram;
 	textProgram->clean(); delete textProgram;
 	voxelGhostProgram->clean(); delete voxelGhostProgram;
 	hotbarProgram->clean(); delete hotbarProgram;
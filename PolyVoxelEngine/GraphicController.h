@@ -42,6 +42,7 @@ public:
 	static GLFWwindow* window;
 	static Shader* chunkProgram;
 	static Shader* deferredChunkProgram;
+	static Shader* chunkCullingProgram;
 	static Shader* textProgram;
 	static Shader* voxelGhostProgram;
 	static Shader* hotbarProgram;
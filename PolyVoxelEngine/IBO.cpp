@@ -19,6 +19,11 @@ void IndirectBuffer::bind() const
 	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, ID);
 }
 
+void IndirectBuffer::bindBase(size_t slot) const
+{
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, slot, ID);
+}
+
 void IndirectBuffer::unbind() const
 {
 	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
@@ -1,12 +1,5 @@
 #pragma once
-
-struct DrawArraysIndirectCommand
-{
-	unsigned int count; // verticesCount
-	unsigned int instancesCount;
-	unsigned int first;	// vertex index
-	unsigned int baseInstance;
-};
+#include "DrawData.h"
 
 class IndirectBuffer
 {
@@ -16,6 +9,7 @@ public:
 	void setData(const DrawArraysIndirectCommand* data, size_t count) const;
 
 	void bind() const;
+	void bindBase(size_t slot) const; // as shader storage, for commands written by compute shader
 	void unbind() const;
 	void clean() const;
 };
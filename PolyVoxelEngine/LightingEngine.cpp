@@ -0,0 +1,352 @@
+#include "LightingEngine.h"
+#include "Chunk.h"
+#include "ThreadPool.h"
+#include "Metrics.h"
+#include <algorithm>
+#include <bit>
+
+static constexpr int CHUNK_SIZE_SHIFT = std::countr_zero((unsigned int)Settings::CHUNK_SIZE);
+
+ThreadPool* LightingEngine::threadPool = nullptr;
+std::vector<std::unique_ptr<LightingEngine::ChunkWork>> LightingEngine::works;
+size_t LightingEngine::worksCount = 0;
+std::unordered_map<Chunk*, LightingEngine::ChunkWork*> LightingEngine::workByChunk;
+std::vector<LightingEngine::ChunkWork*> LightingEngine::activeWorks;
+
+bool LightingEngine::ChunkWork::hasWork(bool darkness) const
+{
+	if (darkness)
+	{
+		return !darknessNodes.empty() || !darknessVisits.empty();
+	}
+	return !lightingNodes.empty() || !lightingVisits.empty();
+}
+
+void LightingEngine::setThreadPool(ThreadPool* pool)
+{
+	threadPool = pool;
+}
+
+LightingEngine::ChunkWork* LightingEngine::getWork(Chunk* chunk)
+{
+	auto it = workByChunk.find(chunk);
+	if (it != workByChunk.end())
+	{
+		return it->second;
+	}
+
+	if (worksCount == works.size())
+	{
+		works.push_back(std::make_unique<ChunkWork>());
+	}
+	ChunkWork* work = works[worksCount++].get();
+	work->chunk = chunk;
+	workByChunk.emplace(chunk, work);
+	return work;
+}
+
+LightingEngine::ChunkWork* LightingEngine::getWorkAt(int globalX, int globalY, int globalZ)
+{
+	// seeds usually come in long runs from the same chunk
+	static ChunkWork* lastWork = nullptr;
+	int chX = globalX >> CHUNK_SIZE_SHIFT;
+	int chY = globalY >> CHUNK_SIZE_SHIFT;
+	int chZ = globalZ >> CHUNK_SIZE_SHIFT;
+	if (lastWork && lastWork->chunk && lastWork->chunk->X == chX && lastWork->chunk->Y == chY && lastWork->chunk->Z == chZ)
+	{
+		return lastWork;
+	}
+
+	Chunk* chunk = Chunk::getChunkAt(chX, chY, chZ);
+	if (!chunk || chunk->state != Chunk::State::Loaded)
+	{
+		return nullptr;
+	}
+	lastWork = getWork(chunk);
+	return lastWork;
+}
+
+void LightingEngine::reset()
+{
+	for (size_t i = 0; i < worksCount; i++)
+	{
+		// vectors keep their capacity for next tick
+		ChunkWork& work = *works[i];
+		work.chunk = nullptr;
+		work.darknessNodes.clear();
+		work.lightingNodes.clear();
+		work.darknessVisits.clear();
+		work.lightingVisits.clear();
+		for (auto& visits : work.outgoing)
+		{
+			visits.clear();
+		}
+	}
+	worksCount = 0;
+	workByChunk.clear();
+}
+
+void LightingEngine::propagateDarkness()
+{
+	{
+		std::lock_guard<std::mutex> lock(Chunk::darknessFloodFillMutex);
+		METRICS_ADD("DarknessFloodFillNodes", Chunk::darknessFloodFillVector.size());
+		for (const LightRemovalNode& node : Chunk::darknessFloodFillVector)
+		{
+			ChunkWork* work = getWorkAt(node.pos.x, node.pos.y, node.pos.z);
+			if (!work)
+			{
+				continue;
+			}
+			work->darknessNodes.push_back({
+				(uint8_t)(node.pos.x & (Settings::CHUNK_SIZE - 1)),
+				(uint8_t)(node.pos.y & (Settings::CHUNK_SIZE - 1)),
+				(uint8_t)(node.pos.z & (Settings::CHUNK_SIZE - 1)),
+				node.lightValue,
+				node.blockOrSky
+			});
+		}
+		Chunk::darknessFloodFillVector.clear();
+	}
+
+	while (runRound(true));
+}
+
+void LightingEngine::propagateLighting()
+{
+	{
+		std::lock_guard<std::mutex> lock(Chunk::lightingFloodFillMutex);
+		METRICS_ADD("LightingFloodFillNodes", Chunk::lightingFloodFillVector.size());
+		for (const LightPropagationNode& node : Chunk::lightingFloodFillVector)
+		{
+			ChunkWork* work = getWorkAt(node.pos.x, node.pos.y, node.pos.z);
+			if (!work)
+			{
+				continue;
+			}
+			work->lightingNodes.push_back({
+				(uint8_t)(node.pos.x & (Settings::CHUNK_SIZE - 1)),
+				(uint8_t)(node.pos.y & (Settings::CHUNK_SIZE - 1)),
+				(uint8_t)(node.pos.z & (Settings::CHUNK_SIZE - 1)),
+				0,
+				node.blockOrSky
+			});
+		}
+		Chunk::lightingFloodFillVector.clear();
+	}
+
+	while (runRound(false));
+	reset();
+}
+
+bool LightingEngine::runRound(bool darkness)
+{
+	activeWorks.clear();
+	for (size_t i = 0; i < worksCount; i++)
+	{
+		if (works[i]->hasWork(darkness))
+		{
+			activeWorks.push_back(works[i].get());
+		}
+	}
+	if (activeWorks.empty())
+	{
+		return false;
+	}
+
+	processChunks(darkness);
+	return exchangeVisits(darkness);
+}
+
+void LightingEngine::processChunks(bool darkness)
+{
+	// late helpers may start after round is over, so they only own the counters
+	struct Round
+	{
+		std::atomic<size_t> nextWork = 0;
+		std::atomic<size_t> finishedWorks = 0;
+		size_t worksCount = 0;
+		ChunkWork* const* works = nullptr;
+		bool darkness = false;
+	};
+	auto round = std::make_shared<Round>();
+	round->worksCount = activeWorks.size();
+	round->works = activeWorks.data();
+	round->darkness = darkness;
+
+	auto process = [](Round& round)
+		{
+			size_t i;
+			while ((i = round.nextWork++) < round.worksCount)
+			{
+				if (round.darkness)
+				{
+					processDarkness(*round.works[i]);
+				}
+				else
+				{
+					processLighting(*round.works[i]);
+				}
+				if (++round.finishedWorks == round.worksCount)
+				{
+					round.finishedWorks.notify_all();
+				}
+			}
+		};
+
+	if (threadPool && round->worksCount > 1)
+	{
+		size_t helpersCount = std::min(round->worksCount - 1, threadPool->getThreadCount());
+		for (size_t i = 0; i < helpersCount; i++)
+		{
+			threadPool->addTask([round, process]() { process(*round); }, TaskPriority::NearGeneration);
+		}
+	}
+
+	// main thread works too, so round ends even if all workers are busy with generation
+	process(*round);
+	size_t finishedWorks;
+	while ((finishedWorks = round->finishedWorks.load()) < round->worksCount)
+	{
+		round->finishedWorks.wait(finishedWorks);
+	}
+}
+
+bool LightingEngine::exchangeVisits(bool darkness)
+{
+	bool anyVisits = false;
+	size_t count = worksCount; // neighbour works are appended while iterating
+	for (size_t i = 0; i < count; i++)
+	{
+		ChunkWork& work = *works[i];
+		for (size_t side = 0; side < 6; side++)
+		{
+			auto& visits = work.outgoing[side];
+			if (visits.empty())
+			{
+				continue;
+			}
+
+			Chunk* neighbour = work.chunk->neighbours[side];
+			if (neighbour && neighbour->state == Chunk::State::Loaded)
+			{
+				ChunkWork* neighbourWork = getWork(neighbour);
+				auto& inbox = darkness ? neighbourWork->darknessVisits : neighbourWork->lightingVisits;
+				inbox.insert(inbox.end(), visits.begin(), visits.end());
+				anyVisits = true;
+			}
+			visits.clear();
+		}
+	}
+	return anyVisits;
+}
+
+void LightingEngine::processDarkness(ChunkWork& work)
+{
+	for (const Node& visit : work.darknessVisits)
+	{
+		visitDarkness(work, visit.x, visit.y, visit.z, visit.value, visit.blockOrSky);
+	}
+	work.darknessVisits.clear();
+
+	auto& nodes = work.darknessNodes;
+	while (!nodes.empty())
+	{
+		Node darkness = nodes.back();
+		nodes.pop_back();
+
+		for (size_t side = 0; side < 6; side++)
+		{
+			size_t axis = side >> 1;
+			int offCoords[3] = { darkness.x, darkness.y, darkness.z };
+			offCoords[axis] += (side & 1) ? -1 : 1;
+
+			if (offCoords[axis] < 0 || offCoords[axis] >= Settings::CHUNK_SIZE)
+			{
+				offCoords[axis] &= Settings::CHUNK_SIZE - 1;
+				work.outgoing[side].push_back({ (uint8_t)offCoords[0], (uint8_t)offCoords[1], (uint8_t)offCoords[2], darkness.value, darkness.blockOrSky });
+				continue;
+			}
+			visitDarkness(work, offCoords[0], offCoords[1], offCoords[2], darkness.value, darkness.blockOrSky);
+		}
+	}
+}
+
+void LightingEngine::visitDarkness(ChunkWork& work, uint8_t x, uint8_t y, uint8_t z, uint8_t lightValue, bool blockOrSky)
+{
+	Chunk::BlockAndLighting blockAndLighting = work.chunk->getBlockAndLightingAtInBoundaries(x, y, z);
+	if (blockAndLighting.block == Block::Void || !ALL_BLOCK_DATA[(size_t)blockAndLighting.block].transparent)
+	{
+		return;
+	}
+
+	uint8_t lightLevel = (blockAndLighting.lighting >> (4 * blockOrSky)) & 15;
+	if (lightLevel == 0)
+	{
+		return;
+	}
+
+	if (lightLevel < lightValue)
+	{
+		work.chunk->setLightingAtInBoundaries(x, y, z, 0, blockOrSky);
+		work.darknessNodes.push_back({ x, y, z, lightLevel, blockOrSky });
+	}
+	else
+	{
+		// brighter light from other source fills removed area back
+		work.lightingNodes.push_back({ x, y, z, 0, blockOrSky });
+	}
+}
+
+void LightingEngine::processLighting(ChunkWork& work)
+{
+	for (const Node& visit : work.lightingVisits)
+	{
+		visitLighting(work, visit.x, visit.y, visit.z, visit.value, visit.blockOrSky);
+	}
+	work.lightingVisits.clear();
+
+	auto& nodes = work.lightingNodes;
+	while (!nodes.empty())
+	{
+		Node light = nodes.back();
+		nodes.pop_back();
+
+		uint8_t currentLightLevel = (work.chunk->getLightingAtInBoundaries(light.x, light.y, light.z) >> (4 * light.blockOrSky)) & 15;
+		if (currentLightLevel <= 1)
+		{
+			continue;
+		}
+
+		for (size_t side = 0; side < 6; side++)
+		{
+			size_t axis = side >> 1;
+			int offCoords[3] = { light.x, light.y, light.z };
+			offCoords[axis] += (side & 1) ? -1 : 1;
+
+			if (offCoords[axis] < 0 || offCoords[axis] >= Settings::CHUNK_SIZE)
+			{
+				offCoords[axis] &= Settings::CHUNK_SIZE - 1;
+				work.outgoing[side].push_back({ (uint8_t)offCoords[0], (uint8_t)offCoords[1], (uint8_t)offCoords[2], currentLightLevel, light.blockOrSky });
+				continue;
+			}
+			visitLighting(work, offCoords[0], offCoords[1], offCoords[2], currentLightLevel, light.blockOrSky);
+		}
+	}
+}
+
+void LightingEngine::visitLighting(ChunkWork& work, uint8_t x, uint8_t y, uint8_t z, uint8_t lightValue, bool blockOrSky)
+{
+	Chunk::BlockAndLighting blockAndLighting = work.chunk->getBlockAndLightingAtInBoundaries(x, y, z);
+	if (blockAndLighting.block == Block::Void)
+	{
+		return;
+	}
+
+	uint8_t lightLevel = (blockAndLighting.lighting >> (4 * blockOrSky)) & 15;
+	if (ALL_BLOCK_DATA[(size_t)blockAndLighting.block].transparent && lightLevel + 1 < lightValue)
+	{
+		work.chunk->setLightingAtInBoundaries(x, y, z, lightValue - 1, blockOrSky);
+		work.lightingNodes.push_back({ x, y, z, 0, blockOrSky });
+	}
+}
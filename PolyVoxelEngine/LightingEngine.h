@@ -0,0 +1,60 @@
+#pragma once
+#include <vector>
+#include <unordered_map>
+#include <memory>
+#include <cstdint>
+
+class Chunk;
+class ThreadPool;
+
+// flood fills of Chunk::darknessFloodFillVector and Chunk::lightingFloodFillVector
+// nodes are bucketed by chunk and kept in chunk coordinates, chunks are processed in parallel rounds
+// worker writes only lighting of its own chunk, node that crosses chunk border is handed to neighbour for next round
+// called from main thread only
+class LightingEngine
+{
+	struct Node
+	{
+		uint8_t x, y, z;
+		uint8_t value; // removed light for darkness, source light for visits from neighbour chunk
+		bool blockOrSky;
+	};
+
+	struct ChunkWork
+	{
+		Chunk* chunk = nullptr;
+		std::vector<Node> darknessNodes;
+		std::vector<Node> lightingNodes;
+		std::vector<Node> darknessVisits; // cells checked against light of neighbour chunk
+		std::vector<Node> lightingVisits;
+		std::vector<Node> outgoing[6]; // visits for neighbours, in their coordinates
+
+		bool hasWork(bool darkness) const;
+	};
+
+	static ThreadPool* threadPool;
+	static std::vector<std::unique_ptr<ChunkWork>> works;
+	static size_t worksCount;
+	static std::unordered_map<Chunk*, ChunkWork*> workByChunk;
+	static std::vector<ChunkWork*> activeWorks;
+
+	static ChunkWork* getWork(Chunk* chunk);
+	static ChunkWork* getWorkAt(int globalX, int globalY, int globalZ);
+	static void reset();
+
+	static bool runRound(bool darkness);
+	static void processChunks(bool darkness);
+	static bool exchangeVisits(bool darkness);
+
+	static void processDarkness(ChunkWork& work);
+	static void visitDarkness(ChunkWork& work, uint8_t x, uint8_t y, uint8_t z, uint8_t lightValue, bool blockOrSky);
+	static void processLighting(ChunkWork& work);
+	static void visitLighting(ChunkWork& work, uint8_t x, uint8_t y, uint8_t z, uint8_t lightValue, bool blockOrSky);
+public:
+	// without pool everything runs on calling thread
+	static void setThreadPool(ThreadPool* pool);
+
+	// light found next to removed light is kept for propagateLighting
+	static void propagateDarkness();
+	static void propagateLighting();
+};
@@ -0,0 +1,118 @@
+#pragma once
+#include <atomic>
+
+// bounded multi-producer queue (Dmitry Vyukov's algorithm)
+// capacity is rounded up to power of two, push fails when queue is full
+
+template<typename T>
+class LockFreeQueue
+{
+	struct Cell
+	{
+		std::atomic<size_t> sequence;
+		T data;
+	};
+
+	Cell* buffer;
+	size_t bufferMask;
+	alignas(64) std::atomic<size_t> enqueuePosition;
+	alignas(64) std::atomic<size_t> dequeuePosition;
+public:
+	explicit LockFreeQueue(size_t capacity);
+	~LockFreeQueue();
+
+	LockFreeQueue(const LockFreeQueue&) = delete;
+	LockFreeQueue& operator=(const LockFreeQueue&) = delete;
+
+	bool push(const T& value);
+	bool pop(T& value);
+};
+
+template<typename T>
+inline LockFreeQueue<T>::LockFreeQueue(size_t capacity)
+{
+	size_t bufferSize = 2;
+	while (bufferSize < capacity)
+	{
+		bufferSize <<= 1;
+	}
+
+	buffer = new Cell[bufferSize];
+	bufferMask = bufferSize - 1;
+	for (size_t i = 0; i < bufferSize; i++)
+	{
+		buffer[i].sequence.store(i, std::memory_order_relaxed);
+	}
+	enqueuePosition.store(0, std::memory_order_relaxed);
+	dequeuePosition.store(0, std::memory_order_relaxed);
+}
+
+template<typename T>
+inline LockFreeQueue<T>::~LockFreeQueue()
+{
+	delete[] buffer;
+}
+
+template<typename T>
+inline bool LockFreeQueue<T>::push(const T& value)
+{
+	size_t position = enqueuePosition.load(std::memory_order_relaxed);
+	Cell* cell;
+	while (true)
+	{
+		cell = &buffer[position & bufferMask];
+		size_t sequence = cell->sequence.load(std::memory_order_acquire);
+		intptr_t diff = (intptr_t)sequence - (intptr_t)position;
+		if (diff == 0)
+		{
+			if (enqueuePosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+			{
+				break;
+			}
+		}
+		else if (diff < 0)
+		{
+			return false;
+		}
+		else
+		{
+			position = enqueuePosition.load(std::memory_order_relaxed);
+		}
+	}
+
+	cell->data = value;
+	cell->sequence.store(position + 1, std::memory_order_release);
+	return true;
+}
+
+template<typename T>
+inline bool LockFreeQueue<T>::pop(T& value)
+{
+	size_t position = dequeuePosition.load(std::memory_order_relaxed);
+	Cell* cell;
+	while (true)
+	{
+		cell = &buffer[position & bufferMask];
+		size_t sequence = cell->sequence.load(std::memory_order_acquire);
+		intptr_t diff = (intptr_t)sequence - (intptr_t)(position + 1);
+		if (diff == 0)
+		{
+			if (dequeuePosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+			{
+				break;
+			}
+		}
+		else if (diff < 0)
+		{
+			return false;
+		}
+		else
+		{
+			position = dequeuePosition.load(std::memory_order_relaxed);
+		}
+	}
+
+	value = cell->data;
+	cell->sequence.store(position + bufferMask + 1, std::memory_order_release);
+	return true;
+}
@@ -0,0 +1,143 @@
+#include "Metrics.h"
+#include <iomanip>
+#include <iostream>
+
+std::mutex Metrics::registryMutex;
+Metrics::Metric Metrics::metrics[METRICS_MAX_COUNT];
+std::atomic<size_t> Metrics::metricsCount = 0;
+std::ofstream Metrics::file;
+bool Metrics::jsonLines = false;
+uint64_t Metrics::samplesCount = 0;
+
+uint16_t Metrics::registerMetric(const std::string& name, MetricType type)
+{
+	std::lock_guard<std::mutex> lock(registryMutex);
+	size_t count = metricsCount.load(std::memory_order_relaxed);
+	for (size_t i = 0; i < count; i++)
+	{
+		if (metrics[i].name == name)
+		{
+			return (uint16_t)i;
+		}
+	}
+	if (count >= METRICS_MAX_COUNT)
+	{
+		std::cerr << "Too many metrics, " << name << " is counted as " << metrics[count - 1].name << std::endl;
+		return (uint16_t)(count - 1);
+	}
+
+	metrics[count].name = name;
+	metrics[count].type = type;
+	metricsCount.store(count + 1, std::memory_order_release);
+	return (uint16_t)count;
+}
+
+void Metrics::add(uint16_t metric, int64_t value)
+{
+	metrics[metric].value.fetch_add(value, std::memory_order_relaxed);
+}
+
+void Metrics::set(uint16_t metric, int64_t value)
+{
+	metrics[metric].value.store(value, std::memory_order_relaxed);
+}
+
+size_t Metrics::getMetricsCount()
+{
+	return metricsCount.load(std::memory_order_acquire);
+}
+
+const std::string& Metrics::getName(size_t metric)
+{
+	return metrics[metric].name;
+}
+
+int64_t Metrics::getSampledValue(size_t metric)
+{
+	return metrics[metric].sampledValue;
+}
+
+int64_t Metrics::getSampledValue(const std::string& name)
+{
+	size_t count = getMetricsCount();
+	for (size_t i = 0; i < count; i++)
+	{
+		if (metrics[i].name == name)
+		{
+			return metrics[i].sampledValue;
+		}
+	}
+	return 0;
+}
+
+bool Metrics::startRecording(const std::string& path)
+{
+	stopRecording();
+	file.open(path, std::ios::trunc);
+	if (!file.is_open())
+	{
+		std::cerr << "Failed to open metrics file: " << path << std::endl;
+		return false;
+	}
+
+	jsonLines = path.size() >= 6 && path.compare(path.size() - 6, 6, ".jsonl") == 0;
+	if (!jsonLines)
+	{
+		file << "time_s,metric,value" << std::endl;
+	}
+	file << std::fixed << std::setprecision(3);
+	return true;
+}
+
+void Metrics::stopRecording()
+{
+	if (file.is_open())
+	{
+		file.close();
+	}
+}
+
+bool Metrics::isRecording()
+{
+	return file.is_open();
+}
+
+void Metrics::sample(double timeSeconds)
+{
+	size_t count = getMetricsCount();
+	for (size_t i = 0; i < count; i++)
+	{
+		Metric& metric = metrics[i];
+		if (metric.type == MetricType::Counter)
+		{
+			metric.sampledValue = metric.value.exchange(0, std::memory_order_relaxed);
+		}
+		else
+		{
+			metric.sampledValue = metric.value.load(std::memory_order_relaxed);
+		}
+	}
+	samplesCount++;
+
+	if (!file.is_open())
+	{
+		return;
+	}
+	if (jsonLines)
+	{
+		file << "{\"time_s\":" << timeSeconds << ",\"sample\":" << samplesCount;
+		for (size_t i = 0; i < count; i++)
+		{
+			file << ",\"" << metrics[i].name << "\":" << metrics[i].sampledValue;
+		}
+		file << "}\n";
+	}
+	else
+	{
+		for (size_t i = 0; i < count; i++)
+		{
+			file << timeSeconds << "," << metrics[i].name << "," << metrics[i].sampledValue << "\n";
+		}
+	}
+	file.flush();
+}
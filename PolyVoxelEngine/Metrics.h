@@ -0,0 +1,66 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <fstream>
+#include <mutex>
+#include <string>
+
+constexpr size_t METRICS_MAX_COUNT = 64;
+
+enum class MetricType
+{
+	Counter, // sum of added values since previous sample
+	Gauge // last set value
+};
+
+// named engine metrics, registered at runtime like profiler zones
+// add and set are lock free and can be called from any thread
+// sample is called periodically by main thread, it takes counters and writes line per metric when recording
+class Metrics
+{
+	struct Metric
+	{
+		std::string name;
+		MetricType type = MetricType::Gauge;
+		std::atomic<int64_t> value = 0;
+		int64_t sampledValue = 0;
+	};
+
+	static std::mutex registryMutex;
+	static Metric metrics[METRICS_MAX_COUNT];
+	static std::atomic<size_t> metricsCount;
+
+	static std::ofstream file;
+	static bool jsonLines;
+	static uint64_t samplesCount;
+public:
+	static uint16_t registerMetric(const std::string& name, MetricType type); // same name gives same metric
+	static void add(uint16_t metric, int64_t value);
+	static void set(uint16_t metric, int64_t value);
+
+	static size_t getMetricsCount();
+	static const std::string& getName(size_t metric);
+	static int64_t getSampledValue(size_t metric);
+	static int64_t getSampledValue(const std::string& name); // 0 when metric isn't registered yet
+
+	// .jsonl path writes object per sample, anything else writes csv rows of time, metric, value
+	static bool startRecording(const std::string& path);
+	static void stopRecording();
+	static bool isRecording();
+
+	static void sample(double timeSeconds);
+};
+
+#define METRICS_ADD(name, value) \
+	do \
+	{ \
+		static const uint16_t metricID = Metrics::registerMetric(name, MetricType::Counter); \
+		Metrics::add(metricID, (int64_t)(value)); \
+	} while (false)
+
+#define METRICS_SET(name, value) \
+	do \
+	{ \
+		static const uint16_t metricID = Metrics::registerMetric(name, MetricType::Gauge); \
+		Metrics::set(metricID, (int64_t)(value)); \
+	} while (false)
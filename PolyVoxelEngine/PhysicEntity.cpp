@@ -1,4 +1,5 @@
 #include "PhysicEntity.h"
+#include <glm/glm.hpp>
 
 const glm::vec3 PhysicEntity::GLOBAL_UP = glm::vec3(0.0f, 1.0f, 0.0f);
 World* PhysicEntity::world = nullptr;
@@ -7,6 +8,15 @@ PhysicEntity::PhysicEntity(glm::vec3 position, glm::vec3 colliderSize, glm::vec3
 	: collider(this->position, this->colliderSize, this->colliderDpos), position(position), previousPosition(position), velocity(0.0f), colliderSize(colliderSize * 0.5f), colliderDpos(colliderDpos)
 {}
 
+PhysicEntity::~PhysicEntity()
+{
+	// chunk keeps pointer to collider
+	if (chunk)
+	{
+		chunk->physicEntities.remove(&collider);
+	}
+}
+
 void PhysicEntity::accelerate(const glm::vec3 & acc)
 {
 	velocity += acc;
@@ -124,25 +134,27 @@ void PhysicEntity::physicUpdate(float dt)
 		position += dpos;
 	}
 
-	// move to other chunk
+	updateChunk();
+}
+
+void PhysicEntity::updateChunk()
+{
+	glm::ivec3 chunkPos = glm::floor(position / floorf(Settings::CHUNK_SIZE));
+	Chunk* newChunk = Chunk::getChunkAt(chunkPos.x, chunkPos.y, chunkPos.z);
+	if (chunk != newChunk)
 	{
-		glm::ivec3 chunkPos = glm::floor(position / floorf(Settings::CHUNK_SIZE));
-		Chunk* newChunk = Chunk::getChunkAt(chunkPos.x, chunkPos.y, chunkPos.z);
-		if (chunk != newChunk)
+		if (chunk)
 		{
-			if (chunk)
-			{
-				chunk->physicEntities.remove(&collider);
-			}
-			chunk = newChunk;
-			if (chunk)
-			{
-				chunk->physicEntities.push(&collider);
-			}
-			else
-			{
-				std::cerr << "Entity entered non-chunk" << std::endl;
-			}
+			chunk->physicEntities.remove(&collider);
+		}
+		chunk = newChunk;
+		if (chunk)
+		{
+			chunk->physicEntities.push(&collider);
+		}
+		else
+		{
+			std::cerr << "Entity entered non-chunk" << std::endl;
 		}
 	}
 }
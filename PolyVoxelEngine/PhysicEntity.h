@@ -21,8 +21,10 @@ public:
 	float airResistanceMultiplier = 1.0f;
 
 	PhysicEntity(glm::vec3 position, glm::vec3 colliderSize, glm::vec3 colliderDpos);
+	~PhysicEntity(); // world must still exist
 
 	void accelerate(const glm::vec3& acc);
 	void physicUpdate(float dt);
+	void updateChunk(); // moves collider to chunk at position, for entities moved without physicUpdate
 };
 
@@ -2,6 +2,11 @@
 #include <glm/gtx/compatibility.hpp>
 #include "SoundEngine.h"
 #include "GraphicController.h"
+#include "Profiler.h"
+#include "Metrics.h"
+#include "ChunkLifecycle.h"
+#include "FlythroughTrace.h"
+#include "TerrainGenerator.h"
 
 static constexpr int intCeil(float x_)
 {
@@ -157,6 +162,8 @@ void Player::physicUpdate(float dt, float time)
 	physicEntity.airResistanceMultiplier = flyMode ? 5.0f : 1.0f;
 	physicEntity.physicUpdate(dt);
 	isGrounded = physicEntity.isGrounded;
+
+	FlythroughTrace::recordTick(physicEntity.position, rotation);
 }
 
 void Player::update(float intelpolation)
@@ -205,7 +212,7 @@ void Player::BeforeRender()
 	}
 }
 
-void Player::draw() const
+void Player::draw(const TextureArray& blockTextures) const
 {
 	GraphicController::voxelGhostProgram->bind();
 	camera.passMatrixToShader(GraphicController::voxelGhostProgram, "camMatrix");
@@ -254,7 +261,7 @@ void Player::draw() const
 		uiVAO.bind();
 		glDisable(GL_DEPTH_TEST);
 
-		physicEntity.world->blockTextures.bind();
+		blockTextures.bind();
 
 		for (int i = 0; i < 9; i++)
 		{
@@ -396,6 +403,54 @@ void Player::keyCallback(int key, int scancode, int action, int mods)
 	{
 		physicEntity.world->regenerateChunks();
 	}
+	else if (key == GLFW_KEY_M)
+	{
+		Settings::DynamicSettings::binaryGreedyMeshing = !Settings::DynamicSettings::binaryGreedyMeshing;
+		std::cout << "binaryGreedyMeshing: " << std::to_string(Settings::DynamicSettings::binaryGreedyMeshing) << std::endl;
+		physicEntity.world->regenerateChunks();
+	}
+	else if (key == GLFW_KEY_G)
+	{
+		Settings::DynamicSettings::gpuChunkCulling = !Settings::DynamicSettings::gpuChunkCulling;
+		std::cout << "gpuChunkCulling: " << std::to_string(Settings::DynamicSettings::gpuChunkCulling) << std::endl;
+	}
+	else if (key == GLFW_KEY_C)
+	{
+		Settings::DynamicSettings::occlusionCulling = !Settings::DynamicSettings::occlusionCulling;
+		std::cout << "occlusionCulling: " << std::to_string(Settings::DynamicSettings::occlusionCulling) << std::endl;
+	}
+	else if (key == GLFW_KEY_T)
+	{
+		Profiler::exportChromeTrace(Settings::PROFILER_TRACE_PATH);
+	}
+	else if (key == GLFW_KEY_R)
+	{
+		if (FlythroughTrace::isRecording())
+		{
+			FlythroughTrace::stopRecording();
+		}
+		else
+		{
+			FlythroughTrace::startRecording(Settings::FLYTHROUGH_TRACE_PATH, (unsigned int)TerrainGenerator::seed, Settings::PLAYER_TICK_RATE);
+		}
+		std::cout << "flythroughRecording: " << std::to_string(FlythroughTrace::isRecording()) << std::endl;
+	}
+	else if (key == GLFW_KEY_L)
+	{
+		ChunkLifecycle::report(std::cout);
+	}
+	else if (key == GLFW_KEY_K)
+	{
+		if (Metrics::isRecording())
+		{
+			Metrics::stopRecording();
+		}
+		else
+		{
+			Metrics::startRecording(Settings::METRICS_PATH);
+		}
+		std::cout << "metricsRecording: " << std::to_string(Metrics::isRecording()) << std::endl;
+	}
 	else if (key == GLFW_KEY_V)
 	{
 		physicEntity.collisionEnabled = !physicEntity.collisionEnabled;
@@ -639,12 +694,12 @@ void Player::Inputs(float dt, float time)
 				worldEditNextTime = time + 0.1f;
 				if (hit.hit)
 				{
-					physicEntity.world->setBlockAt(
-						hit.globalPos.x + hit.normal.x,
-						hit.globalPos.y + hit.normal.y,
-						hit.globalPos.z + hit.normal.z,
-						selectedHotbarBlock
-					);
+					glm::ivec3 placePos = hit.globalPos + hit.normal;
+					// only applied edits are recorded, rejected ones would be applied in replay
+					if (physicEntity.world->setBlockAt(placePos.x, placePos.y, placePos.z, selectedHotbarBlock))
+					{
+						FlythroughTrace::recordBlockEdit(placePos.x, placePos.y, placePos.z, selectedHotbarBlock);
+					}
 					blockPlaceSoundSource.play();
 				}
 			}
@@ -655,12 +710,16 @@ void Player::Inputs(float dt, float time)
 			worldEditNextTime = time + 0.1f;
 			if (hit.hit)
 			{
-				physicEntity.world->setBlockAt(
+				bool applied = physicEntity.world->setBlockAt(
 					hit.globalPos.x,
 					hit.globalPos.y,
 					hit.globalPos.z,
 					Block::Air
 				);
+				if (applied)
+				{
+					FlythroughTrace::recordBlockEdit(hit.globalPos.x, hit.globalPos.y, hit.globalPos.z, Block::Air);
+				}
 				blockBreakSoundSource.play();
 			}
 		}
@@ -1,6 +1,10 @@
 #pragma once
 #include "PhysicEntity.h"
 #include "SoundEngine.h"
+#include "Camera.h"
+#include "TextureArray.h"
+#include "VAO.h"
+#include "VBO.h"
 
 class Player
 {
@@ -74,7 +78,7 @@ public:
 	void physicUpdate(float dt, float time);
 	void update(float intelpolation);
 	void BeforeRender();
-	void draw() const;
+	void draw(const TextureArray& blockTextures) const;
 
 	void keyCallback(int key, int scancode, int action, int mods);
 
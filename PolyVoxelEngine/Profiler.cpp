@@ -1,26 +1,20 @@
 #include "Profiler.h"
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
 #include <iostream>
 
-std::unordered_map<std::thread::id, Profiler::PerThreadData> Profiler::threadProfilerData;
-uint32_t Profiler::memoryTable[PROFILER_MEMORY_TABLE_SIZE][PROFILER_SAMPLES_COUNT] = {};
+std::mutex Profiler::registryMutex;
+std::vector<std::unique_ptr<Profiler::ThreadData>> Profiler::threads;
+std::string Profiler::zoneNames[PROFILER_MAX_ZONES];
+std::atomic<size_t> Profiler::zonesCount = 0;
+const std::chrono::steady_clock::time_point Profiler::startTime = std::chrono::steady_clock::now();
+uint32_t Profiler::memoryTable[PROFILER_MEMORY_TABLE_SIZE][PROFILER_MAX_ZONES] = {};
 size_t Profiler::memoryTableIndex = 0;
 uint32_t Profiler::maxTimeTable[PROFILER_MEMORY_TABLE_SIZE] = {};
 uint32_t Profiler::maxTime = 0;
-std::mutex Profiler::addDataMutex;
-
-const std::string profilerSamplesNames[PROFILER_SAMPLES_COUNT] =
-{
-	"BlockGeneration",
-	"BlockLightUpdate",
-	"SkyLightUpdate",
-	"FetchingFaces",
-	"GreedyMeshing",
-	"LoadChunks",
-	"ChunkLoadData",
-	"ChunkLighting",
-};
 
-const glm::vec3 profilerSamplesColors[PROFILER_SAMPLES_COUNT] =
+static const glm::vec3 profilerZonesColors[] =
 {
 	{1.0f, 0.0f, 0.0f},
 	{0.0f, 1.0f, 0.0f},
@@ -31,68 +25,155 @@ const glm::vec3 profilerSamplesColors[PROFILER_SAMPLES_COUNT] =
 	{1.0f, 0.0f, 1.0f},
 
 	{0.5f, 0.5f, 0.5f},
-	{1.0f, 1.0f, 1.0f}
+	{1.0f, 1.0f, 1.0f},
+	{1.0f, 0.5f, 0.0f},
+
+	{0.5f, 0.0f, 1.0f},
+	{0.0f, 0.5f, 0.0f},
+	{0.5f, 0.25f, 0.0f}
 };
+static constexpr size_t PROFILER_ZONES_COLORS_COUNT = sizeof(profilerZonesColors) / sizeof(profilerZonesColors[0]);
+
+Profiler::ThreadData& Profiler::getThreadData()
+{
+	thread_local ThreadData* data = nullptr;
+	if (!data)
+	{
+		auto newData = std::make_unique<ThreadData>();
+		newData->events.resize(PROFILER_EVENTS_PER_THREAD);
 
-void Profiler::start(size_t index)
+		std::lock_guard<std::mutex> lock(registryMutex);
+		newData->index = threads.size();
+		newData->name = "Thread " + std::to_string(newData->index);
+		data = newData.get();
+		threads.push_back(std::move(newData));
+	}
+	return *data;
+}
+
+int64_t Profiler::getTimeNS()
 {
-	std::lock_guard<std::mutex> lock(addDataMutex);
-	threadProfilerData[std::this_thread::get_id()].profilerData[index].lastTimeSample = std::chrono::steady_clock::now();
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - startTime).count();
 }
 
-void Profiler::end(size_t index)
+uint16_t Profiler::registerZone(const std::string& name)
 {
-	auto end = std::chrono::steady_clock::now();
-	if (index >= PROFILER_SAMPLES_COUNT)
+	std::lock_guard<std::mutex> lock(registryMutex);
+	size_t count = zonesCount.load(std::memory_order_relaxed);
+	for (size_t i = 0; i < count; i++)
 	{
-		return;
+		if (zoneNames[i] == name)
+		{
+			return (uint16_t)i;
+		}
+	}
+	if (count >= PROFILER_MAX_ZONES)
+	{
+		std::cerr << "Too many profiler zones, " << name << " is counted as " << zoneNames[count - 1] << std::endl;
+		return (uint16_t)(count - 1);
+	}
+
+	zoneNames[count] = name;
+	zonesCount.store(count + 1, std::memory_order_release);
+	return (uint16_t)count;
+}
+
+size_t Profiler::getZonesCount()
+{
+	return zonesCount.load(std::memory_order_acquire);
+}
+
+const std::string& Profiler::getZoneName(size_t zone)
+{
+	return zoneNames[zone];
+}
+
+const glm::vec3& Profiler::getZoneColor(size_t zone)
+{
+	return profilerZonesColors[zone % PROFILER_ZONES_COLORS_COUNT];
+}
+
+void Profiler::setThreadName(const std::string& name)
+{
+	ThreadData& data = getThreadData();
+	std::lock_guard<std::mutex> lock(registryMutex);
+	data.name = name;
+}
+
+void Profiler::beginZone(uint16_t zone)
+{
+	ThreadData& data = getThreadData();
+	if (data.depth < PROFILER_MAX_DEPTH)
+	{
+		data.openZones[data.depth] = zone;
+		data.openZoneChildrenNS[data.depth] = 0;
+		data.openZoneStartNS[data.depth] = getTimeNS();
 	}
-	std::lock_guard<std::mutex> lock(addDataMutex);
-	ProfilerData& data = threadProfilerData[std::this_thread::get_id()].profilerData[index];
-	auto duration = std::chrono::duration_cast<std::chrono::nanoseconds>(end - data.lastTimeSample);
-	data.timeNS += duration.count();
-	data.lastTimeSample = end;
+	data.depth++;
 }
 
-void Profiler::reset(size_t index)
+void Profiler::endZone(uint16_t zone)
 {
-	if (index >= PROFILER_SAMPLES_COUNT)
+	int64_t endNS = getTimeNS();
+	ThreadData& data = getThreadData();
+	if (data.depth == 0)
 	{
 		return;
 	}
-	std::lock_guard<std::mutex> lock(addDataMutex);
-	for (auto& it : threadProfilerData)
+	data.depth--;
+	if (data.depth >= PROFILER_MAX_DEPTH)
 	{
-		for (size_t i = 0; i < PROFILER_SAMPLES_COUNT; i++)
-		{
-			it.second.profilerData[i].timeNS = 0.0f;
-		}
+		return;
 	}
+
+	if (data.openZones[data.depth] != zone)
+	{
+		std::cerr << "Profiler zone " << zoneNames[zone] << " is closed, but " << zoneNames[data.openZones[data.depth]] << " is open" << std::endl;
+	}
+
+	int64_t startNS = data.openZoneStartNS[data.depth];
+	int64_t duration = endNS - startNS;
+	data.zoneTimesNS[zone].fetch_add(duration - data.openZoneChildrenNS[data.depth], std::memory_order_relaxed);
+	if (data.depth > 0)
+	{
+		data.openZoneChildrenNS[data.depth - 1] += duration;
+	}
+
+	uint64_t count = data.eventsCount.load(std::memory_order_relaxed);
+	data.events[count & (PROFILER_EVENTS_PER_THREAD - 1)] = { startNS, endNS, zone, (uint16_t)data.depth };
+	data.eventsCount.store(count + 1, std::memory_order_release);
 }
 
 void Profiler::clean()
 {
-	
+	std::lock_guard<std::mutex> lock(registryMutex);
+	// buffers of threads that are still alive are kept
+	for (auto& data : threads)
+	{
+		data->eventsCount = 0;
+		for (auto& time : data->zoneTimesNS)
+		{
+			time = 0;
+		}
+	}
 }
 
 void Profiler::saveToMemory()
 {
-	std::lock_guard<std::mutex> lock(addDataMutex);
 	uint32_t timeSum = 0;
-
-	for (size_t i = 0; i < PROFILER_SAMPLES_COUNT; i++)
-	{
-		memoryTable[memoryTableIndex][i] = 0;
-	}
-	for (auto& it : threadProfilerData)
+	size_t count = getZonesCount();
+	uint32_t* row = memoryTable[memoryTableIndex];
+	std::fill(row, row + PROFILER_MAX_ZONES, 0);
 	{
-		PerThreadData& perThreadData = it.second;
-		for (size_t i = 0; i < PROFILER_SAMPLES_COUNT; i++)
+		std::lock_guard<std::mutex> lock(registryMutex);
+		for (auto& data : threads)
 		{
-			ProfilerData& data = perThreadData.profilerData[i];
-			timeSum += data.timeNS;
-			memoryTable[memoryTableIndex][i] += data.timeNS;
-			data.timeNS = 0;
+			for (size_t i = 0; i < count; i++)
+			{
+				uint32_t time = (uint32_t)data->zoneTimesNS[i].exchange(0, std::memory_order_relaxed);
+				row[i] += time;
+				timeSum += time;
+			}
 		}
 	}
 	maxTimeTable[memoryTableIndex] = timeSum;
@@ -109,3 +190,70 @@ void Profiler::saveToMemory()
 		memoryTableIndex = 0;
 	}
 }
+
+bool Profiler::exportChromeTrace(const std::string& path)
+{
+	std::ofstream file(path);
+	if (!file.is_open())
+	{
+		std::cerr << "Failed to open profiler trace file: " << path << std::endl;
+		return false;
+	}
+
+	// names come from code, so they aren't escaped
+	file << std::fixed << std::setprecision(3);
+	file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+	file << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":0,\"tid\":0,\"args\":{\"name\":\"PolyVoxelEngine\"}}";
+
+	std::lock_guard<std::mutex> lock(registryMutex);
+	std::vector<Event> events;
+	size_t eventsWritten = 0;
+	for (auto& data : threads)
+	{
+		file << ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":" << data->index << ",\"args\":{\"name\":\"" << data->name << "\"}}";
+
+		// thread keeps writing while events are copied, so events it may have overwritten are dropped
+		uint64_t count = data->eventsCount.load(std::memory_order_acquire);
+		uint64_t first = count > PROFILER_EVENTS_PER_THREAD ? count - PROFILER_EVENTS_PER_THREAD : 0;
+		events.clear();
+		for (uint64_t i = first; i < count; i++)
+		{
+			events.push_back(data->events[i & (PROFILER_EVENTS_PER_THREAD - 1)]);
+		}
+		uint64_t countAfterCopy = data->eventsCount.load(std::memory_order_acquire);
+		uint64_t firstValid = countAfterCopy > PROFILER_EVENTS_PER_THREAD ? countAfterCopy - PROFILER_EVENTS_PER_THREAD : 0;
+		size_t skipped = (size_t)std::min<uint64_t>(firstValid > first ? firstValid - first : 0, events.size());
+
+		for (size_t i = skipped; i < events.size(); i++)
+		{
+			const Event& event = events[i];
+			file << ",\n{\"name\":\"" << zoneNames[event.zone] << "\",\"ph\":\"X\",\"pid\":0,\"tid\":" << data->index
+				<< ",\"ts\":" << (double)event.startNS * 1e-3 << ",\"dur\":" << (double)(event.endNS - event.startNS) * 1e-3
+				<< ",\"args\":{\"depth\":" << event.depth << "}}";
+		}
+		eventsWritten += events.size() - skipped;
+	}
+	file << "\n]}\n";
+
+	std::cout << "Profiler trace with " << eventsWritten << " events saved to " << path << std::endl;
+	return true;
+}
+
+ProfilerZone::ProfilerZone(uint16_t zone) : zone(zone)
+{
+	Profiler::beginZone(zone);
+}
+
+ProfilerZone::~ProfilerZone()
+{
+	end();
+}
+
+void ProfilerZone::end()
+{
+	if (isOpen)
+	{
+		Profiler::endZone(zone);
+		isOpen = false;
+	}
+}
@@ -1,56 +1,97 @@
 #pragma once
+#include <atomic>
 #include <chrono>
 #include <cstdint>
 #include <glm/ext/vector_float3.hpp>
+#include <memory>
 #include <mutex>
-#include <unordered_map>
+#include <string>
+#include <vector>
 
 constexpr size_t PROFILER_MEMORY_TABLE_SIZE = 50;
-constexpr size_t PROFILER_SAMPLES_COUNT = 8;
-
-constexpr size_t BLOCK_GENERATION_INDEX = 0;
-constexpr size_t BLOCK_LIGHT_UPDATE_INDEX = 1;
-constexpr size_t SKY_LIGHT_UPDATE_INDEX = 2;
-constexpr size_t FACE_FETCHING_INDEX = 3;
-constexpr size_t GREEDY_MESHING_INDEX = 4;
-constexpr size_t LOAD_CHUNKS_INDEX = 5;
-constexpr size_t CHUNK_LOAD_DATA_INDEX = 6;
-constexpr size_t CHUNK_LIGHTING_INDEX = 7;
+constexpr size_t PROFILER_MAX_ZONES = 32;
+constexpr size_t PROFILER_MAX_DEPTH = 32;
+constexpr size_t PROFILER_EVENTS_PER_THREAD = 1 << 15; // power of two
 
 constexpr float PROFILER_DRAW_WIDTH = 0.5f;
 constexpr float PROFILER_DRAW_HEIGHT = 0.5f;
 constexpr float PROFILER_DRAW_COLOR_RECT_SIZE = 0.05f;
 constexpr float PROFILER_DRAW_COLOR_RECT_Y_OFFSET = 0.02f;
 
-extern const std::string profilerSamplesNames[PROFILER_SAMPLES_COUNT];
-extern const glm::vec3 profilerSamplesColors[PROFILER_SAMPLES_COUNT];
-
+// every thread records into its own buffer, no locks are taken while recording
+// mutex is only taken on zone or thread registration, when saving to memory and on export
 class Profiler
 {
-	struct ProfilerData
+	struct Event
 	{
-		std::chrono::steady_clock::time_point lastTimeSample;
-		uint32_t timeNS = 0;
+		int64_t startNS;
+		int64_t endNS;
+		uint16_t zone;
+		uint16_t depth;
 	};
 
-	struct PerThreadData
+	// written only by its thread
+	struct ThreadData
 	{
-		ProfilerData profilerData[PROFILER_SAMPLES_COUNT];
+		std::string name;
+		size_t index = 0;
+		std::vector<Event> events; // ring, oldest events are overwritten
+		std::atomic<uint64_t> eventsCount = 0; // all events ever written
+		std::atomic<uint64_t> zoneTimesNS[PROFILER_MAX_ZONES]{}; // self time since last saveToMemory
+
+		size_t depth = 0;
+		int64_t openZoneStartNS[PROFILER_MAX_DEPTH]{};
+		int64_t openZoneChildrenNS[PROFILER_MAX_DEPTH]{};
+		uint16_t openZones[PROFILER_MAX_DEPTH]{}; // to catch zones closed out of order
 	};
 
-	static std::unordered_map<std::thread::id, PerThreadData> threadProfilerData;
+	static std::mutex registryMutex;
+	static std::vector<std::unique_ptr<ThreadData>> threads;
+	static std::string zoneNames[PROFILER_MAX_ZONES];
+	static std::atomic<size_t> zonesCount;
+	static const std::chrono::steady_clock::time_point startTime;
+
+	static ThreadData& getThreadData();
+	static int64_t getTimeNS();
 public:
-	static uint32_t memoryTable[PROFILER_MEMORY_TABLE_SIZE][PROFILER_SAMPLES_COUNT];
+	static uint32_t memoryTable[PROFILER_MEMORY_TABLE_SIZE][PROFILER_MAX_ZONES];
 	static size_t memoryTableIndex;
 	static uint32_t maxTimeTable[PROFILER_MEMORY_TABLE_SIZE];
 	static uint32_t maxTime;
-	static std::mutex addDataMutex;
 
-	static void start(size_t index);
-	static void end(size_t index);
-	static void reset(size_t index);
+	static uint16_t registerZone(const std::string& name); // same name gives same zone
+	static size_t getZonesCount();
+	static const std::string& getZoneName(size_t zone);
+	static const glm::vec3& getZoneColor(size_t zone);
+	static void setThreadName(const std::string& name);
+
+	// zones must be closed in reverse order of opening, prefer ProfilerZone
+	static void beginZone(uint16_t zone);
+	static void endZone(uint16_t zone);
+
 	static void clean();
 
 	static void saveToMemory();
+	// chrome://tracing or Perfetto format, one row per thread
+	static bool exportChromeTrace(const std::string& path);
+};
+
+// zone open while object lives, end closes it earlier
+class ProfilerZone
+{
+	uint16_t zone;
+	bool isOpen = true;
+public:
+	ProfilerZone(uint16_t zone);
+	~ProfilerZone();
+
+	ProfilerZone(const ProfilerZone&) = delete;
+	ProfilerZone& operator=(const ProfilerZone&) = delete;
+
+	void end();
 };
 
+// declares ProfilerZone named variable, zone name is registered once per call site
+#define PROFILER_ZONE(variable, name) \
+	static const uint16_t variable##ID = Profiler::registerZone(name); \
+	ProfilerZone variable(variable##ID)
@@ -0,0 +1,104 @@
+#include "RangeAllocator.h"
+#include <iostream>
+
+RangeAllocator::RangeAllocator(size_t capacity)
+{
+	reset(capacity, 0);
+}
+
+void RangeAllocator::addFreeRange(size_t offset, size_t size)
+{
+	freeRangesByOffset.emplace(offset, size);
+	freeRangesBySize.emplace(size, offset);
+}
+
+void RangeAllocator::removeFreeRange(std::map<size_t, size_t>::iterator it)
+{
+	freeRangesBySize.erase({ it->second, it->first });
+	freeRangesByOffset.erase(it);
+}
+
+size_t RangeAllocator::allocate(size_t size)
+{
+	if (size == 0)
+	{
+		return INVALID_OFFSET;
+	}
+
+	auto best = freeRangesBySize.lower_bound({ size, 0 });
+	if (best == freeRangesBySize.end())
+	{
+		return INVALID_OFFSET;
+	}
+
+	size_t rangeSize = best->first;
+	size_t offset = best->second;
+	removeFreeRange(freeRangesByOffset.find(offset));
+	if (rangeSize > size)
+	{
+		addFreeRange(offset + size, rangeSize - size);
+	}
+	usedSize += size;
+	return offset;
+}
+
+void RangeAllocator::free(size_t offset, size_t size)
+{
+	if (size == 0)
+	{
+		return;
+	}
+	if (offset + size > capacity)
+	{
+		std::cerr << "Freed range is out of allocator capacity" << std::endl;
+		return;
+	}
+	usedSize -= size;
+
+	// merge with free ranges right after and right before
+	auto next = freeRangesByOffset.lower_bound(offset);
+	if (next != freeRangesByOffset.end() && next->first == offset + size)
+	{
+		size += next->second;
+		removeFreeRange(next);
+	}
+	auto previous = freeRangesByOffset.lower_bound(offset);
+	if (previous != freeRangesByOffset.begin())
+	{
+		previous--;
+		if (previous->first + previous->second == offset)
+		{
+			offset = previous->first;
+			size += previous->second;
+			removeFreeRange(previous);
+		}
+	}
+	addFreeRange(offset, size);
+}
+
+void RangeAllocator::reset(size_t capacity, size_t usedSize)
+{
+	this->capacity = capacity;
+	this->usedSize = usedSize;
+	freeRangesByOffset.clear();
+	freeRangesBySize.clear();
+	if (capacity > usedSize)
+	{
+		addFreeRange(usedSize, capacity - usedSize);
+	}
+}
+
+size_t RangeAllocator::getCapacity() const
+{
+	return capacity;
+}
+
+size_t RangeAllocator::getUsedSize() const
+{
+	return usedSize;
+}
+
+size_t RangeAllocator::getFreeRangesCount() const
+{
+	return freeRangesByOffset.size();
+}
@@ -0,0 +1,31 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <set>
+#include <utility>
+
+// best fit allocator of ranges in [0, capacity), doesn't own any memory
+// freed range is merged with free neighbours, so free ranges never touch
+class RangeAllocator
+{
+	std::map<size_t, size_t> freeRangesByOffset; // offset, size
+	std::set<std::pair<size_t, size_t>> freeRangesBySize; // size, offset
+	size_t capacity = 0;
+	size_t usedSize = 0;
+
+	void addFreeRange(size_t offset, size_t size);
+	void removeFreeRange(std::map<size_t, size_t>::iterator it);
+public:
+	static constexpr size_t INVALID_OFFSET = SIZE_MAX;
+
+	RangeAllocator(size_t capacity);
+
+	size_t allocate(size_t size); // INVALID_OFFSET when no free range is big enough
+	void free(size_t offset, size_t size);
+	void reset(size_t capacity, size_t usedSize); // after compaction, [0, usedSize) is taken and the rest is free
+
+	size_t getCapacity() const;
+	size_t getUsedSize() const;
+	size_t getFreeRangesCount() const;
+};
@@ -0,0 +1,466 @@
+#include "RegionFile.h"
+#include "ChunkIndex.h"
+#include "Metrics.h"
+#include <filesystem>
+#include <iostream>
+
+RegionFile::RegionFile(const std::string& filepath, size_t entriesCount)
+	: entries(entriesCount)
+{
+	bool exists = std::filesystem::exists(filepath) && std::filesystem::file_size(filepath) > 0;
+	if (!exists)
+	{
+		std::ofstream newFile(filepath, std::ios::binary | std::ios::trunc);
+		if (!newFile.is_open())
+		{
+			std::cerr << "Failed to create region file " << filepath << std::endl;
+			return;
+		}
+	}
+
+	file.open(filepath, std::ios::binary | std::ios::in | std::ios::out);
+	if (!file.is_open())
+	{
+		std::cerr << "Failed to open region file " << filepath << std::endl;
+		return;
+	}
+
+	size_t headerSectors = getSectorsCount(HEADER_SIZE + entriesCount * sizeof(Entry));
+	usedSectors.assign(headerSectors, true);
+
+	if (exists)
+	{
+		uint32_t header[3] = { 0, 0, 0 };
+		file.read(reinterpret_cast<char*>(header), sizeof(header));
+		if (header[0] != MAGIC || header[1] != VERSION || header[2] != entriesCount)
+		{
+			std::cerr << "Region file " << filepath << " has wrong header" << std::endl;
+			file.close();
+			return;
+		}
+
+		file.read(reinterpret_cast<char*>(entries.data()), entries.size() * sizeof(Entry));
+		if (!file)
+		{
+			std::cerr << "Region file " << filepath << " has truncated header" << std::endl;
+			file.close();
+			return;
+		}
+
+		// entries pointing into header or past end of file are corrupted, they are read as empty
+		size_t fileSectors = getSectorsCount(std::filesystem::file_size(filepath));
+		size_t corruptedCount = 0;
+		for (Entry& entry : entries)
+		{
+			if (entry.sector == 0)
+			{
+				continue;
+			}
+			size_t sectorsCount = getSectorsCount(entry.size);
+			if (entry.sector < headerSectors || (size_t)entry.sector + sectorsCount > fileSectors)
+			{
+				entry = Entry();
+				corruptedCount++;
+				continue;
+			}
+			setSectorsUsed(entry.sector, sectorsCount, true);
+		}
+		if (corruptedCount > 0)
+		{
+			std::cerr << "Region file " << filepath << " has " << corruptedCount << " corrupted entries" << std::endl;
+		}
+		return;
+	}
+
+	uint32_t header[3] = { MAGIC, VERSION, (uint32_t)entriesCount };
+	file.write(reinterpret_cast<const char*>(header), sizeof(header));
+	file.write(reinterpret_cast<const char*>(entries.data()), entries.size() * sizeof(Entry));
+
+	// header takes whole sectors
+	size_t padding = headerSectors * SECTOR_SIZE - HEADER_SIZE - entries.size() * sizeof(Entry);
+	std::vector<char> zeros(padding, 0);
+	file.write(zeros.data(), zeros.size());
+	file.flush();
+}
+
+size_t RegionFile::getSectorsCount(size_t size)
+{
+	return (size + SECTOR_SIZE - 1) / SECTOR_SIZE;
+}
+
+void RegionFile::setSectorsUsed(uint32_t sector, size_t count, bool used)
+{
+	if (sector + count > usedSectors.size())
+	{
+		usedSectors.resize(sector + count, false);
+	}
+	for (size_t i = 0; i < count; i++)
+	{
+		usedSectors[sector + i] = used;
+	}
+}
+
+uint32_t RegionFile::allocateSectors(size_t count)
+{
+	// first fit, file grows only when there is no free run
+	size_t runStart = 0;
+	size_t runLength = 0;
+	for (size_t i = 0; i < usedSectors.size(); i++)
+	{
+		if (usedSectors[i])
+		{
+			runLength = 0;
+			continue;
+		}
+		if (runLength == 0)
+		{
+			runStart = i;
+		}
+		runLength++;
+		if (runLength == count)
+		{
+			setSectorsUsed((uint32_t)runStart, count, true);
+			return (uint32_t)runStart;
+		}
+	}
+
+	uint32_t sector = (uint32_t)(runLength > 0 ? runStart : usedSectors.size());
+	setSectorsUsed(sector, count, true);
+	return sector;
+}
+
+void RegionFile::writeEntry(size_t index)
+{
+	file.seekp(HEADER_SIZE + index * sizeof(Entry));
+	file.write(reinterpret_cast<const char*>(&entries[index]), sizeof(Entry));
+}
+
+bool RegionFile::isOpen() const
+{
+	return file.is_open();
+}
+
+bool RegionFile::read(size_t index, std::vector<char>& data)
+{
+	const Entry& entry = entries[index];
+	if (!file.is_open() || entry.sector == 0)
+	{
+		return false;
+	}
+
+	data.resize(entry.size);
+	file.clear();
+	file.seekg((std::streamoff)entry.sector * SECTOR_SIZE);
+	file.read(data.data(), entry.size);
+	if (!file)
+	{
+		std::cerr << "Failed to read region file entry" << std::endl;
+		file.clear();
+		return false;
+	}
+	return true;
+}
+
+void RegionFile::write(size_t index, const char* data, size_t size)
+{
+	if (!file.is_open())
+	{
+		return;
+	}
+	file.clear();
+
+	Entry& entry = entries[index];
+	size_t prevSectorsCount = entry.sector != 0 ? getSectorsCount(entry.size) : 0;
+	size_t sectorsCount = getSectorsCount(size);
+
+	if (sectorsCount <= prevSectorsCount)
+	{
+		// rewrite in place, free the tail
+		setSectorsUsed(entry.sector + (uint32_t)sectorsCount, prevSectorsCount - sectorsCount, false);
+		if (sectorsCount == 0)
+		{
+			entry.sector = 0;
+		}
+	}
+	else
+	{
+		if (prevSectorsCount > 0)
+		{
+			setSectorsUsed(entry.sector, prevSectorsCount, false);
+		}
+		entry.sector = allocateSectors(sectorsCount);
+	}
+	entry.size = (uint32_t)size;
+
+	if (sectorsCount > 0)
+	{
+		file.seekp((std::streamoff)entry.sector * SECTOR_SIZE);
+		file.write(data, size);
+
+		// keep sectors whole, so appended entries always start at sector boundary
+		size_t padding = sectorsCount * SECTOR_SIZE - size;
+		static const char zeros[SECTOR_SIZE] = {};
+		file.write(zeros, padding);
+	}
+	writeEntry(index);
+	file.flush();
+	METRICS_ADD("DiskBytesWritten", sectorsCount * SECTOR_SIZE + sizeof(Entry));
+
+	if (!file)
+	{
+		std::cerr << "Failed to write region file entry" << std::endl;
+		file.clear();
+	}
+}
+
+RegionStorage::RegionStorage(const std::string& directory, bool threeDimensional)
+	: directory(directory), threeDimensional(threeDimensional)
+{}
+
+RegionStorage::~RegionStorage()
+{
+	close();
+}
+
+RegionFile* RegionStorage::getRegionFile(int regionX, int regionY, int regionZ, bool create)
+{
+	uint64_t key = ChunkIndex::getKey(regionX, regionY, regionZ);
+	useTick++;
+
+	const auto& it = openedFiles.find(key);
+	if (it != openedFiles.end())
+	{
+		it->second.lastUseTick = useTick;
+		return it->second.regionFile;
+	}
+
+	if (!create && missingRegions.find(key) != missingRegions.end())
+	{
+		return nullptr;
+	}
+	std::string filepath = getFilepath(regionX, regionY, regionZ);
+	if (!create && !std::filesystem::exists(filepath))
+	{
+		missingRegions.insert(key);
+		return nullptr;
+	}
+	missingRegions.erase(key);
+
+	// close least recently used file
+	if (openedFiles.size() >= MAX_OPENED_FILES)
+	{
+		auto oldest = openedFiles.begin();
+		for (auto it = openedFiles.begin(); it != openedFiles.end(); it++)
+		{
+			if (it->second.lastUseTick < oldest->second.lastUseTick)
+			{
+				oldest = it;
+			}
+		}
+		delete oldest->second.regionFile;
+		openedFiles.erase(oldest);
+	}
+
+	size_t entriesCount = threeDimensional ? REGION_SIZE * REGION_SIZE * REGION_SIZE : REGION_SIZE * REGION_SIZE;
+	RegionFile* regionFile = new RegionFile(filepath, entriesCount);
+	if (!regionFile->isOpen())
+	{
+		delete regionFile;
+		return nullptr;
+	}
+	openedFiles[key] = { regionFile, useTick };
+	return regionFile;
+}
+
+size_t RegionStorage::getEntryIndex(int x, int y, int z) const
+{
+	size_t localX = x & (REGION_SIZE - 1);
+	size_t localY = threeDimensional ? (y & (REGION_SIZE - 1)) : 0;
+	size_t localZ = z & (REGION_SIZE - 1);
+	if (threeDimensional)
+	{
+		return localX + (localY + localZ * REGION_SIZE) * REGION_SIZE;
+	}
+	return localX + localZ * REGION_SIZE;
+}
+
+std::string RegionStorage::getFilepath(int regionX, int regionY, int regionZ) const
+{
+	std::string path = directory;
+	path += std::to_string(regionX);
+	path += "_";
+	if (threeDimensional)
+	{
+		path += std::to_string(regionY);
+		path += "_";
+	}
+	path += std::to_string(regionZ);
+	path += ".region";
+	return path;
+}
+
+bool RegionStorage::read(int x, int y, int z, std::vector<char>& data)
+{
+	// queued data is newer than data on disk
+	{
+		std::lock_guard<std::mutex> lock(pendingMutex);
+		uint64_t key = ChunkIndex::getKey(x, threeDimensional ? y : 0, z);
+		for (const auto* writes : { &pendingWrites, &writingWrites })
+		{
+			const auto& it = writes->find(key);
+			if (it != writes->end())
+			{
+				data = it->second.data;
+				return !data.empty();
+			}
+		}
+	}
+
+	std::lock_guard<std::mutex> lock(mutex);
+	int regionY = threeDimensional ? (y >> REGION_SHIFT) : 0;
+	RegionFile* regionFile = getRegionFile(x >> REGION_SHIFT, regionY, z >> REGION_SHIFT, false);
+	if (regionFile == nullptr)
+	{
+		return false;
+	}
+	return regionFile->read(getEntryIndex(x, y, z), data);
+}
+
+void RegionStorage::write(int x, int y, int z, const char* data, size_t size)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	int regionY = threeDimensional ? (y >> REGION_SHIFT) : 0;
+	RegionFile* regionFile = getRegionFile(x >> REGION_SHIFT, regionY, z >> REGION_SHIFT, size > 0);
+	if (regionFile == nullptr)
+	{
+		return;
+	}
+	regionFile->write(getEntryIndex(x, y, z), data, size);
+}
+
+void RegionStorage::writeAsync(int x, int y, int z, std::vector<char>&& data)
+{
+	if (!threeDimensional)
+	{
+		y = 0;
+	}
+	std::lock_guard<std::mutex> lock(pendingMutex);
+	PendingWrite& pendingWrite = pendingWrites[ChunkIndex::getKey(x, y, z)];
+	pendingWrite.x = x;
+	pendingWrite.y = y;
+	pendingWrite.z = z;
+	pendingWrite.data = std::move(data);
+}
+
+void RegionStorage::writePending()
+{
+	std::lock_guard<std::mutex> writeLock(writePendingMutex);
+	{
+		std::lock_guard<std::mutex> lock(pendingMutex);
+		if (pendingWrites.empty())
+		{
+			return;
+		}
+		writingWrites.swap(pendingWrites);
+	}
+
+	for (const auto& pair : writingWrites)
+	{
+		const PendingWrite& pendingWrite = pair.second;
+		write(pendingWrite.x, pendingWrite.y, pendingWrite.z, pendingWrite.data.data(), pendingWrite.data.size());
+	}
+
+	std::lock_guard<std::mutex> lock(pendingMutex);
+	writingWrites.clear();
+}
+
+bool RegionStorage::hasPendingWrites()
+{
+	std::lock_guard<std::mutex> lock(pendingMutex);
+	return !pendingWrites.empty() || !writingWrites.empty();
+}
+
+void RegionStorage::close()
+{
+	writePending();
+
+	std::lock_guard<std::mutex> lock(mutex);
+	for (const auto& pair : openedFiles)
+	{
+		delete pair.second.regionFile;
+	}
+	openedFiles.clear();
+	missingRegions.clear();
+}
+
+void RegionStorage::importLegacyFiles()
+{
+	if (!std::filesystem::exists(directory))
+	{
+		return;
+	}
+
+	std::vector<std::filesystem::path> legacyFiles;
+	for (const auto& directoryEntry : std::filesystem::directory_iterator(directory))
+	{
+		if (directoryEntry.is_regular_file() && directoryEntry.path().extension() == ".bin")
+		{
+			legacyFiles.push_back(directoryEntry.path());
+		}
+	}
+
+	std::vector<char> data;
+	for (const auto& filepath : legacyFiles)
+	{
+		// name is coordinates separated by '_'
+		std::string name = filepath.stem().string();
+		int coords[3] = { 0, 0, 0 };
+		size_t coordsCount = threeDimensional ? 3 : 2;
+		size_t position = 0;
+		bool valid = true;
+		for (size_t i = 0; i < coordsCount && valid; i++)
+		{
+			size_t separator = name.find('_', position);
+			bool last = i + 1 == coordsCount;
+			if (last != (separator == std::string::npos))
+			{
+				valid = false;
+				break;
+			}
+			try
+			{
+				coords[i] = std::stoi(name.substr(position, separator - position));
+			}
+			catch (const std::exception&)
+			{
+				valid = false;
+			}
+			position = separator + 1;
+		}
+		if (!valid)
+		{
+			continue;
+		}
+
+		std::ifstream file(filepath, std::ios::binary | std::ios::ate);
+		if (!file.is_open())
+		{
+			std::cerr << "Failed to open legacy save file " << filepath << std::endl;
+			continue;
+		}
+		data.resize((size_t)file.tellg());
+		file.seekg(0);
+		file.read(data.data(), data.size());
+		file.close();
+
+		if (threeDimensional)
+		{
+			write(coords[0], coords[1], coords[2], data.data(), data.size());
+		}
+		else
+		{
+			write(coords[0], 0, coords[1], data.data(), data.size());
+		}
+		std::filesystem::remove(filepath);
+	}
+}
@@ -0,0 +1,97 @@
+#pragma once
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+// single file with fixed number of entries
+// header: magic, version, entries count, offset table (first sector and size of each entry)
+// entries are stored in whole sectors, rewritten in place while they fit, otherwise moved to first free run
+class RegionFile
+{
+	struct Entry
+	{
+		uint32_t sector = 0; // 0 - no data
+		uint32_t size = 0;
+	};
+
+	static constexpr uint32_t MAGIC = 0x47525650; // "PVRG"
+	static constexpr uint32_t VERSION = 1;
+	static constexpr size_t HEADER_SIZE = 3 * sizeof(uint32_t);
+	static constexpr size_t SECTOR_SIZE = 256;
+
+	std::fstream file;
+	std::vector<Entry> entries;
+	std::vector<bool> usedSectors;
+
+	static size_t getSectorsCount(size_t size);
+	void setSectorsUsed(uint32_t sector, size_t count, bool used);
+	uint32_t allocateSectors(size_t count);
+	void writeEntry(size_t index);
+public:
+	RegionFile(const std::string& filepath, size_t entriesCount);
+
+	RegionFile(const RegionFile&) = delete;
+	RegionFile& operator=(const RegionFile&) = delete;
+
+	bool isOpen() const;
+	bool read(size_t index, std::vector<char>& data);
+	void write(size_t index, const char* data, size_t size);
+};
+
+// chunk (or chunk column) data grouped into region files of REGION_SIZE chunks per axis
+// thread safe, keeps limited number of region files open
+// writeAsync only queues data (newer write to the same chunk replaces queued one), writePending stores it
+class RegionStorage
+{
+	struct OpenedFile
+	{
+		RegionFile* regionFile = nullptr;
+		uint64_t lastUseTick = 0;
+	};
+
+	struct PendingWrite
+	{
+		int x = 0, y = 0, z = 0;
+		std::vector<char> data;
+	};
+
+	static constexpr int REGION_SHIFT = 4;
+	static constexpr int REGION_SIZE = 1 << REGION_SHIFT;
+	static constexpr size_t MAX_OPENED_FILES = 32;
+
+	std::string directory;
+	bool threeDimensional;
+	std::mutex mutex;
+	std::unordered_map<uint64_t, OpenedFile> openedFiles;
+	std::unordered_set<uint64_t> missingRegions; // avoids checking disk again for regions without file
+	uint64_t useTick = 0;
+
+	std::mutex pendingMutex;
+	std::unordered_map<uint64_t, PendingWrite> pendingWrites;
+	std::unordered_map<uint64_t, PendingWrite> writingWrites; // taken by writePending, still visible to read
+	std::mutex writePendingMutex;
+
+	RegionFile* getRegionFile(int regionX, int regionY, int regionZ, bool create);
+	size_t getEntryIndex(int x, int y, int z) const;
+	std::string getFilepath(int regionX, int regionY, int regionZ) const;
+public:
+	RegionStorage(const std::string& directory, bool threeDimensional);
+	~RegionStorage();
+
+	RegionStorage(const RegionStorage&) = delete;
+	RegionStorage& operator=(const RegionStorage&) = delete;
+
+	// y is ignored for two dimensional storage
+	bool read(int x, int y, int z, std::vector<char>& data);
+	void write(int x, int y, int z, const char* data, size_t size);
+	void writeAsync(int x, int y, int z, std::vector<char>&& data);
+	void writePending();
+	bool hasPendingWrites();
+	void close(); // writes pending data
+
+	// moves old one file per chunk saves (x_y_z.bin or x_z.bin) into regions
+	void importLegacyFiles();
+};
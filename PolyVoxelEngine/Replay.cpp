@@ -0,0 +1,199 @@
+#include "Replay.h"
+#include "FlythroughTrace.h"
+#include "ChunkLifecycle.h"
+#include "GraphicController.h"
+#include "PhysicEntity.h"
+#include "Player.h"
+#include "World.h"
+#include "WorldRenderer.h"
+#include <GLFW/glfw3.h>
+#include <glm/gtx/norm.hpp>
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <vector>
+
+struct TimingResult
+{
+	size_t samplesCount = 0;
+	uint64_t meanNS = 0;
+	uint64_t p50NS = 0;
+	uint64_t p90NS = 0;
+	uint64_t p99NS = 0;
+	uint64_t maxNS = 0;
+};
+
+static uint64_t getElapsedNS(std::chrono::steady_clock::time_point start)
+{
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+}
+
+static TimingResult calculateTimingResult(std::vector<uint64_t>& samples)
+{
+	TimingResult result;
+	result.samplesCount = samples.size();
+	if (samples.empty())
+	{
+		return result;
+	}
+
+	std::sort(samples.begin(), samples.end());
+	auto percentile = [&samples](double p)
+		{
+			return samples[(size_t)(p * (double)(samples.size() - 1) + 0.5)];
+		};
+
+	uint64_t sum = 0;
+	for (uint64_t sample : samples)
+	{
+		sum += sample;
+	}
+	result.meanNS = sum / samples.size();
+	result.p50NS = percentile(0.5);
+	result.p90NS = percentile(0.9);
+	result.p99NS = percentile(0.99);
+	result.maxNS = samples.back();
+	return result;
+}
+
+int Replay::run(const ReplaySettings& settings)
+{
+	FlythroughTrace trace;
+	if (!trace.load(settings.tracePath))
+	{
+		return 1;
+	}
+	std::cout << "Replaying " << trace.ticks.size() << " ticks and " << trace.edits.size() << " block edits, seed " << trace.seed << std::endl;
+
+	// same world on every run
+	bool chunkPersistence = Settings::DynamicSettings::chunkPersistence;
+	Settings::DynamicSettings::chunkPersistence = false;
+
+	WorldData worldData;
+	worldData.seed = trace.seed;
+	worldData.playerPosition = trace.ticks[0].position;
+	worldData.playerRotation = trace.ticks[0].rotation;
+
+	std::vector<uint64_t> frameTimes;
+	std::vector<uint64_t> tickTimes;
+	frameTimes.reserve(trace.ticks.size());
+	tickTimes.reserve(trace.ticks.size());
+	auto replayStart = std::chrono::steady_clock::now();
+	{
+		World world(worldData);
+		// without drawing meshes stay in CPU buffers and nothing is uploaded
+		std::unique_ptr<WorldRenderer> worldRenderer;
+		if (settings.draw)
+		{
+			worldRenderer = std::make_unique<WorldRenderer>(world);
+		}
+		PhysicEntity::world = &world;
+		Player* player = new Player(worldData.playerPosition, 80.0f, 0.1f, Settings::MAX_RENDER_DISTANCE);
+		player->rotation = worldData.playerRotation;
+		player->previousRotation = worldData.playerRotation;
+
+		const float dt = 1.0f / (float)trace.ticksPerSecond;
+		const size_t ticksPerWorldTick = std::max<size_t>(trace.ticksPerSecond / Settings::WORLD_TICK_RATE, 1);
+		size_t editIndex = 0;
+		for (size_t tick = 0; tick < trace.ticks.size(); tick++)
+		{
+			if (GraphicController::shouldWindowClose())
+			{
+				std::cout << "Replay stopped at tick " << tick << std::endl;
+				break;
+			}
+			auto frameStart = std::chrono::steady_clock::now();
+
+			while (editIndex < trace.edits.size() && trace.edits[editIndex].tick <= tick)
+			{
+				const FlythroughTrace::BlockEdit& edit = trace.edits[editIndex];
+				world.setBlockAt(edit.x, edit.y, edit.z, edit.block);
+				editIndex++;
+			}
+
+			const FlythroughTrace::TickState& state = trace.ticks[tick];
+			PhysicEntity& physicEntity = player->physicEntity;
+			physicEntity.previousPosition = physicEntity.position;
+			physicEntity.position = state.position;
+			physicEntity.velocity = (physicEntity.position - physicEntity.previousPosition) / dt;
+			// placements colliding with player are rejected like while recording
+			physicEntity.updateChunk();
+			player->previousRotation = player->rotation;
+			player->rotation = state.rotation;
+
+			if (tick % ticksPerWorldTick == 0)
+			{
+				auto tickStart = std::chrono::steady_clock::now();
+				world.update(physicEntity.position, glm::length2(physicEntity.velocity) > 5.0f);
+				tickTimes.push_back(getElapsedNS(tickStart));
+			}
+
+			if (settings.draw)
+			{
+				player->update(1.0f);
+				GraphicController::beforeRender();
+				player->BeforeRender();
+				worldRenderer->draw(player->camera);
+				GraphicController::afterRender();
+			}
+			glfwPollEvents();
+
+			frameTimes.push_back(getElapsedNS(frameStart));
+		}
+
+		player->clean();
+		delete player;
+		PhysicEntity::world = nullptr;
+	}
+	uint64_t replayNS = getElapsedNS(replayStart);
+	Settings::DynamicSettings::chunkPersistence = chunkPersistence;
+
+	// results
+	const char* seriesNames[2] = { "Frame", "WorldTick" };
+	TimingResult results[2] = { calculateTimingResult(frameTimes), calculateTimingResult(tickTimes) };
+
+	std::cout << "Replay took " << std::fixed << std::setprecision(2) << replayNS * 1e-9 << " s, trace is "
+		<< (double)trace.ticks.size() / trace.ticksPerSecond << " s, draw: " << settings.draw << std::endl;
+	std::cout << std::left << std::setw(12) << "series"
+		<< std::right << std::setw(10) << "samples"
+		<< std::setw(10) << "mean ms"
+		<< std::setw(10) << "p50 ms"
+		<< std::setw(10) << "p90 ms"
+		<< std::setw(10) << "p99 ms"
+		<< std::setw(10) << "max ms" << std::endl;
+	std::cout << std::setprecision(3);
+	for (size_t i = 0; i < 2; i++)
+	{
+		const TimingResult& result = results[i];
+		std::cout << std::left << std::setw(12) << seriesNames[i]
+			<< std::right << std::setw(10) << result.samplesCount
+			<< std::setw(10) << result.meanNS * 1e-6
+			<< std::setw(10) << result.p50NS * 1e-6
+			<< std::setw(10) << result.p90NS * 1e-6
+			<< std::setw(10) << result.p99NS * 1e-6
+			<< std::setw(10) << result.maxNS * 1e-6 << std::endl;
+	}
+	ChunkLifecycle::report(std::cout);
+
+	if (!settings.csvPath.empty())
+	{
+		std::ofstream file(settings.csvPath, std::ios::trunc);
+		if (!file.is_open())
+		{
+			std::cerr << "Failed to open replay csv file" << std::endl;
+		}
+		else
+		{
+			file << "series,samples,mean_ns,p50_ns,p90_ns,p99_ns,max_ns" << std::endl;
+			for (size_t i = 0; i < 2; i++)
+			{
+				const TimingResult& result = results[i];
+				file << seriesNames[i] << "," << result.samplesCount << "," << result.meanNS << "," << result.p50NS << "," << result.p90NS << "," << result.p99NS << "," << result.maxNS << std::endl;
+			}
+		}
+	}
+	return 0;
+}
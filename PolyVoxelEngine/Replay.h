@@ -0,0 +1,17 @@
+#pragma once
+#include <string>
+
+struct ReplaySettings
+{
+	std::string tracePath;
+	bool draw = false; // world is drawn every tick, otherwise only updated
+	std::string csvPath = "";
+};
+
+// plays FlythroughTrace with fixed timestep on world generated from trace seed, saved chunk changes are ignored
+// prints frame and world tick time statistics at the end
+class Replay
+{
+public:
+	static int run(const ReplaySettings& settings);
+};
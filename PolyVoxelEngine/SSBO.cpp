@@ -14,11 +14,28 @@ void SSBO::setData(const char* data, size_t size) const
 	glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, size, data);
 }
 
+void SSBO::setData(const char* data, size_t offset, size_t size) const
+{
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, ID);
+	glBufferSubData(GL_SHADER_STORAGE_BUFFER, offset, size, data);
+}
+
+void SSBO::getData(char* data, size_t size) const
+{
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, ID);
+	glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, size, data);
+}
+
 void SSBO::bindBase(size_t slot) const
 {
 	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, slot, ID);
 }
 
+void SSBO::bindAsParameterBuffer() const
+{
+	glBindBuffer(GL_PARAMETER_BUFFER, ID);
+}
+
 void SSBO::clean() const
 {
 	glDeleteBuffers(1, &ID);
@@ -6,7 +6,10 @@ class SSBO
 public:
 	SSBO(size_t size);
 	void setData(const char* data, size_t size) const;
+	void setData(const char* data, size_t offset, size_t size) const;
+	void getData(char* data, size_t size) const; // waits for GPU writes
 
 	void bindBase(size_t slot) const;
+	void bindAsParameterBuffer() const; // draw count source of glMultiDraw*IndirectCount
 	void clean() const;
 };
@@ -0,0 +1,67 @@
+#include "SaveThread.h"
+#include "Profiler.h"
+#include "RegionFile.h"
+#include <chrono>
+
+std::thread SaveThread::thread;
+std::mutex SaveThread::mutex;
+std::condition_variable SaveThread::wakeSignal;
+bool SaveThread::stopThread = false;
+std::vector<RegionStorage*> SaveThread::storages;
+
+void SaveThread::run()
+{
+	Profiler::setThreadName("Save");
+	while (true)
+	{
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			wakeSignal.wait_for(lock, std::chrono::milliseconds(WRITE_INTERVAL_MS), []() { return stopThread; });
+			if (stopThread)
+			{
+				return;
+			}
+		}
+
+		PROFILER_ZONE(zone, "WriteRegions");
+		for (RegionStorage* storage : storages)
+		{
+			storage->writePending();
+		}
+	}
+}
+
+void SaveThread::start(const std::vector<RegionStorage*>& regionStorages)
+{
+	if (thread.joinable())
+	{
+		return;
+	}
+	storages = regionStorages;
+	stopThread = false;
+	thread = std::thread(run);
+}
+
+void SaveThread::flush()
+{
+	// writePending of one storage doesn't run twice at once, so this waits for the pass in progress
+	for (RegionStorage* storage : storages)
+	{
+		storage->writePending();
+	}
+}
+
+void SaveThread::stop()
+{
+	if (thread.joinable())
+	{
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			stopThread = true;
+		}
+		wakeSignal.notify_one();
+		thread.join();
+	}
+	flush();
+	storages.clear();
+}
@@ -0,0 +1,26 @@
+#pragma once
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+class RegionStorage;
+
+// writes data queued with RegionStorage::writeAsync in background
+// waits a bit between passes, so repeated saves of the same chunk are written once
+class SaveThread
+{
+	static std::thread thread;
+	static std::mutex mutex;
+	static std::condition_variable wakeSignal;
+	static bool stopThread;
+	static std::vector<RegionStorage*> storages;
+
+	static void run();
+public:
+	static constexpr int WRITE_INTERVAL_MS = 250;
+
+	static void start(const std::vector<RegionStorage*>& regionStorages);
+	static void flush(); // returns when everything queued before the call is written
+	static void stop(); // flushes
+};
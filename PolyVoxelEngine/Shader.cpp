@@ -52,11 +52,27 @@ static GLuint CreateShader(GLuint type, const char* filepath, const std::vector<
 	return shader;
 }
 
-Shader::Shader(const std::string& name, const std::string& flags) : name(name)
+Shader::Shader(const std::string& name, const std::string& flags, ShaderType type) : name(name)
 {
 	// shaders
 	auto vectorOfFlags = splitString(flags, ';');
 
+	ID = glCreateProgram();
+	if (type == ShaderType::Compute)
+	{
+		GLuint computeShader = CreateShader(GL_COMPUTE_SHADER, ("res/shaders/" + name + ".comp").c_str(), vectorOfFlags);
+		glCompileShader(computeShader);
+		checkForCompilationErrors(computeShader, "COMPUTE");
+
+		// shader program
+		glAttachShader(ID, computeShader);
+		glLinkProgram(ID);
+		checkForCompilationErrors(ID, "PROGRAM");
+
+		glDeleteShader(computeShader);
+		return;
+	}
+
 	GLuint vertexShader = CreateShader(GL_VERTEX_SHADER, ("res/shaders/" + name + ".vert").c_str(), vectorOfFlags);
 	glCompileShader(vertexShader);
 	checkForCompilationErrors(vertexShader, "VERTEX");
@@ -66,7 +82,6 @@ Shader::Shader(const std::string& name, const std::string& flags) : name(name)
 	checkForCompilationErrors(fragmentShader, "FRAGMENT");
 
 	// shader program
-	ID = glCreateProgram();
 	glAttachShader(ID, vertexShader);
 	glAttachShader(ID, fragmentShader);
 	glLinkProgram(ID);
@@ -149,6 +164,18 @@ void Shader::setUniformMat4(const std::string& name, const glm::mat4& matrix)
 	glUniformMatrix4fv(position, 1, GL_FALSE, glm::value_ptr(matrix));
 }
 
+void Shader::setUniformUInt(const std::string& name, unsigned int value)
+{
+	GLint position = getUniformPosition(name);
+	glUniform1ui(position, value);
+}
+
+void Shader::setUniformFloat4Array(const std::string& name, const float* values, size_t count)
+{
+	GLint position = getUniformPosition(name);
+	glUniform4fv(position, (GLsizei)count, values);
+}
+
 void Shader::checkForCompilationErrors(unsigned int shader, const char* type) const
 {
 	GLint hasCompiled;
@@ -4,12 +4,18 @@
 #include <glm/fwd.hpp>
 #include <string>
 
+enum class ShaderType
+{
+	Graphics, // name.vert and name.frag
+	Compute // name.comp
+};
+
 class Shader
 {
 	std::string name;
 public:
 	GLuint ID;
-	Shader(const std::string& name, const std::string& flags = "");
+	Shader(const std::string& name, const std::string& flags = "", ShaderType type = ShaderType::Graphics);
 
 	void bind() const;
 	void unbind() const;
@@ -23,6 +29,8 @@ public:
 	void setUniformInt(const std::string& name, int value);
 	void setUniformInt2(const std::string& name, int v0, int v1);
 	void setUniformMat4(const std::string& name, const glm::mat4& matrix);
+	void setUniformUInt(const std::string& name, unsigned int value);
+	void setUniformFloat4Array(const std::string& name, const float* values, size_t count);
 private:
 	std::unordered_map<std::string, GLuint> uniformCache;
 
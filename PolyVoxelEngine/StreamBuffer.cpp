@@ -0,0 +1,138 @@
+#include "StreamBuffer.h"
+#include <glad/glad.h>
+#include <algorithm>
+#include <iostream>
+
+size_t StreamBuffer::alignment = 0;
+
+StreamBuffer::StreamBuffer(size_t regionSize)
+{
+	if (alignment == 0)
+	{
+		// offsets are bound as shader storage ranges and used as indirect command offsets
+		GLint storageAlignment = 0;
+		glGetIntegerv(GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT, &storageAlignment);
+		alignment = std::max((size_t)storageAlignment, (size_t)16);
+	}
+	this->regionSize = (regionSize + alignment - 1) / alignment * alignment;
+
+	GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+	glGenBuffers(1, &ID);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, ID);
+	glBufferStorage(GL_COPY_WRITE_BUFFER, this->regionSize * REGIONS_COUNT, nullptr, flags);
+	mappedData = (char*)glMapBufferRange(GL_COPY_WRITE_BUFFER, 0, this->regionSize * REGIONS_COUNT, flags);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+	if (!mappedData)
+	{
+		std::cerr << "Failed to map stream buffer" << std::endl;
+	}
+}
+
+char* StreamBuffer::allocate(size_t size, size_t& offset, bool held)
+{
+	size_t alignedSize = (size + alignment - 1) / alignment * alignment;
+
+	std::lock_guard<std::mutex> lock(mutex);
+	size_t& usedSize = usedSizes[currentRegion];
+	if (!mappedData || usedSize + alignedSize > regionSize)
+	{
+		return nullptr;
+	}
+
+	offset = currentRegion * regionSize + usedSize;
+	usedSize += alignedSize;
+	if (held)
+	{
+		heldAllocations[currentRegion]++;
+	}
+	return mappedData + offset;
+}
+
+void StreamBuffer::release(size_t offset)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	size_t region = offset / regionSize;
+	heldAllocations[region]--;
+	releasedThisFrame[region] = true;
+}
+
+void StreamBuffer::endFrame()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+
+	// released region may be read by commands issued after its last fence
+	releasedThisFrame[currentRegion] = true;
+	for (size_t region = 0; region < REGIONS_COUNT; region++)
+	{
+		if (!releasedThisFrame[region])
+		{
+			continue;
+		}
+		if (fences[region])
+		{
+			glDeleteSync((GLsync)fences[region]);
+		}
+		fences[region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+		releasedThisFrame[region] = false;
+	}
+
+	size_t nextRegion = (currentRegion + 1) % REGIONS_COUNT;
+	if (heldAllocations[nextRegion] > 0)
+	{
+		// keep writing after data of this frame
+		return;
+	}
+
+	if (fences[nextRegion])
+	{
+		GLenum result;
+		do
+		{
+			result = glClientWaitSync((GLsync)fences[nextRegion], GL_SYNC_FLUSH_COMMANDS_BIT, 1000000);
+		} while (result == GL_TIMEOUT_EXPIRED);
+		if (result == GL_WAIT_FAILED)
+		{
+			std::cerr << "Failed to wait for stream buffer fence" << std::endl;
+		}
+		glDeleteSync((GLsync)fences[nextRegion]);
+		fences[nextRegion] = nullptr;
+	}
+	usedSizes[nextRegion] = 0;
+	currentRegion = nextRegion;
+}
+
+void StreamBuffer::bindRange(size_t slot, size_t offset, size_t size) const
+{
+	glBindBufferRange(GL_SHADER_STORAGE_BUFFER, slot, ID, offset, size);
+}
+
+void StreamBuffer::bindAsIndirectBuffer() const
+{
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, ID);
+}
+
+unsigned int StreamBuffer::getID() const
+{
+	return ID;
+}
+
+void StreamBuffer::clean()
+{
+	for (void*& fence : fences)
+	{
+		if (fence)
+		{
+			glDeleteSync((GLsync)fence);
+			fence = nullptr;
+		}
+	}
+	if (mappedData)
+	{
+		glBindBuffer(GL_COPY_WRITE_BUFFER, ID);
+		glUnmapBuffer(GL_COPY_WRITE_BUFFER);
+		glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+		mappedData = nullptr;
+	}
+	glDeleteBuffers(1, &ID);
+}
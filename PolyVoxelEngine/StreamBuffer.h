@@ -0,0 +1,35 @@
+#pragma once
+#include <cstddef>
+#include <mutex>
+
+// buffer created with glBufferStorage and mapped once, CPU writes straight into it without driver copies
+// split into regions, allocations go to current region, endFrame fences it and moves to next one
+// region is reused only after GPU passed its fence and all held allocations in it were released
+class StreamBuffer
+{
+	static constexpr size_t REGIONS_COUNT = 3; // frames in flight
+	static size_t alignment;
+
+	unsigned int ID = 0;
+	char* mappedData = nullptr;
+	size_t regionSize = 0;
+	size_t currentRegion = 0;
+	size_t usedSizes[REGIONS_COUNT]{0};
+	size_t heldAllocations[REGIONS_COUNT]{0};
+	bool releasedThisFrame[REGIONS_COUNT]{false};
+	void* fences[REGIONS_COUNT]{nullptr}; // GLsync
+	std::mutex mutex;
+public:
+	StreamBuffer(size_t regionSize);
+
+	// any thread, nullptr when current region is full
+	// held allocation lives until release, others until end of frame
+	char* allocate(size_t size, size_t& offset, bool held = false);
+	void release(size_t offset); // main thread, after last command that reads held allocation
+	void endFrame(); // main thread, after last command that reads this frame's data
+
+	void bindRange(size_t slot, size_t offset, size_t size) const; // as shader storage
+	void bindAsIndirectBuffer() const;
+	unsigned int getID() const;
+	void clean();
+};
@@ -2,18 +2,24 @@
 #include "settings.h"
 #include "Profiler.h"
 #include <iostream>
-#include <filesystem>
-#include <fstream>
 
 int TerrainGenerator::seed = 0;
 FastNoise::SmartNode<FastNoise::Simplex> TerrainGenerator::simplexNoise;
 std::unordered_map<int, ChunkColumnData*> TerrainGenerator::heightMaps;
 AllocatedObjectPool<ChunkColumnData> TerrainGenerator::heightMapPool(0);
+RegionStorage TerrainGenerator::slmhRegions(Settings::skyLightMaxHeightMapSavesPath, false);
 
 Spline TerrainGenerator::continentalSpline = {"res/Splines/continental.bin"};
 
 thread_local float TerrainGenerator::chunkCaveNoiseArray[Settings::CHUNK_SIZE_CUBED];
-float TerrainGenerator::chunkNoiseCalculationsArray2D[Settings::CHUNK_SIZE_SQUARED];
+
+FastNoise::SmartNode<> TerrainGenerator::biomeNoiseNode;
+FastNoise::SmartNode<> TerrainGenerator::continentalNoiseNodes[(size_t)Biome::Count];
+FastNoise::SmartNode<> TerrainGenerator::erosionNoiseNodes[(size_t)Biome::Count];
+FastNoise::SmartNode<> TerrainGenerator::weirdnessNoiseNodes[(size_t)Biome::Count];
+
+static constexpr float BIOME_NOISE_FREQUENCY = 0.01f;
+static const LayeredNoiseData biomeNoiseData = { 3, 1.0f, BIOME_NOISE_FREQUENCY, 0.5f, 2.0f };
 
 
 int pos2_hash(int x, int y)
@@ -133,15 +139,17 @@ void TerrainGenerator::getLayeredNoiseArray2D(float* array, float x, float y, in
 			array[index] = 0;
 		}
 	}
+	thread_local static std::vector<float> noiseArray;
+	noiseArray.resize((size_t)sizeX * sizeY);
 	for (int i = 0; i < layers; i++)
 	{
-		getNoiseArray2D(chunkNoiseCalculationsArray2D, x, y, sizeX, sizeY, frequency);
+		getNoiseArray2D(noiseArray.data(), x, y, sizeX, sizeY, frequency);
 		for (int y = 0; y < sizeY; y++)
 		{
 			for (int x = 0; x < sizeX; x++)
 			{
 				size_t index = x + y * sizeX;
-				float value = chunkNoiseCalculationsArray2D[index];
+				float value = noiseArray[index];
 				value = (value + 1.0f) * 0.5f * amplitude;
 				array[index] += value;
 			}
@@ -169,20 +177,61 @@ void TerrainGenerator::getLayeredNoiseArray2D(float* array, float x, float y, in
 	return getLayeredNoiseArray2D(array, x, y, sizeX, sizeY, data.amplitude, data.frequency, data.layersCount, data.amplitudeFactor, data.frequencyFactor);
 }
 
-int TerrainGenerator::getInitialHeight(int globalX, int globalZ)
+FastNoise::SmartNode<> TerrainGenerator::createLayeredNoiseNode(const LayeredNoiseData& data)
 {
-	int chunkX = floorf((float)globalX / (float)Settings::CHUNK_SIZE);
-	int chunkZ = floorf((float)globalZ / (float)Settings::CHUNK_SIZE);
+	// same sum as getLayeredNoise2D: octaves weighted by amplitude and normalized, then moved from [-1, 1] to [0, amplitude]
+	float amplitudeSum = 0.0f;
+	float amplitude = 1.0f;
+	for (int i = 0; i < data.layersCount; i++)
+	{
+		amplitudeSum += amplitude;
+		amplitude *= data.amplitudeFactor;
+	}
 
-	Biome biome = getBiome(chunkX, chunkZ);
-	const BiomeData& biomeData_ = biomeData[(size_t)biome];
+	FastNoise::SmartNode<> sum;
+	amplitude = 1.0f;
+	float frequency = data.frequency;
+	for (int i = 0; i < data.layersCount; i++)
+	{
+		auto scale = FastNoise::New<FastNoise::DomainScale>();
+		scale->SetSource(simplexNoise);
+		scale->SetScale(frequency);
+		FastNoise::SmartNode<> octave = scale;
+
+		if (data.layersCount > 1)
+		{
+			auto weighted = FastNoise::New<FastNoise::Multiply>();
+			weighted->SetLHS(octave);
+			weighted->SetRHS(amplitude / amplitudeSum);
+			octave = weighted;
+		}
+
+		if (!sum)
+		{
+			sum = octave;
+		}
+		else
+		{
+			auto add = FastNoise::New<FastNoise::Add>();
+			add->SetLHS(sum);
+			add->SetRHS(octave);
+			sum = add;
+		}
+
+		amplitude *= data.amplitudeFactor;
+		frequency *= data.frequencyFactor;
+	}
 
-	float continentalNoise = getLayeredNoise2D(globalX, globalZ, biomeData_.continentalLayer);
-	float erosion = getLayeredNoise2D(globalX, globalZ, biomeData_.erosionLayer);
-	float weirdness = getLayeredNoise2D(globalX, globalZ, biomeData_.weirdnessLayer);
+	auto remap = FastNoise::New<FastNoise::Remap>();
+	remap->SetSource(sum);
+	remap->SetRemap(-1.0f, 1.0f, 0.0f, data.amplitude);
+	return remap;
+}
 
+int TerrainGenerator::combineHeightNoise(float continentalNoise, float erosion, float weirdness, const BiomeData& biomeData_)
+{
 	float continental = continentalSpline.get(continentalNoise) * biomeData_.continentalAmplitude;
-	
+
 	float value = continental;
 	if (erosion > biomeData_.erosionThreshold)
 	{
@@ -194,42 +243,112 @@ int TerrainGenerator::getInitialHeight(int globalX, int globalZ)
 	return value;
 }
 
-void TerrainGenerator::getInitialHeightArray(int* heightArray, int chunkX, int chunkZ, Biome biome)
+int TerrainGenerator::getInitialHeight(int globalX, int globalZ)
 {
-	// TODO: add height interpolating
-	int globalChunkX = chunkX * Settings::CHUNK_SIZE;
-	int globalChunkZ = chunkZ * Settings::CHUNK_SIZE;
+	int chunkX = floorf((float)globalX / (float)Settings::CHUNK_SIZE);
+	int chunkZ = floorf((float)globalZ / (float)Settings::CHUNK_SIZE);
+
+	size_t biome = (size_t)getBiome(chunkX, chunkZ);
 
-	const BiomeData& biomeData_ = biomeData[(size_t)biome];
+	float continentalNoise = continentalNoiseNodes[biome]->GenSingle2D((float)globalX, (float)globalZ, seed);
+	float erosion = erosionNoiseNodes[biome]->GenSingle2D((float)globalX, (float)globalZ, seed);
+	float weirdness = weirdnessNoiseNodes[biome]->GenSingle2D((float)globalX, (float)globalZ, seed);
+	return combineHeightNoise(continentalNoise, erosion, weirdness, biomeData[biome]);
+}
+
+void TerrainGenerator::calculateBiomes(ChunkColumnData** columns, size_t count)
+{
+	thread_local static std::vector<float> positionsX;
+	thread_local static std::vector<float> positionsZ;
+	thread_local static std::vector<float> temperature;
+	thread_local static std::vector<float> humidity;
+	positionsX.resize(count);
+	positionsZ.resize(count);
+	temperature.resize(count);
+	humidity.resize(count);
 
-	float continentalNoiseArray[Settings::CHUNK_SIZE_SQUARED];
-	getLayeredNoiseArray2D(continentalNoiseArray, globalChunkX, globalChunkZ, Settings::CHUNK_SIZE, Settings::CHUNK_SIZE, biomeData_.continentalLayer);
+	for (size_t i = 0; i < count; i++)
+	{
+		positionsX[i] = (float)columns[i]->X;
+		positionsZ[i] = (float)columns[i]->Z;
+	}
 
-	float erosionNoiseArray[Settings::CHUNK_SIZE_SQUARED];
-	getLayeredNoiseArray2D(erosionNoiseArray, globalChunkX, globalChunkZ, Settings::CHUNK_SIZE, Settings::CHUNK_SIZE, biomeData_.erosionLayer);
+	biomeNoiseNode->GenPositionArray2D(temperature.data(), (int)count, positionsX.data(), positionsZ.data(), 0.0f, 0.0f, seed);
+	biomeNoiseNode->GenPositionArray2D(humidity.data(), (int)count, positionsX.data(), positionsZ.data(), 0.5f / BIOME_NOISE_FREQUENCY, 0.1f / BIOME_NOISE_FREQUENCY, seed);
 
-	float weirdnessNoiseArray[Settings::CHUNK_SIZE_SQUARED];
-	getLayeredNoiseArray2D(weirdnessNoiseArray, globalChunkX, globalChunkZ, Settings::CHUNK_SIZE, Settings::CHUNK_SIZE, biomeData_.weirdnessLayer);
+	for (size_t i = 0; i < count; i++)
+	{
+		columns[i]->biome = getBiomeByTH(temperature[i], humidity[i]);
+	}
+}
 
-	for (int y = 0; y < Settings::CHUNK_SIZE; y++)
+void TerrainGenerator::calculateHeightMaps(ChunkColumnData** columns, size_t count)
+{
+	// TODO: add height interpolating
+	thread_local static std::vector<ChunkColumnData*> biomeColumns;
+	thread_local static std::vector<float> positionsX;
+	thread_local static std::vector<float> positionsZ;
+	thread_local static std::vector<float> continentalNoiseArray;
+	thread_local static std::vector<float> erosionNoiseArray;
+	thread_local static std::vector<float> weirdnessNoiseArray;
+
+	for (size_t biome = 0; biome < (size_t)Biome::Count; biome++)
 	{
-		for (int x = 0; x < Settings::CHUNK_SIZE; x++)
+		biomeColumns.clear();
+		for (size_t i = 0; i < count; i++)
+		{
+			if (columns[i]->biome == (Biome)biome)
+			{
+				biomeColumns.push_back(columns[i]);
+			}
+		}
+		if (biomeColumns.empty())
 		{
-			size_t index = x + y * Settings::CHUNK_SIZE;
-			float continental = continentalSpline.get(continentalNoiseArray[index]) * biomeData_.continentalAmplitude;
-			float erosion = erosionNoiseArray[index];
-			float weirdness = weirdnessNoiseArray[index];
+			continue;
+		}
+
+		// positions of every column cell, in the same order as heightMap
+		size_t cellsCount = biomeColumns.size() * Settings::CHUNK_SIZE_SQUARED;
+		positionsX.resize(cellsCount);
+		positionsZ.resize(cellsCount);
+		continentalNoiseArray.resize(cellsCount);
+		erosionNoiseArray.resize(cellsCount);
+		weirdnessNoiseArray.resize(cellsCount);
 
-			float value = continental;
-			if (erosion > biomeData_.erosionThreshold)
+		size_t cell = 0;
+		for (const ChunkColumnData* column : biomeColumns)
+		{
+			int globalChunkX = column->X * Settings::CHUNK_SIZE;
+			int globalChunkZ = column->Z * Settings::CHUNK_SIZE;
+			for (int z = 0; z < Settings::CHUNK_SIZE; z++)
 			{
-				value -= (erosion - biomeData_.erosionThreshold) / (1.0f - biomeData_.erosionThreshold) * biomeData_.erosionAmplitude;
+				for (int x = 0; x < Settings::CHUNK_SIZE; x++)
+				{
+					positionsX[cell] = (float)(globalChunkX + x);
+					positionsZ[cell] = (float)(globalChunkZ + z);
+					cell++;
+				}
 			}
+		}
 
-			float pv = (1 - fabsf(3 * fabsf(weirdness) - 2)) * biomeData_.weirdnessAmplitude;
-			value += pv;
+		int countInt = (int)cellsCount;
+		continentalNoiseNodes[biome]->GenPositionArray2D(continentalNoiseArray.data(), countInt, positionsX.data(), positionsZ.data(), 0.0f, 0.0f, seed);
+		erosionNoiseNodes[biome]->GenPositionArray2D(erosionNoiseArray.data(), countInt, positionsX.data(), positionsZ.data(), 0.0f, 0.0f, seed);
+		weirdnessNoiseNodes[biome]->GenPositionArray2D(weirdnessNoiseArray.data(), countInt, positionsX.data(), positionsZ.data(), 0.0f, 0.0f, seed);
 
-			heightArray[index] = value;
+		const BiomeData& biomeData_ = biomeData[biome];
+		cell = 0;
+		for (ChunkColumnData* column : biomeColumns)
+		{
+			column->minHeight = INT_MAX;
+			column->maxHeight = INT_MIN;
+			for (size_t index = 0; index < Settings::CHUNK_SIZE_SQUARED; index++, cell++)
+			{
+				int height = combineHeightNoise(continentalNoiseArray[cell], erosionNoiseArray[cell], weirdnessNoiseArray[cell], biomeData_);
+				column->heightMap[index] = height;
+				column->minHeight = std::min(column->minHeight, height);
+				column->maxHeight = std::max(column->maxHeight, height);
+			}
 		}
 	}
 }
@@ -240,7 +359,52 @@ void TerrainGenerator::generateChunkCaveNoise(int chunkX, int chunkY, int chunkZ
 	float y = (float)chunkY * Settings::CHUNK_SIZE;
 	float z = (float)chunkZ * Settings::CHUNK_SIZE;
 	float scale = 0.08f;
-	getNoiseArray3D(chunkCaveNoiseArray, x, y, z, Settings::CHUNK_SIZE, Settings::CHUNK_SIZE, Settings::CHUNK_SIZE, scale);
+
+	int step = Settings::DynamicSettings::caveNoiseLatticeStep;
+	if (step <= 1 || Settings::CHUNK_SIZE % step != 0)
+	{
+		getNoiseArray3D(chunkCaveNoiseArray, x, y, z, Settings::CHUNK_SIZE, Settings::CHUNK_SIZE, Settings::CHUNK_SIZE, scale);
+		return;
+	}
+
+	// lattice is aligned to world coordinates and includes first voxels of next chunks, so borders match
+	constexpr int maxSamples = Settings::CHUNK_SIZE / 2 + 1;
+	thread_local static float lattice[maxSamples * maxSamples * maxSamples];
+	int samples = Settings::CHUNK_SIZE / step + 1;
+	int latticeChunkSize = Settings::CHUNK_SIZE / step;
+	simplexNoise->GenUniformGrid3D(lattice, chunkX * latticeChunkSize, chunkY * latticeChunkSize, chunkZ * latticeChunkSize, samples, samples, samples, scale * step, seed);
+
+	// trilinear interpolation
+	float invStep = 1.0f / (float)step;
+	size_t samplesSquared = (size_t)samples * samples;
+	for (int z = 0; z < Settings::CHUNK_SIZE; z++)
+	{
+		int lz = z / step;
+		float tz = (float)(z % step) * invStep;
+		for (int y = 0; y < Settings::CHUNK_SIZE; y++)
+		{
+			int ly = y / step;
+			float ty = (float)(y % step) * invStep;
+
+			const float* c00 = lattice + (size_t)ly * samples + (size_t)lz * samplesSquared;
+			const float* c10 = c00 + samples;
+			const float* c01 = c00 + samplesSquared;
+			const float* c11 = c01 + samples;
+
+			float* out = chunkCaveNoiseArray + y * Settings::CHUNK_SIZE + z * Settings::CHUNK_SIZE_SQUARED;
+			for (int x = 0; x < Settings::CHUNK_SIZE; x++)
+			{
+				int lx = x / step;
+				float tx = (float)(x % step) * invStep;
+
+				float a = linearInterpolation(c00[lx], c00[lx + 1], tx);
+				float b = linearInterpolation(c10[lx], c10[lx + 1], tx);
+				float c = linearInterpolation(c01[lx], c01[lx + 1], tx);
+				float d = linearInterpolation(c11[lx], c11[lx + 1], tx);
+				out[x] = linearInterpolation(linearInterpolation(a, b, ty), linearInterpolation(c, d, ty), tz);
+			}
+		}
+	}
 }
 
 ChunkColumnData* TerrainGenerator::getHeightMap(int chunkX, int chunkZ)
@@ -255,6 +419,11 @@ ChunkColumnData* TerrainGenerator::getHeightMap(int chunkX, int chunkZ)
 	return it->second;
 }
 
+size_t TerrainGenerator::getHeightMapsCount()
+{
+	return heightMaps.size();
+}
+
 Block TerrainGenerator::getBlock(int x, int y, int z, int height, Biome biome)
 {
 	constexpr int snowLevel = 130;
@@ -279,7 +448,7 @@ Block TerrainGenerator::getBlock(int x, int y, int z, int height, Biome biome)
 			return blocks[(size_t)biome];
 		}
 	}
-	else if (y < height - 10)
+	else if (y < height - CAVE_DEPTH)
 	{
 		return IsCaveInChunk(x, y, z) ? Block::Air : Block::Stone;
 	}
@@ -302,11 +471,15 @@ bool TerrainGenerator::IsCaveInChunk(int x, int y, int z)
 	return cheese < 0.5f;
 }
 
+bool TerrainGenerator::isCaveAtIndex(size_t index)
+{
+	return chunkCaveNoiseArray[index] < 0.5f;
+}
+
 Biome TerrainGenerator::getBiome(int chunkX, int chunkZ)
 {
-	float frequency = 0.01f;
-	float temperature = TerrainGenerator::getLayeredNoise2D((float)chunkX, (float)chunkZ, 3, 1.0f, frequency, 0.5f, 2.0f);
-	float humidity = TerrainGenerator::getLayeredNoise2D((float)chunkX + 0.5 / frequency, (float)chunkZ + 0.1 / frequency, 3, 1.0f, frequency, 0.5f, 2.0f);
+	float temperature = biomeNoiseNode->GenSingle2D((float)chunkX, (float)chunkZ, seed);
+	float humidity = biomeNoiseNode->GenSingle2D((float)chunkX + 0.5f / BIOME_NOISE_FREQUENCY, (float)chunkZ + 0.1f / BIOME_NOISE_FREQUENCY, seed);
 	return getBiomeByTH(temperature, humidity);
 }
 
@@ -410,6 +583,14 @@ void TerrainGenerator::init()
 {
 	simplexNoise = FastNoise::New<FastNoise::Simplex>();
 
+	biomeNoiseNode = createLayeredNoiseNode(biomeNoiseData);
+	for (size_t i = 0; i < (size_t)Biome::Count; i++)
+	{
+		continentalNoiseNodes[i] = createLayeredNoiseNode(biomeData[i].continentalLayer);
+		erosionNoiseNodes[i] = createLayeredNoiseNode(biomeData[i].erosionLayer);
+		weirdnessNoiseNodes[i] = createLayeredNoiseNode(biomeData[i].weirdnessLayer);
+	}
+
 	size_t heightMapPoolSize = calcArea(Settings::CHUNK_LOAD_RADIUS);
 	heightMapPool.reserve(heightMapPoolSize);
 }
@@ -423,41 +604,66 @@ void TerrainGenerator::clear()
 		delete data;
 	}
 	heightMapPool.clear();
+	slmhRegions.close();
 }
 
 void TerrainGenerator::loadHeightMap(int chunkX, int chunkZ)
 {
-	auto hash = pos2_hash(chunkX, chunkZ);
-	const auto& it = heightMaps.find(hash);
-	if (it != heightMaps.end())
+	glm::ivec2 column(chunkX, chunkZ);
+	loadHeightMaps(&column, 1);
+}
+
+void TerrainGenerator::loadHeightMaps(const glm::ivec2* columns, size_t count)
+{
+	thread_local static std::vector<ChunkColumnData*> newColumns;
+	newColumns.clear();
+
+	for (size_t i = 0; i < count; i++)
+	{
+		int chunkX = columns[i].x;
+		int chunkZ = columns[i].y;
+
+		auto hash = pos2_hash(chunkX, chunkZ);
+		const auto& it = heightMaps.find(hash);
+		if (it != heightMaps.end())
+		{
+			it->second->unloadRequested = false;
+			continue;
+		}
+
+		ChunkColumnData* chunkColumnData = heightMapPool.acquire();
+		chunkColumnData->unloadRequested = false;
+		chunkColumnData->startUsing();
+		chunkColumnData->X = chunkX;
+		chunkColumnData->Z = chunkZ;
+
+		heightMaps[hash] = chunkColumnData;
+		newColumns.push_back(chunkColumnData);
+	}
+	if (newColumns.empty())
 	{
 		return;
 	}
 
-	ChunkColumnData* chunkColumnData = heightMapPool.acquire();
-	chunkColumnData->startUsing();
-	chunkColumnData->X = chunkX;
-	chunkColumnData->Z = chunkZ;
-	chunkColumnData->biome = getBiome(chunkX, chunkZ);
-
-	// height
-	getInitialHeightArray(chunkColumnData->heightMap, chunkX, chunkZ, chunkColumnData->biome);
+	// biome and height
+	calculateBiomes(newColumns.data(), newColumns.size());
+	calculateHeightMaps(newColumns.data(), newColumns.size());
 
 	// slmh
-	if (!loadSkyLightMaxHeightMapFromFile(chunkX, chunkZ, chunkColumnData))
+	for (ChunkColumnData* chunkColumnData : newColumns)
 	{
-		for (int z = 0; z < Settings::CHUNK_SIZE; z++)
+		if (!loadSkyLightMaxHeightMapFromFile(chunkColumnData->X, chunkColumnData->Z, chunkColumnData))
 		{
-			for (int x = 0; x < Settings::CHUNK_SIZE; x++)
+			for (int z = 0; z < Settings::CHUNK_SIZE; z++)
 			{
-				chunkColumnData->setSlMHAt(x, z, INT_MIN);
+				for (int x = 0; x < Settings::CHUNK_SIZE; x++)
+				{
+					chunkColumnData->setSlMHAt(x, z, INT_MIN);
+				}
 			}
 		}
+		chunkColumnData->stopUsing();
 	}
-	chunkColumnData->stopUsing();
-
-	//
-	heightMaps[hash] = chunkColumnData;
 }
 
 void TerrainGenerator::unloadHeightMap(int chunkX, int chunkZ)
@@ -469,14 +675,15 @@ void TerrainGenerator::unloadHeightMap(int chunkX, int chunkZ)
 		//std::cout << "height map was already unloaded" << std::endl;
 		return;
 	}
-	auto usedBy = it->second->usedBy.load();
-	if (usedBy > 0)
+	ChunkColumnData* chunkColumnData = it->second;
+
+	// chunks are still generating in this column, it is unloaded in releaseHeightMap
+	if (chunkColumnData->usedBy.load() > 0)
 	{
-		std::cerr << "Unloaded ChunkColumnData was used by: " << usedBy << " chunks" << std::endl;
+		chunkColumnData->unloadRequested = true;
+		return;
 	}
 
-	ChunkColumnData* chunkColumnData = it->second;
-
 	chunkColumnData->startUsing();
 	saveSkyLightMaxHeightMapToFile(chunkColumnData);
 	chunkColumnData->stopUsing();
@@ -486,66 +693,57 @@ void TerrainGenerator::unloadHeightMap(int chunkX, int chunkZ)
 
 }
 
+void TerrainGenerator::releaseHeightMap(int chunkX, int chunkZ)
+{
+	const auto& it = heightMaps.find(pos2_hash(chunkX, chunkZ));
+	if (it == heightMaps.end())
+	{
+		std::cerr << "Released height map isn't loaded" << std::endl;
+		return;
+	}
+
+	ChunkColumnData* chunkColumnData = it->second;
+	chunkColumnData->stopUsing();
+	if (chunkColumnData->unloadRequested && chunkColumnData->usedBy.load() == 0)
+	{
+		unloadHeightMap(chunkX, chunkZ);
+	}
+}
+
 bool TerrainGenerator::loadSkyLightMaxHeightMapFromFile(int chunkX, int chunkZ, ChunkColumnData* chunkColumnData)
 {
-	if (!Settings::loadSMLHFiles)
+	if (!Settings::loadSMLHFiles || !Settings::DynamicSettings::chunkPersistence)
 	{
 		return false;
 	}
 
-	std::string filepath = ChunkColumnData::slmhGetFilepath(chunkX, chunkZ);
-	if (!std::filesystem::exists(filepath))
+	thread_local static std::vector<char> data;
+	if (!slmhRegions.read(chunkX, 0, chunkZ, data))
 	{
 		return false;
 	}
-
-	std::ifstream file(filepath, std::ios::binary);
-	if (!file.is_open())
+	if (data.size() != sizeof(chunkColumnData->skyLightMaxHeightMap))
 	{
-		std::cerr << "Failed to open sky light max height map file" << std::endl;
+		std::cerr << "Sky light max height map has wrong size" << std::endl;
 		return false;
 	}
 
-	file.read
-	(
-		reinterpret_cast<char*>(chunkColumnData->skyLightMaxHeightMap),
-		sizeof(chunkColumnData->skyLightMaxHeightMap)
-	);
-	file.close();
+	memcpy(chunkColumnData->skyLightMaxHeightMap, data.data(), data.size());
 	return true;
 }
 
 void TerrainGenerator::saveSkyLightMaxHeightMapToFile(const ChunkColumnData* chunkColumnData)
 {
-	if (!Settings::loadSMLHFiles)
+	if (!Settings::loadSMLHFiles || !Settings::DynamicSettings::chunkPersistence)
 	{
 		return;
 	}
 
-	std::string filepath = ChunkColumnData::slmhGetFilepath(chunkColumnData->X, chunkColumnData->Z);
-	std::ofstream file(filepath, std::ios::binary | std::ios::trunc);
-	if (!file.is_open())
-	{
-		std::cerr << "Failed to open sky light max height map file" << std::endl;
-		return;
-	}
-
-	try
-	{
-		file.write
-		(
-			reinterpret_cast<const char*>(&chunkColumnData->skyLightMaxHeightMap),
-			sizeof(chunkColumnData->skyLightMaxHeightMap)
-		);
-	}
-	catch (const std::exception& e)
-	{
-		std::cerr << "Failed to write to sky light max height map file: " << e.what() << std::endl;
-	}
-	file.close();
+	const char* data = reinterpret_cast<const char*>(chunkColumnData->skyLightMaxHeightMap);
+	slmhRegions.writeAsync(chunkColumnData->X, 0, chunkColumnData->Z, std::vector<char>(data, data + sizeof(chunkColumnData->skyLightMaxHeightMap)));
 }
 
-ChunkColumnData::ChunkColumnData() : X(0), Z(0), usedBy(0)
+ChunkColumnData::ChunkColumnData() : X(0), Z(0), minHeight(0), maxHeight(0), usedBy(0), unloadRequested(false)
 {
 }
 
@@ -564,6 +762,16 @@ int ChunkColumnData::getHeightAtByIndex(size_t index) const
 	return heightMap[index];
 }
 
+int ChunkColumnData::getMinHeight() const
+{
+	return minHeight;
+}
+
+int ChunkColumnData::getMaxHeight() const
+{
+	return maxHeight;
+}
+
 void ChunkColumnData::setSlMHAt(size_t x, size_t z, int height)
 {
 	// TODO: add mutex
@@ -576,19 +784,14 @@ int ChunkColumnData::getSlMHAt(size_t x, size_t z) const
 	return skyLightMaxHeightMap[x + z * Settings::CHUNK_SIZE];
 }
 
-Biome ChunkColumnData::getBiome() const
+int ChunkColumnData::getSlMHAtByIndex(size_t index) const
 {
-	return biome;
+	return skyLightMaxHeightMap[index];
 }
 
-std::string ChunkColumnData::slmhGetFilepath(int chunkX, int chunkZ)
+Biome ChunkColumnData::getBiome() const
 {
-	std::string path = Settings::skyLightMaxHeightMapSavesPath;
-	path += std::to_string(chunkX);
-	path += "_";
-	path += std::to_string(chunkZ);
-	path += ".bin";
-	return path;
+	return biome;
 }
 
 void ChunkColumnData::startUsing()
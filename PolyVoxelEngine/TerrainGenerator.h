@@ -6,7 +6,9 @@
 #include "FastNoise/FastNoise.h"
 #include "Spline.h"
 #include "AllocatedObjectPool.h"
+#include "RegionFile.h"
 #include <atomic>
+#include <glm/vec2.hpp>
 
 class ChunkColumnData
 {
@@ -15,22 +17,25 @@ class ChunkColumnData
 	int X, Z;
 	int heightMap[Settings::CHUNK_SIZE_SQUARED];
 	int skyLightMaxHeightMap[Settings::CHUNK_SIZE_SQUARED];
+	int minHeight, maxHeight;
 	Biome biome;
 	std::atomic<uint32_t> usedBy;
+	bool unloadRequested;
 public:
 	ChunkColumnData();
 
 	void setHeightAt(size_t x, size_t z, int height);
 	int getHeightAt(size_t x, size_t z) const;
 	int getHeightAtByIndex(size_t index) const;
+	int getMinHeight() const;
+	int getMaxHeight() const;
 
 	void setSlMHAt(size_t x, size_t z, int height);
 	int getSlMHAt(size_t x, size_t z) const;
+	int getSlMHAtByIndex(size_t index) const;
 
 	Biome getBiome() const;
 
-	static std::string slmhGetFilepath(int chunkX, int chunkZ);
-
 	void startUsing();
 	void stopUsing();
 };
@@ -44,9 +49,22 @@ class TerrainGenerator
 	static Spline continentalSpline;
 
 	thread_local static float chunkCaveNoiseArray[Settings::CHUNK_SIZE_CUBED];
-	static float chunkNoiseCalculationsArray2D[Settings::CHUNK_SIZE_SQUARED];
+
+	// layered noise graphs, evaluated for all columns of a batch at once
+	static FastNoise::SmartNode<> biomeNoiseNode;
+	static FastNoise::SmartNode<> continentalNoiseNodes[(size_t)Biome::Count];
+	static FastNoise::SmartNode<> erosionNoiseNodes[(size_t)Biome::Count];
+	static FastNoise::SmartNode<> weirdnessNoiseNodes[(size_t)Biome::Count];
+
+	static FastNoise::SmartNode<> createLayeredNoiseNode(const LayeredNoiseData& data);
+	static int combineHeightNoise(float continentalNoise, float erosion, float weirdness, const BiomeData& biomeData_);
+	static void calculateBiomes(ChunkColumnData** columns, size_t count);
+	static void calculateHeightMaps(ChunkColumnData** columns, size_t count);
 public:
+	static constexpr int CAVE_DEPTH = 10; // caves are only this deep under surface
+
 	static int seed;
+	static RegionStorage slmhRegions;
 
 	static void init();
 	static void clear();
@@ -54,7 +72,10 @@ public:
 	static int calculateHeight(int globalX, int globalZ);
 
 	static void loadHeightMap(int chunkX, int chunkZ);
+	// height maps of all new columns are generated together
+	static void loadHeightMaps(const glm::ivec2* columns, size_t count);
 	static void unloadHeightMap(int chunkX, int chunkZ);
+	static void releaseHeightMap(int chunkX, int chunkZ);
 private:
 	static bool loadSkyLightMaxHeightMapFromFile(int chunkX, int chunkZ, ChunkColumnData* chunkColumnData);
 	static void saveSkyLightMaxHeightMapToFile(const ChunkColumnData* chunkColumnData);
@@ -69,12 +90,13 @@ public:
 	static void getLayeredNoiseArray2D(float* array, float x, float y, int sizeX, int sizeY, float amplitude, float frequency, int layers, float amplitudeFactor, float frequencyFactor);
 	static void getLayeredNoiseArray2D(float* array, float x, float y, int sizeX, int sizeY, const LayeredNoiseData& data);
 	static int getInitialHeight(int globalX, int globalZ);
-	static void getInitialHeightArray(int* heightArray, int chunkX, int chunkZ, Biome biome);
 	static void generateChunkCaveNoise(int chunkX, int chunkY, int chunkZ);
 	static ChunkColumnData* getHeightMap(int chunkX, int chunkZ);
+	static size_t getHeightMapsCount();
 
 	static Block getBlock(int x, int y, int z, int height, Biome biome);
 	static bool IsCaveInChunk(int x, int y, int z);
+	static bool isCaveAtIndex(size_t index); // chunk index, see Chunk::getIndex
 
 	static Biome getBiome(int chunkX, int chunkZ);
 };
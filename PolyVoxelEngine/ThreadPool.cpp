@@ -1,112 +1,204 @@
 #include "ThreadPool.h"
+#include "Profiler.h"
 #include <iostream>
 
-void ThreadPool::TaskQueue::getTask(std::function<void()>& task)
+thread_local ThreadPool* ThreadPool::currentPool = nullptr;
+thread_local size_t ThreadPool::currentWorker = 0;
+
+TaskHandle::TaskHandle(std::shared_ptr<std::atomic<bool>> done) : done(std::move(done))
+{
+}
+
+bool TaskHandle::isValid() const
+{
+	return done != nullptr;
+}
+
+bool TaskHandle::isDone() const
+{
+	return !done || done->load();
+}
+
+void TaskHandle::wait() const
 {
-	std::unique_lock<std::mutex> lock(taskMutex);
-	taskAvailableSignal.wait(lock, [this]() { return !tasks.empty() || stopThreads; });
-	if (tasks.empty() || stopThreads)
+	if (done)
 	{
-		task = nullptr;
-		return;
+		done->wait(false);
 	}
-	task = std::move(tasks.front());
-	tasks.pop();
 }
 
-void ThreadPool::TaskQueue::waitForCompletion()
+ThreadPool::ThreadPool(size_t threadCount) : threadCount(threadCount > 0 ? threadCount : 1)
 {
-	std::unique_lock<std::mutex> lock(completionMutex);
-	isWaitingForCompletion = true;
-	completionSignal.wait(lock, [this]() { return activeTasks == 0; });
-	isWaitingForCompletion = false;
+	queues.reserve(this->threadCount);
+	for (size_t i = 0; i < this->threadCount; i++)
+	{
+		queues.push_back(std::make_unique<WorkerQueue>());
+	}
+
+	threads.reserve(this->threadCount);
+	for (size_t i = 0; i < this->threadCount; i++)
+	{
+		threads.emplace_back([this, i]() {
+			run(i);
+		});
+	}
 }
 
-void ThreadPool::TaskQueue::workDone()
+ThreadPool::~ThreadPool()
 {
-	activeTasks--;
-	if (activeTasks > 0)
+	if (!threads.empty())
 	{
-		return;
+		destroy();
 	}
-	std::unique_lock<std::mutex> lock(completionMutex);
-	if (isWaitingForCompletion)
+}
+
+size_t ThreadPool::getDefaultThreadCount()
+{
+	size_t hardwareThreads = std::thread::hardware_concurrency();
+	if (hardwareThreads == 0)
 	{
-		completionSignal.notify_one();
+		return 4;
 	}
+	return hardwareThreads > 1 ? hardwareThreads - 1 : 1;
 }
 
-void ThreadPool::TaskQueue::stop()
+size_t ThreadPool::getThreadCount() const
 {
-	stopThreads = true;
-	taskAvailableSignal.notify_all();
+	return threadCount;
 }
 
-ThreadPool::Worker::Worker(TaskQueue& taskQueue) : taskQueue(taskQueue)
+size_t ThreadPool::getQueuedTasksCount() const
 {
-	thread = std::thread([this]() {
-		run();
-	});
+	return queuedTasks.load();
 }
 
-void ThreadPool::Worker::run()
+size_t ThreadPool::getActiveTasksCount() const
 {
-	std::function<void()> task = nullptr;
-	while (true)
+	return activeTasks.load();
+}
+
+void ThreadPool::push(std::function<void()>&& task, TaskPriority priority)
+{
+	activeTasks++;
+
+	size_t queueIndex = currentPool == this ? currentWorker : nextQueue++ % threadCount;
+	WorkerQueue& queue = *queues[queueIndex];
+	{
+		std::lock_guard<std::mutex> lock(queue.mutex);
+		queue.lanes[(size_t)priority].push_back(std::move(task));
+		queuedTasks++;
+	}
+}
+
+void ThreadPool::notify(bool all)
+{
+	// taking the lock orders notify after sleeping worker checked queuedTasks
 	{
-		taskQueue.getTask(task);
-		if (task == nullptr)
+		std::lock_guard<std::mutex> lock(sleepMutex);
+	}
+	if (all)
+	{
+		taskAvailableSignal.notify_all();
+	}
+	else
+	{
+		taskAvailableSignal.notify_one();
+	}
+}
+
+bool ThreadPool::takeTask(size_t workerIndex, std::function<void()>& task)
+{
+	for (size_t lane = 0; lane < (size_t)TaskPriority::Count; lane++)
+	{
+		// own newest task
 		{
-			if (taskQueue.stopThreads)
+			WorkerQueue& queue = *queues[workerIndex];
+			std::lock_guard<std::mutex> lock(queue.mutex);
+			auto& tasks = queue.lanes[lane];
+			if (!tasks.empty())
 			{
-				break;
-			}
-			else
-			{
-				std::cerr << "Thread busy waiting" << std::endl;
+				task = std::move(tasks.back());
+				tasks.pop_back();
+				queuedTasks--;
+				return true;
 			}
 		}
-		else
+
+		// oldest task of other worker
+		for (size_t i = 1; i < threadCount; i++)
 		{
-			task();
-			taskQueue.workDone();
+			WorkerQueue& queue = *queues[(workerIndex + i) % threadCount];
+			std::lock_guard<std::mutex> lock(queue.mutex);
+			auto& tasks = queue.lanes[lane];
+			if (!tasks.empty())
+			{
+				task = std::move(tasks.front());
+				tasks.pop_front();
+				queuedTasks--;
+				return true;
+			}
 		}
 	}
+	return false;
 }
 
-void ThreadPool::Worker::joinThread()
+void ThreadPool::run(size_t workerIndex)
 {
-	thread.join();
-}
+	currentPool = this;
+	currentWorker = workerIndex;
+	Profiler::setThreadName("Worker " + std::to_string(workerIndex));
 
-ThreadPool::ThreadPool(size_t threadCount) : threadCount(threadCount)
-{
-	workers.reserve(threadCount);
-	for (size_t i = 0; i < threadCount; i++)
+	std::function<void()> task = nullptr;
+	while (true)
 	{
-		workers.emplace_back(taskQueue);
+		if (takeTask(workerIndex, task))
+		{
+			task();
+			task = nullptr;
+			workDone();
+			continue;
+		}
+
+		std::unique_lock<std::mutex> lock(sleepMutex);
+		taskAvailableSignal.wait(lock, [this]() { return queuedTasks > 0 || stopThreads; });
+		if (stopThreads)
+		{
+			break;
+		}
 	}
 }
 
-ThreadPool::~ThreadPool()
+void ThreadPool::workDone()
 {
-	if (!workers.empty())
+	if (--activeTasks > 0)
 	{
-		destroy();
+		return;
 	}
+	std::lock_guard<std::mutex> lock(completionMutex);
+	completionSignal.notify_all();
 }
 
 void ThreadPool::waitForCompletion()
 {
-	taskQueue.waitForCompletion();
+	if (currentPool == this)
+	{
+		std::cerr << "ThreadPool::waitForCompletion called from worker" << std::endl;
+		return;
+	}
+	std::unique_lock<std::mutex> lock(completionMutex);
+	completionSignal.wait(lock, [this]() { return activeTasks == 0; });
 }
 
 void ThreadPool::destroy()
 {
-	taskQueue.stop();
-	for (Worker& worker : workers)
 	{
-		worker.joinThread();
+		std::lock_guard<std::mutex> lock(sleepMutex);
+		stopThreads = true;
+	}
+	taskAvailableSignal.notify_all();
+	for (std::thread& thread : threads)
+	{
+		thread.join();
 	}
-	workers.clear();
+	threads.clear();
 }
@@ -1,115 +1,130 @@
 #pragma once
 #include <vector>
+#include <deque>
 #include <thread>
 #include <mutex>
-#include <queue>
+#include <condition_variable>
+#include <atomic>
+#include <memory>
 #include <functional>
 
 // thanks to Pezzas Work
 
-class ThreadPool
+// lanes are checked in this order, task of higher lane is always taken first
+enum class TaskPriority : uint8_t
 {
-	class TaskQueue
-	{
-		bool isWaitingForCompletion = false;
-		std::condition_variable completionSignal;
-		std::queue<std::function<void()>> tasks;
-		std::mutex taskMutex;
-		std::mutex completionMutex;
-		std::atomic<uint8_t> activeTasks = 0;
-	public:
-		std::condition_variable taskAvailableSignal;
-		bool stopThreads = false;
-
-		template<typename TCallback>
-		void addTask(TCallback&& task);
-
-		template<typename TCallbackContainer>
-		void addTasks(const TCallbackContainer& taskContainer);
-
-		void getTask(std::function<void()>& task);
+	NearGeneration,
+	Meshing,
+	FarGeneration,
+	IO,
+	Count
+};
 
-		void waitForCompletion();
+// completion of single task, can be copied and checked from any thread
+class TaskHandle
+{
+	std::shared_ptr<std::atomic<bool>> done;
+public:
+	TaskHandle() = default;
+	TaskHandle(std::shared_ptr<std::atomic<bool>> done);
 
-		void workDone();
+	bool isValid() const;
+	bool isDone() const;
+	void wait() const;
+};
 
-		void stop();
+// work stealing pool
+// every worker owns deque per priority lane, takes newest task from own deque and steals oldest task from other workers
+// tasks added from outside of pool are spread between workers, tasks added by worker go to its own deque
+class ThreadPool
+{
+	struct WorkerQueue
+	{
+		std::mutex mutex;
+		std::deque<std::function<void()>> lanes[(size_t)TaskPriority::Count];
 	};
 
-	class Worker
-	{
-		std::thread thread;
-		TaskQueue& taskQueue;
-	public:
-		Worker() = default;
+	std::vector<std::thread> threads;
+	std::vector<std::unique_ptr<WorkerQueue>> queues;
+	size_t threadCount;
+	std::atomic<size_t> nextQueue = 0;
 
-		Worker(TaskQueue& taskQueue);
+	std::mutex sleepMutex;
+	std::condition_variable taskAvailableSignal;
+	std::atomic<size_t> queuedTasks = 0;
+	bool stopThreads = false;
 
-		void run();
+	std::mutex completionMutex;
+	std::condition_variable completionSignal;
+	std::atomic<size_t> activeTasks = 0;
 
-		void joinThread();
-	};
+	static thread_local ThreadPool* currentPool;
+	static thread_local size_t currentWorker;
 
-	std::vector<Worker> workers;
-	size_t threadCount;
-	TaskQueue taskQueue;
+	void run(size_t workerIndex);
+	bool takeTask(size_t workerIndex, std::function<void()>& task);
+	void push(std::function<void()>&& task, TaskPriority priority);
+	void notify(bool all);
+	void workDone();
 public:
 	ThreadPool(size_t threadCount);
 	~ThreadPool();
 
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool& operator=(const ThreadPool&) = delete;
+
+	// one worker per hardware thread, except main thread
+	static size_t getDefaultThreadCount();
+	size_t getThreadCount() const;
+	size_t getQueuedTasksCount() const;
+	size_t getActiveTasksCount() const; // queued and running
+
 	template<typename TCallback>
-	void addTask(TCallback&& task);
+	TaskHandle addTask(TCallback&& task, TaskPriority priority);
 
 	template<typename TCallbackContainer>
-	void addTasks(const TCallbackContainer& taskContainer);
+	void addTasks(const TCallbackContainer& taskContainer, TaskPriority priority);
 
 	void waitForCompletion();
 
 	template<typename TCallback>
-	void distribute(size_t count, TCallback&& task);
+	void distribute(size_t count, TCallback&& task, TaskPriority priority = TaskPriority::NearGeneration);
 
 	void destroy();
 };
 
 template<typename TCallback>
-inline void ThreadPool::TaskQueue::addTask(TCallback&& task)
+inline TaskHandle ThreadPool::addTask(TCallback&& task, TaskPriority priority)
 {
-	{
-		std::lock_guard<std::mutex> lock(taskMutex);
-		tasks.push(std::forward<TCallback>(task));
-	}
-	activeTasks++;
-	taskAvailableSignal.notify_one();
+	auto done = std::make_shared<std::atomic<bool>>(false);
+	push([task = std::forward<TCallback>(task), done]() mutable
+		{
+			task();
+			done->store(true);
+			done->notify_all();
+		}, priority
+	);
+	notify(false);
+	return TaskHandle(std::move(done));
 }
 
 template<typename TCallbackContainer>
-inline void ThreadPool::TaskQueue::addTasks(const TCallbackContainer& taskContainer)
+inline void ThreadPool::addTasks(const TCallbackContainer& taskContainer, TaskPriority priority)
 {
+	bool added = false;
+	for (const auto& task : taskContainer)
 	{
-		std::lock_guard<std::mutex> lock(taskMutex);
-		for (const auto& task : taskContainer) 
-		{
-			tasks.push(task);
-			activeTasks++;
-		}
+		push(std::function<void()>(task), priority);
+		added = true;
+	}
+	if (added)
+	{
+		notify(true);
 	}
-	taskAvailableSignal.notify_all();
-}
-
-template<typename TCallback>
-inline void ThreadPool::addTask(TCallback&& task)
-{
-	taskQueue.addTask(std::forward<TCallback>(task));
-}
-
-template<typename TCallbackContainer>
-inline void ThreadPool::addTasks(const TCallbackContainer& taskContainer)
-{
-	taskQueue.addTasks(taskContainer);
 }
 
 template<typename TCallback>
-inline void ThreadPool::distribute(size_t count, TCallback&& task)
+inline void ThreadPool::distribute(size_t count, TCallback&& task, TaskPriority priority)
 {
 	size_t batchSize = count / threadCount;
 	for (size_t i = 0; i < threadCount; i++)
@@ -124,6 +139,6 @@ inline void ThreadPool::distribute(size_t count, TCallback&& task)
 		{
 			end = start + batchSize;
 		}
-		addTask([&task, start, end]() { task(start, end); });
+		addTask([&task, start, end]() { task(start, end); }, priority);
 	}
-}
\ No newline at end of file
+}
@@ -1,34 +1,15 @@
 #include "World.h"
 #include <iostream>
 #include <unordered_set>
-#include "GraphicController.h"
 #include "TerrainGenerator.h"
 #include "Profiler.h"
+#include "Metrics.h"
+#include "SaveThread.h"
+#include "LightingEngine.h"
 #include <filesystem>
 #include <fstream>
 #include <algorithm>
-
-#define _USE_MATH_DEFINES
-#include <math.h>
-
-struct QuadInstanceVertex
-{
-	glm::vec3 position;
-
-	QuadInstanceVertex(const glm::vec3& pos) : position(pos)
-	{}
-
-	QuadInstanceVertex(float x, float y, float z) : position(x, y, z)
-	{}
-};
-
-const QuadInstanceVertex quadInstanceVertices[4] =
-{
-	{0.0f, 0.0f, 1.0f},
-	{1.0f, 0.0f, 1.0f},
-	{1.0f, 0.0f, 0.0f},
-	{0.0f, 0.0f, 0.0f}
-};
+#include <glm/glm.hpp>
 
 template <typename T> int signum(T val) 
 {
@@ -89,12 +70,21 @@ void World::releaseChunk(Chunk* chunk, bool returnDrawIdToPool = true)
 	}
 	else if (chunk->state == Chunk::State::Loaded)
 	{
+		// mesh that is being built for this chunk will be dropped
+		chunk->meshingID++;
 		chunk->destroy();
+		if (meshConsumer)
+		{
+			meshConsumer->freeChunkMesh(chunk);
+			meshConsumer->unloadChunk(chunk);
+		}
+		chunk->drawCommand.resetFaces();
+		chunk->hasAnyFaces = false;
 		if (returnDrawIdToPool)
 		{
 			// TODO: switch to pool class
 			std::lock_guard<std::mutex> lock(chunkIDPoolMutex);
-			chunkIDPool[++chunkIDPoolIndex] = chunk->drawCommand.offset / Settings::FACE_INSTANCES_PER_CHUNK;
+			chunkIDPool[chunkIDPoolSize++] = chunk->drawSlot;
 		}
 		chunk->state = Chunk::State::NotLoaded;
 		{
@@ -104,67 +94,33 @@ void World::releaseChunk(Chunk* chunk, bool returnDrawIdToPool = true)
 	}
 	else if (chunk->state == Chunk::State::Loading)
 	{
-		std::cerr << "Chunk was added to releasedLoadingChunks" << std::endl;
-		std::lock_guard<std::mutex> lock(releasedLoadingChunksMutex);
-		releasedLoadingChunks.push_back(chunk);
+		// worker still owns the chunk, it is returned to pool in processGeneratedChunks
+		chunk->unlinkNeighbours();
+		chunk->generationCancelled = true;
 	}
 }
 
 World::World(const WorldData& worldData)
 	: lastChunkLoaderPosition{0.0f, 0.0f, 0.0f},
 
-	quadInstanceVBO((const char*)quadInstanceVertices, 4 * sizeof(QuadInstanceVertex), GL_STATIC_DRAW),
-	quadInstanceVAO(),
-
-	indirectBuffer(Settings::MAX_CHUNK_DRAW_COMMANDS_COUNT),
-
-	chunkPositionSSBO(Settings::MAX_RENDERED_CHUNKS_COUNT * sizeof(glm::vec3)),
-	chunkPositionIndexSSBO(Settings::MAX_CHUNK_DRAW_COMMANDS_COUNT * sizeof(unsigned int)),
-
 	time(worldData.worldTime),
 
-	blockTextures("res/Textures.png", 0, Settings::BLOCK_TEXTURE_SIZE, Settings::BLOCK_TEXTURES_IN_ROW, Settings::BLOCK_TEXTURES_COUNT, Settings::BLOCK_TEXTURES_NUM_CHANNELS, GL_REPEAT, true),
-	numberTextures("res/Numbers.png", 1, 8, 4, 16, 1, GL_CLAMP_TO_BORDER, false),
-
-	threadPool(4),
-	chunkPool(Settings::MAX_RENDERED_CHUNKS_COUNT)
+	threadPool(ThreadPool::getDefaultThreadCount()),
+	chunkPool(Settings::MAX_RENDERED_CHUNKS_COUNT),
+	generatedChunksQueue(Settings::MAX_RENDERED_CHUNKS_COUNT),
+	chunkMeshPool(32),
+	meshedChunksQueue(Settings::MAX_RENDERED_CHUNKS_COUNT)
 {
 	TerrainGenerator::init();
 	TerrainGenerator::seed = worldData.seed;
+	Chunk::chunkMap.init(Settings::CHUNK_LOAD_RADIUS);
 
 	chunkIDPool = new unsigned int[Settings::MAX_RENDERED_CHUNKS_COUNT];
 	for (size_t i = 0; i < Settings::MAX_RENDERED_CHUNKS_COUNT; i++)
 	{
 		chunkIDPool[i] = i;
 	}
-	chunkIDPoolIndex = Settings::MAX_RENDERED_CHUNKS_COUNT - 1;
-
-	GraphicController::chunkProgram->bind();
-	GraphicController::chunkProgram->setUniformInt("diffuse0", 0);
-	GraphicController::chunkProgram->setUniformInt("numbers", 1);
-
-	//
-	quadInstanceVAO.linkFloat(3, sizeof(QuadInstanceVertex));
-	Chunk::faceInstancesVBO = new FaceInstancesVBO(Settings::MAX_RENDERED_CHUNKS_COUNT * Settings::FACE_INSTANCES_PER_CHUNK, quadInstanceVAO.getLayout());
-	VAO::unbind();
-
-	Chunk::facesData = new Face[Settings::CHUNK_SIZE_CUBED * 6];
-	Chunk::faceInstancesData = new FaceInstanceData[Settings::FACE_INSTANCES_PER_CHUNK];
-
-	chunkPositionSSBO.bindBase(0);
-	chunkPositionIndexSSBO.bindBase(1);
-
-	//
-	drawCommands = new DrawArraysIndirectCommand[Settings::MAX_CHUNK_DRAW_COMMANDS_COUNT];
-	for (size_t i = 0; i < Settings::MAX_CHUNK_DRAW_COMMANDS_COUNT; i++)
-	{
-		DrawArraysIndirectCommand& command = drawCommands[i];
-		command.count = 4;
-		command.first = 0;
-	}
-
-	chunkPositions = new glm::vec3[Settings::MAX_RENDERED_CHUNKS_COUNT];
-	chunkPositionIndexes = new unsigned int[Settings::MAX_CHUNK_DRAW_COMMANDS_COUNT];
+	chunkIDPoolSize = Settings::MAX_RENDERED_CHUNKS_COUNT;
 
 	//
 	if (!std::filesystem::exists(Settings::chunkSavesPath))
@@ -175,97 +131,108 @@ World::World(const WorldData& worldData)
 	{
 		std::filesystem::create_directories(Settings::skyLightMaxHeightMapSavesPath);
 	}
+
+	// worlds saved with one file per chunk
+	Chunk::dataRegions.importLegacyFiles();
+	TerrainGenerator::slmhRegions.importLegacyFiles();
+
+	SaveThread::start({ &Chunk::dataRegions, &TerrainGenerator::slmhRegions });
+	LightingEngine::setThreadPool(&threadPool);
 }
 
 World::~World()
 {
 	// shutdown threads
+	// let generation tasks finish, so no worker touches chunks deleted below
+	threadPool.waitForCompletion();
 	threadPool.destroy();
+	LightingEngine::setThreadPool(nullptr);
+	{
+		Chunk* chunk;
+		while (generatedChunksQueue.pop(chunk))
+		{
+			chunksWaitingForDrawSlot.push_back(chunk);
+		}
+		for (Chunk* chunk : chunksWaitingForDrawSlot)
+		{
+			// cancelled chunks were already removed from chunkMap
+			if (chunk->generationCancelled)
+			{
+				delete chunk;
+			}
+		}
+		chunksWaitingForDrawSlot.clear();
+
+		ChunkMesh* mesh;
+		while (meshedChunksQueue.pop(mesh))
+		{
+			chunkMeshPool.release(mesh);
+		}
+	}
 	
 	//
-	quadInstanceVBO.clean();
-	quadInstanceVAO.clean();
-	indirectBuffer.clean();
-	chunkPositionSSBO.clean();
-	chunkPositionIndexSSBO.clean();
-	blockTextures.clean();
-	numberTextures.clean();
-
-	Chunk::faceInstancesVBO->clean();
-	delete Chunk::faceInstancesVBO;
-	delete[] Chunk::faceInstancesData;
-	delete[] Chunk::facesData;
-	
-	//
-	for (const auto& it : Chunk::chunkMap)
+	for (Chunk* chunk : Chunk::chunkMap)
 	{
-		Chunk* chunk = it.second;
 		chunk->destroy();
 		delete chunk;
 	}
 	Chunk::chunkMap.clear();
 
+	// waits for queued saves
+	SaveThread::stop();
+	Chunk::dataRegions.close();
+
 	delete[] chunkIDPool;
-	delete[] drawCommands;
-	delete[] chunkPositions;
-	delete[] chunkPositionIndexes;
 
 	TerrainGenerator::clear();
 }
 
 void World::update(const glm::vec3& pos, bool isMoving)
 {
+	PROFILER_ZONE(zone, "WorldUpdate");
+	METRICS_ADD("WorldTicks", 1);
+
 	// SaveDataChunks
 	// TODO: maybe it is need a mutex
 	if (!temporalSaveDataChunks.empty())
 	{
 		for (const auto& pos : temporalSaveDataChunks)
 		{
-			auto it = temporalChunkBlockChanges.find(pos3_hash(pos.x, pos.y, pos.z));
+			auto it = temporalChunkBlockChanges.find(ChunkIndex::getKey(pos.x, pos.y, pos.z));
 
 			if (it == temporalChunkBlockChanges.end())
 			{
 				std::cout << "Temporal SaveDataChunks failed" << std::endl;
 				continue;
 			}
-			std::unordered_map<Block, Vector<uint16_t, Settings::CHUNK_SIZE_CUBED>> blockChanges = it->second;
-			Chunk::saveData(blockChanges, pos.x, pos.y, pos.z);
+			const TemporalChunkChanges& changes = it->second;
+			changes.delta.collectRuns(temporalRuns, [&changes](size_t index)
+				{
+					return changes.blocks[index];
+				}
+			);
+			Chunk::saveData(temporalRuns, pos.x, pos.y, pos.z);
 		}
 		temporalSaveDataChunks.clear();
 	}
 	temporalChunkBlockChanges.clear();
 
-	// released loading chunks
-	if (!releasedLoadingChunks.empty())
-	{
-		std::cout << releasedLoadingChunks.size() << std::endl;
-		std::lock_guard<std::mutex> lock(releasedLoadingChunksMutex);
-		for (auto it = releasedLoadingChunks.begin(); it != releasedLoadingChunks.end();)
-		{
-			Chunk* chunk = *it;
-			if (chunk->state == Chunk::State::Loaded)
-			{
-				releaseChunk(chunk, false);
-				it = releasedLoadingChunks.erase(it);
-			}
-			else
-			{
-				++it;
-			}
-		}
-	}
+	// generated chunks
+	processGeneratedChunks();
 
 	// load chunks
 	chunkLoaderPosition = glm::ivec3(pos / (float)Settings::CHUNK_SIZE);
-	Profiler::start(LOAD_CHUNKS_INDEX);
-	loadChunks(false);
-	Profiler::end(LOAD_CHUNKS_INDEX);
+	{
+		PROFILER_ZONE(loadChunksZone, "LoadChunks");
+		loadChunks(false);
+	}
 	
 	// generate blocks
 	generateChunksBlocks(pos, isMoving);
 
 	// update lighting
 	updateLighting();
+	addDirtyChunksToGenerateFaces();
 
 	// generate faces
 	generateChunksFaces();
@@ -276,9 +243,6 @@ void World::update(const glm::vec3& pos, bool isMoving)
 	{
 		time = 0;
 	}
-	float angle = (float)time / 24000.0f * 2.0f * (float)M_PI;
-	GraphicController::chunkProgram->bind();
-	GraphicController::chunkProgram->setUniformFloat("dayNightCycleSkyLightingSubtraction", (cosf(angle) + 1.0f) * 0.5f);
 
 	// shrinking vectors
 	dataShrinkingTick++;
@@ -313,13 +277,21 @@ void World::generateChunksBlocks(const glm::vec3& pos, bool isMoving)
 	{
 		return;
 	}
-	size_t generateCount = std::min(chunksCount, size_t(isMoving ? Settings::DynamicSettings::generateChunksPerTickMoving : Settings::DynamicSettings::generateChunksPerTickStationary));
+	// generation doesn't wait for workers, so amount of chunks in flight is limited instead
+	// limit also keeps generatedChunksQueue from filling up
+	size_t maxChunksInGeneration = size_t(isMoving ? Settings::DynamicSettings::generateChunksPerTickMoving : Settings::DynamicSettings::generateChunksPerTickStationary);
+	maxChunksInGeneration = std::min(maxChunksInGeneration, Settings::MAX_RENDERED_CHUNKS_COUNT);
+	if (chunksInGeneration >= maxChunksInGeneration)
+	{
+		return;
+	}
+	size_t generateCount = std::min(chunksCount, maxChunksInGeneration - chunksInGeneration);
 
 	// generate
 	size_t range = chunksCount - generateCount;
 
-	std::vector<std::function<void()>> tasks;
-	tasks.reserve(generateCount);
+	std::vector<std::function<void()>> nearTasks;
+	std::vector<std::function<void()>> farTasks;
 	{
 		for (size_t i = range; i < chunksCount; i++)
 		{
@@ -330,44 +302,93 @@ void World::generateChunksBlocks(const glm::vec3& pos, bool isMoving)
 				std::cerr << "GenerateChunksBlocks: " << toString(chunk->state) << std::endl;
 				continue;
 			}
-			tasks.push_back([this, chunk]() {
-				generateChunkBlocksThread(chunk);
+
+			// height map is held until chunk is processed, so it can't be unloaded under worker
+			ChunkColumnData* chunkColumnData = TerrainGenerator::getHeightMap(chunk->X, chunk->Z);
+			chunkColumnData->startUsing();
+
+			chunk->state = Chunk::State::Loading;
+			ChunkLifecycle::record(chunk->lifecycle, ChunkLifecycle::Stage::Loading);
+			chunksInGeneration++;
+
+			glm::ivec3 dpos = glm::ivec3(chunk->X, chunk->Y, chunk->Z) - chunkLoaderPosition;
+			bool isNear = dpos.x * dpos.x + dpos.y * dpos.y + dpos.z * dpos.z <= Settings::NEAR_GENERATION_RADIUS * Settings::NEAR_GENERATION_RADIUS;
+			(isNear ? nearTasks : farTasks).push_back([this, chunk, chunkColumnData]() {
+				generateChunkBlocksThread(chunk, chunkColumnData);
 							});
 		}
 	}
-	threadPool.addTasks(tasks);
+	threadPool.addTasks(nearTasks, TaskPriority::NearGeneration);
+	threadPool.addTasks(farTasks, TaskPriority::FarGeneration);
 
-	threadPool.waitForCompletion(); // TODO: remove and fix errors
 	chunkGenerateVector.resize(range);
 }
 
-void World::generateChunkBlocksThread(Chunk* chunk)
+void World::generateChunkBlocksThread(Chunk* chunk, const ChunkColumnData* chunkColumnData)
 {
-	if (getSquaredDistanceToChunkLoader(glm::vec3(chunk->X, chunk->Y, chunk->Z)) > Settings::CHUNK_LOAD_RADIUS * Settings::CHUNK_LOAD_RADIUS)
+	if (!chunk->generationCancelled)
 	{
-		releaseChunk(chunk);
-		return;
+		chunk->generateTerrain(chunkColumnData);
 	}
-	
-	chunk->generateBlocks();
-	// TODO: remove
-	if (chunk->state != Chunk::State::Loaded)
+
+	// queue fits every chunk in generation, chunk is never dropped, it would stay Loading forever
+	while (!generatedChunksQueue.push(chunk))
 	{
-		std::cerr << "GenerateChunkBlocksThread: " << toString(chunk->state) << std::endl;
+		std::this_thread::yield();
 	}
-	
-	if (getSquaredDistanceToChunkLoader(glm::vec3(chunk->X, chunk->Y, chunk->Z)) > Settings::CHUNK_LOAD_RADIUS * Settings::CHUNK_LOAD_RADIUS)
+}
+
+void World::processGeneratedChunks()
+{
+	// chunks generated while every draw slot was taken are retried first
+	if (!chunksWaitingForDrawSlot.empty())
 	{
-		releaseChunk(chunk);
+		std::vector<Chunk*> waitingChunks;
+		waitingChunks.swap(chunksWaitingForDrawSlot);
+		for (Chunk* chunk : waitingChunks)
+		{
+			finishGeneratedChunk(chunk);
+		}
+	}
+
+	Chunk* chunk;
+	while (generatedChunksQueue.pop(chunk))
+	{
+		chunksInGeneration--;
+		finishGeneratedChunk(chunk);
+	}
+}
+
+void World::finishGeneratedChunk(Chunk* chunk)
+{
+	if (chunk->generationCancelled)
+	{
+		TerrainGenerator::releaseHeightMap(chunk->X, chunk->Z);
+		// chunk was never loaded, so loaded changes are already saved and there is nothing to destroy
+		chunk->clearStorage();
+		chunk->state = Chunk::State::NotLoaded;
+		std::lock_guard<std::mutex> lock(chunkPoolMutex);
+		chunkPool.release(chunk);
 		return;
 	}
 
+	unsigned int drawSlot;
 	{
 		std::lock_guard<std::mutex> lock(chunkIDPoolMutex);
-		chunk->setDrawID(chunkIDPool[chunkIDPoolIndex]);
-		chunkIDPool[chunkIDPoolIndex] = 0;
-		chunkIDPoolIndex--;
+		if (chunkIDPoolSize == 0)
+		{
+			// chunk stays Loading until some chunk is unloaded
+			chunksWaitingForDrawSlot.push_back(chunk);
+			return;
+		}
+		drawSlot = chunkIDPool[--chunkIDPoolSize];
 	}
+	TerrainGenerator::releaseHeightMap(chunk->X, chunk->Z);
+
+	chunk->finishLoading();
+	chunk->setDrawID(drawSlot);
+	ChunkLifecycle::record(chunk->lifecycle, ChunkLifecycle::Stage::Loaded);
+	METRICS_ADD("ChunksGenerated", 1);
 
 	addChunkToGenerateFaces(chunk);
 	addSurroundingChunksToGenerateFaces(chunk);
@@ -402,18 +423,98 @@ void World::sortGenerateChunksQueue()
 
 void World::generateChunksFaces()
 {
+	applyChunksMeshes();
+
 	std::lock_guard<std::mutex> lock(generateFacesSetMutex);
 	if (generateFacesSet.empty())
 	{
 		return;
 	}
-	Chunk::faceInstancesVBO->bind();
 
-	for (Chunk* chunk : generateFacesSet)
+	std::vector<std::function<void()>> tasks;
+	tasks.reserve(generateFacesSet.size());
+	for (auto it = generateFacesSet.begin(); it != generateFacesSet.end();)
+	{
+		// meshes queue can't overflow, rest of chunks is meshed next tick
+		if (chunksInMeshing >= Settings::MAX_RENDERED_CHUNKS_COUNT)
+		{
+			break;
+		}
+
+		Chunk* chunk = *it;
+		it = generateFacesSet.erase(it);
+		if (chunk->state != Chunk::State::Loaded)
+		{
+			continue;
+		}
+
+		// sky and deep rock chunks, meshes still in flight are outdated by new meshingID
+		if (chunk->canSkipMeshing() && chunk->drawCommand.getFacesCount() == 0)
+		{
+			chunk->sideConnections = chunk->blocksCount == 0 ? ChunkVisibility::ALL_SIDES_CONNECTED : 0;
+			chunk->meshingID++;
+			continue;
+		}
+
+		ChunkMesh* mesh;
+		{
+			std::lock_guard<std::mutex> lock(chunkMeshPoolMutex);
+			mesh = chunkMeshPool.acquire();
+		}
+		mesh->chunk = chunk;
+		mesh->meshingID = ++chunk->meshingID;
+		chunksInMeshing++;
+		ChunkLifecycle::record(chunk->lifecycle, ChunkLifecycle::Stage::Meshing);
+		tasks.push_back([this, mesh, consumer = meshConsumer]() {
+			generateChunkFacesThread(mesh, consumer);
+						});
+	}
+	threadPool.addTasks(tasks, TaskPriority::Meshing);
+}
+
+void World::generateChunkFacesThread(ChunkMesh* mesh, ChunkMeshConsumer* consumer)
+{
+	mesh->chunk->generateMesh(*mesh, consumer);
+
+	// queue fits every mesh in flight, mesh is never dropped, chunksInMeshing would never go down
+	while (!meshedChunksQueue.push(mesh))
 	{
-		chunk->generateFaces();
+		std::this_thread::yield();
+	}
+}
+
+void World::applyChunksMeshes()
+{
+	ChunkMesh* mesh;
+	while (meshedChunksQueue.pop(mesh))
+	{
+		chunksInMeshing--;
+
+		// chunk could be edited, unloaded or reused while mesh was being built
+		Chunk* chunk = mesh->chunk;
+		if (chunk->state == Chunk::State::Loaded && chunk->meshingID == mesh->meshingID)
+		{
+			if (meshConsumer)
+			{
+				meshConsumer->freeChunkMesh(chunk);
+			}
+			chunk->applyMesh(*mesh);
+			if (meshConsumer)
+			{
+				meshConsumer->applyChunkMesh(chunk, *mesh);
+			}
+			ChunkLifecycle::record(chunk->lifecycle, ChunkLifecycle::Stage::Meshed);
+			METRICS_ADD("MeshesApplied", 1);
+		}
+		// faces of mesh built while consumer was set, consumer is removed only after meshing tasks are done
+		if (mesh->isStaged && meshConsumer)
+		{
+			meshConsumer->releaseMeshFaces(mesh->stagingOffset);
+		}
+
+		std::lock_guard<std::mutex> lock(chunkMeshPoolMutex);
+		chunkMeshPool.release(mesh);
 	}
-	generateFacesSet.clear();
 }
 
 RaycastHit World::raycast(const glm::vec3& startPos, const glm::vec3& dir, float length)
@@ -514,7 +615,7 @@ RaycastHit World::raycast(const glm::vec3& startPos, const glm::vec3& dir, float
 	return hit;
 }
 
-void World::setBlockAt(int x, int y, int z, Block block)
+bool World::setBlockAt(int x, int y, int z, Block block)
 {
 	// get chunk
 	int chX = floorf((float)x / (float)Settings::CHUNK_SIZE);
@@ -523,6 +624,12 @@ void World::setBlockAt(int x, int y, int z, Block block)
 
 	Chunk* chunk = Chunk::getChunkAt(chX, chY, chZ);
 
+	// chunk in generation is written by worker, edit is rejected like raycast treats it as Void
+	if (chunk && chunk->state != Chunk::State::Loaded)
+	{
+		return false;
+	}
+
 	if (chunk)
 	{
 		// check for entity collision
@@ -549,7 +656,7 @@ void World::setBlockAt(int x, int y, int z, Block block)
 				}
 				if (collides)
 				{
-					return;
+					return false;
 				}
 			}
 		}
@@ -559,25 +666,8 @@ void World::setBlockAt(int x, int y, int z, Block block)
 		y &= Settings::CHUNK_SIZE - 1;
 		z &= Settings::CHUNK_SIZE - 1;
 
-		const BlockData& blockData = ALL_BLOCK_DATA[(size_t)block];
-
-		if (chunk->setBlockAtInBoundaries(x, y, z, block))
-		{
-			for (int dx = -1; dx <= 1; dx++)
-			{
-				for (int dy = -1; dy <= 1; dy++)
-				{
-					for (int dz = -1; dz <= 1; dz++)
-					{
-						Chunk* chunk = Chunk::getChunkAt(chX + dx, chY + dy, chZ + dz);
-						if (chunk)
-						{
-							addChunkToGenerateFaces(chunk);
-						}
-					}
-				}
-			}
-		}
+		// chunk marks changed cell, meshes around it are rebuilt in addDirtyChunksToGenerateFaces
+		return chunk->setBlockAtInBoundaries(x, y, z, block);
 	}
 	else
 	{
@@ -586,72 +676,35 @@ void World::setBlockAt(int x, int y, int z, Block block)
 		y &= Settings::CHUNK_SIZE - 1;
 		z &= Settings::CHUNK_SIZE - 1;
 
-		std::unordered_map<Block, Vector<uint16_t, Settings::CHUNK_SIZE_CUBED>> blockChanges;
-
-		auto it = temporalChunkBlockChanges.find(pos3_hash(chX, chY, chZ));
+		uint64_t key = ChunkIndex::getKey(chX, chY, chZ);
+		auto it = temporalChunkBlockChanges.find(key);
 		if (it == temporalChunkBlockChanges.end())
 		{
-			Chunk::loadData(blockChanges, chX, chY, chZ);
-			temporalChunkBlockChanges[pos3_hash(chX, chY, chZ)] = blockChanges;
-		}
-		else
-		{
-			blockChanges = it->second;
-		}
-
+			it = temporalChunkBlockChanges.try_emplace(key).first;
+			TemporalChunkChanges& changes = it->second;
 
-		uint16_t placeBlockIndex = Chunk::getIndex(x, y, z);
-
-		bool push = true;
-		for (auto& pair : blockChanges)
-		{
-			Block block_ = pair.first;
-			auto& vector = pair.second;
-
-			bool stop = false;
-			size_t size = vector.getSize();
-			for (size_t i = 0; i < size; i++)
+			Chunk::loadData(temporalRuns, chX, chY, chZ);
+			for (const auto& run : temporalRuns)
 			{
-				uint16_t index = vector[i];
-				if (index == placeBlockIndex)
+				size_t end = (size_t)run.start + run.length;
+				for (size_t index = run.start; index < end; index++)
 				{
-					if (block != block_)
-					{
-						vector.pop(i);
-					}
-					else
-					{
-						push = false;
-					}
-					stop = true;
-					break;
-				}
-
-				/*const auto& it = blockChanges.find(prevBlock);
-				if (it != blockChanges.end())
-				{
-					auto& prevVec = it->second;
-
-					prevVec.remove(saveIndex);
-					if (prevVec.getSize() == 0)
-					{
-						blockChanges.erase(it);
-					}
+					changes.blocks[index] = run.block;
+					changes.delta.markEdited(index);
 				}
-
-				blockChanges[block].push(saveIndex);*/
-			}
-			if (stop)
-			{
-				break;
 			}
 		}
-		if (push)
+		TemporalChunkChanges& changes = it->second;
+
+		size_t placeBlockIndex = Chunk::getIndex(x, y, z);
+		if (changes.delta.isEdited(placeBlockIndex) && changes.blocks[placeBlockIndex] == block)
 		{
-			blockChanges[block].push(placeBlockIndex);
-			temporalChunkBlockChanges[pos3_hash(chX, chY, chZ)] = blockChanges;
-			temporalSaveDataChunks.emplace(chX, chY, chZ);
+			return false;
 		}
+		changes.blocks[placeBlockIndex] = block;
+		changes.delta.markEdited(placeBlockIndex);
+		temporalSaveDataChunks.emplace(chX, chY, chZ);
+		return true;
 	}
 }
 
@@ -698,12 +751,12 @@ bool World::loadChunks(bool forced)
 		std::lock_guard<std::mutex> lock(chunkMapMutex);
 
 		// unload chunks
-		for (auto it = Chunk::chunkMap.begin(); it != Chunk::chunkMap.end();)
+		// backwards, erasing moves last chunk into current position
+		for (size_t i = Chunk::chunkMap.size(); i-- > 0;)
 		{
-			Chunk* chunk = it->second;
-			if (chunk->state != Chunk::State::Loaded && chunk->state != Chunk::State::InLoadingQueue)
+			Chunk* chunk = Chunk::chunkMap[i];
+			if (chunk->state == Chunk::State::NotLoaded)
 			{
-				it++;
 				continue;
 			}
 
@@ -715,19 +768,27 @@ bool World::loadChunks(bool forced)
 			if (D1 > rsq)
 			{
 				TerrainGenerator::unloadHeightMap(chunk->X, chunk->Z);
-				it = Chunk::chunkMap.erase(it);
+				Chunk::chunkMap.erase(chunk);
 				releaseChunk(chunk);
 			}
 			else if (D1 + dy * dy > rsq)
 			{
-				it = Chunk::chunkMap.erase(it);
+				Chunk::chunkMap.erase(chunk);
 				releaseChunk(chunk);
 			}
-			else
+		}
+
+		// load height maps, new columns are generated in one batch
+		std::vector<glm::ivec2> columns;
+		for (int dx = -radius; dx <= radius; dx++)
+		{
+			int maxZ = (int)sqrtf(rsq - dx * dx);
+			for (int dz = -maxZ; dz <= maxZ; dz++)
 			{
-				it++;
+				columns.emplace_back(chunkLoaderPosition.x + dx, chunkLoaderPosition.z + dz);
 			}
 		}
+		TerrainGenerator::loadHeightMaps(columns.data(), columns.size());
 
 		// load chunks
 		for (int dx = -radius; dx <= radius; dx++)
@@ -736,8 +797,6 @@ bool World::loadChunks(bool forced)
 			int maxZ = (int)sqrtf(D1);
 			for (int dz = -maxZ; dz <= maxZ; dz++)
 			{
-				TerrainGenerator::loadHeightMap(chunkLoaderPosition.x + dx, chunkLoaderPosition.z + dz);
-
 				int D2 = D1 - dz * dz;
 				int maxY = (int)sqrtf(D2);
 				for (int dy = -maxY; dy <= maxY; dy++)
@@ -756,6 +815,7 @@ bool World::loadChunks(bool forced)
 					}
 					{
 						chunk->state = Chunk::State::InLoadingQueue;
+						ChunkLifecycle::queued(chunk->lifecycle);
 						std::lock_guard<std::mutex> lock(generateChunkVectorMutex);
 						chunkGenerateVector.push_back(chunk);
 					}
@@ -769,92 +829,62 @@ bool World::loadChunks(bool forced)
 	return true;
 }
 
-void World::draw(const Camera& camera)
+void World::updateMetrics()
 {
-	drawCommandsCount = 0;
-
-	// get render chunks
-	std::vector<ChunkDistance> renderChunks;
-	getRenderChunks(renderChunks, camera);
-
-	// sort render chunks
-	std::sort(renderChunks.begin(), renderChunks.end(), [&](const ChunkDistance& a, const ChunkDistance& b)
 	{
-		return a.distance < b.distance;
-	});
-	
-	// draw solid faces
-	blockTextures.bind();
-	numberTextures.bind();
-
-	size_t commandsCount, chunkPositionsCount;
-	getDrawCommands(renderChunks, camera, commandsCount, chunkPositionsCount, false);
-	drawCommandsCount += commandsCount;
-	glEnable(GL_DEPTH_TEST);
-	glDisable(GL_BLEND);
-	if (commandsCount > 0)
+		std::lock_guard<std::mutex> lock(generateChunkVectorMutex);
+		METRICS_SET("ChunkGenerateQueue", chunkGenerateVector.size());
+	}
 	{
-		chunkPositionSSBO.setData((const char*)chunkPositions, chunkPositionsCount * sizeof(glm::vec3));
-		chunkPositionIndexSSBO.setData((const char*)chunkPositionIndexes, commandsCount * sizeof(unsigned int));
-		indirectBuffer.setData(drawCommands, commandsCount);
-
-		quadInstanceVAO.bind();
+		std::lock_guard<std::mutex> lock(generateFacesSetMutex);
+		METRICS_SET("GenerateFacesSet", generateFacesSet.size());
+	}
+	METRICS_SET("ChunksInGeneration", chunksInGeneration);
+	METRICS_SET("ChunksInMeshing", chunksInMeshing);
+	METRICS_SET("ThreadPoolQueuedTasks", threadPool.getQueuedTasksCount());
+	{
+		std::lock_guard<std::mutex> lock(Chunk::lightingUpdateMutex);
+		METRICS_SET("LightingUpdates", Chunk::lightingUpdateVector.size());
+	}
+	// flood fills are drained every tick, nodes passed through them are counted by LightingEngine
+	{
+		std::lock_guard<std::mutex> lock(Chunk::lightingFloodFillMutex);
+		METRICS_SET("LightingFloodFill", Chunk::lightingFloodFillVector.size());
+	}
+	{
+		std::lock_guard<std::mutex> lock(Chunk::darknessFloodFillMutex);
+		METRICS_SET("DarknessFloodFill", Chunk::darknessFloodFillVector.size());
+	}
 
-		glEnable(GL_CULL_FACE);
-		glDepthFunc(GL_LESS);
+	{
+		std::lock_guard<std::mutex> lock(chunkPoolMutex);
+		METRICS_SET("ChunkPoolFree", chunkPool.getSize());
+	}
+	{
+		std::lock_guard<std::mutex> lock(chunkIDPoolMutex);
+		METRICS_SET("DrawSlotsFree", chunkIDPoolSize);
+	}
+	METRICS_SET("HeightMaps", TerrainGenerator::getHeightMapsCount());
 
-		if (GraphicController::zPrePass)
-		{
-			GraphicController::deferredChunkProgram->bind();
-			glEnable(GL_RASTERIZER_DISCARD);
-			glMultiDrawArraysIndirect(GL_TRIANGLE_FAN, nullptr, commandsCount, 0);
-
-			GraphicController::chunkProgram->bind();
-			glDisable(GL_RASTERIZER_DISCARD);
-			glDepthFunc(GL_LEQUAL);
-			glMultiDrawArraysIndirect(GL_TRIANGLE_FAN, nullptr, commandsCount, 0);
-		}
-		else
-		{
-			GraphicController::chunkProgram->bind();
-			glMultiDrawArraysIndirect(GL_TRIANGLE_FAN, nullptr, commandsCount, 0);
-		}
+	size_t stateCounts[4] = { 0, 0, 0, 0 };
+	for (Chunk* chunk : Chunk::chunkMap)
+	{
+		stateCounts[(size_t)chunk->state]++;
 	}
-	
-	// draw transparent
-	std::reverse(renderChunks.begin(), renderChunks.end());
-	getDrawCommands(renderChunks, camera, commandsCount, chunkPositionsCount, true);
-	drawCommandsCount += commandsCount;
-	glDisable(GL_CULL_FACE);
-	if (commandsCount > 0)
-	{
-		chunkPositionSSBO.setData((const char*)chunkPositions, chunkPositionsCount * sizeof(glm::vec3));
-		chunkPositionIndexSSBO.setData((const char*)chunkPositionIndexes, commandsCount * sizeof(unsigned int));
-		indirectBuffer.setData(drawCommands, commandsCount);
-	
-		quadInstanceVAO.bind();
+	METRICS_SET("ChunksNotLoaded", stateCounts[(size_t)Chunk::State::NotLoaded]);
+	METRICS_SET("ChunksInLoadingQueue", stateCounts[(size_t)Chunk::State::InLoadingQueue]);
+	METRICS_SET("ChunksLoading", stateCounts[(size_t)Chunk::State::Loading]);
+	METRICS_SET("ChunksLoaded", stateCounts[(size_t)Chunk::State::Loaded]);
+}
 
-		if (GraphicController::zPrePass)
-		{
-			GraphicController::deferredChunkProgram->bind();
-		}
-		else
-		{
-			GraphicController::chunkProgram->bind();
-		}
-		glEnable(GL_RASTERIZER_DISCARD);
-		glDepthFunc(GL_LESS);
-		glMultiDrawArraysIndirect(GL_TRIANGLE_FAN, nullptr, commandsCount, 0);
+void World::setMeshConsumer(ChunkMeshConsumer* consumer)
+{
+	meshConsumer = consumer;
+}
 
-		if (GraphicController::zPrePass)
-		{
-			GraphicController::chunkProgram->bind();
-		}
-		glDisable(GL_RASTERIZER_DISCARD);
-		glDepthFunc(GL_LEQUAL);
-		glEnable(GL_BLEND);
-		glMultiDrawArraysIndirect(GL_TRIANGLE_FAN, nullptr, commandsCount, 0);
-	}
+void World::waitForTasks()
+{
+	threadPool.waitForCompletion();
 }
 
 void World::regenerateChunks()
@@ -862,9 +892,8 @@ void World::regenerateChunks()
 	std::lock_guard<std::mutex> lock(generateChunkVectorMutex);
 	chunkGenerateVector.clear();
 	chunkGenerateVector.reserve(Chunk::chunkMap.size());
-	for (const auto& pair : Chunk::chunkMap)
+	for (Chunk* chunk : Chunk::chunkMap)
 	{
-		Chunk* chunk = pair.second;
 		if (chunk->state != Chunk::State::Loaded)
 		{
 			continue;
@@ -873,83 +902,51 @@ void World::regenerateChunks()
 	}
 }
 
-void World::getRenderChunks(std::vector<ChunkDistance>& renderChunks, const Camera& camera) const
+void World::addChunkToGenerateFaces(Chunk* chunk)
 {
-	Box chunkShape(glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(Settings::HALF_CHUNK_SIZE));
-	renderChunks.reserve(Settings::MAX_RENDERED_CHUNKS_COUNT >> 2);
-	for (const auto& pair : Chunk::chunkMap)
+	if (chunk->state == Chunk::State::Loaded)
 	{
-		Chunk* chunk = pair.second;
-		if (!chunk->hasAnyFaces)
-		{
-			continue;
-		}
-
-		chunkShape.center.x = (chunk->X + 0.5f) * Settings::CHUNK_SIZE;
-		chunkShape.center.y = (chunk->Y + 0.5f) * Settings::CHUNK_SIZE;
-		chunkShape.center.z = (chunk->Z + 0.5f) * Settings::CHUNK_SIZE;
-		if (!camera.isOnFrustum(chunkShape))
-		{
-			continue;
-		}
-		auto dpos = chunkShape.center - camera.position;
-		float distance = glm::dot(dpos, dpos);
-		renderChunks.emplace_back(chunk, distance);
+		std::lock_guard<std::mutex> lock(generateFacesSetMutex);
+		generateFacesSet.emplace(chunk);
 	}
 }
 
-void World::getDrawCommands(const std::vector<ChunkDistance>& renderChunks, const Camera& camera, size_t& commandsCount, size_t& positionsCount, bool transparent)
+void World::addDirtyChunksToGenerateFaces()
 {
-	commandsCount = 0;
-	positionsCount = 0;
+	{
+		std::lock_guard<std::mutex> lock(Chunk::dirtyChunksMutex);
+		dirtyChunks.swap(Chunk::dirtyChunks);
+	}
 
-	size_t normalOffset = transparent ? 6 : 0;
-	for (const ChunkDistance& pair : renderChunks)
+	// faces, ao and smooth lighting see one cell into neighbour chunks,
+	// so only neighbours next to changed cells are rebuilt
+	for (Chunk* chunk : dirtyChunks)
 	{
-		const Chunk* chunk = pair.chunk;
-		float X = chunk->X * Settings::CHUNK_SIZE;
-		float Y = chunk->Y * Settings::CHUNK_SIZE;
-		float Z = chunk->Z * Settings::CHUNK_SIZE;
+		int minOffset[3];
+		int maxOffset[3];
+		for (size_t axis = 0; axis < 3; axis++)
+		{
+			minOffset[axis] = chunk->dirtyMin[axis] == 0 ? -1 : 0;
+			maxOffset[axis] = chunk->dirtyMax[axis] == Settings::CHUNK_SIZE - 1 ? 1 : 0;
+		}
+		chunk->hasDirtyCells = false;
 
-		const DrawCommand& command = chunk->drawCommand;
-		bool anyFace = false;
-		for (size_t normalID = 0; normalID < 6; normalID++)
+		for (int dx = minOffset[0]; dx <= maxOffset[0]; dx++)
 		{
-			GLuint facesCount = command.facesCount[normalID + normalOffset];
-			if (facesCount > 0 && chunk->canSideBeSeen(camera.position, normalID))
+			for (int dy = minOffset[1]; dy <= maxOffset[1]; dy++)
 			{
-				size_t index = commandsCount++;
-				chunkPositionIndexes[index] = positionsCount;
-				anyFace = true;
-
-				DrawArraysIndirectCommand& indirectCommand = drawCommands[index];
-				indirectCommand.instancesCount = facesCount;
-
-				if (transparent)
-				{
-					indirectCommand.baseInstance = command.offset + (normalID + 1) * (Settings::FACE_INSTANCES_PER_CHUNK / 6) - facesCount;
-				}
-				else
+				for (int dz = minOffset[2]; dz <= maxOffset[2]; dz++)
 				{
-					indirectCommand.baseInstance = command.offset + normalID * (Settings::FACE_INSTANCES_PER_CHUNK / 6);
+					Chunk* remeshChunk = (dx | dy | dz) == 0 ? chunk : Chunk::getChunkAt(chunk->X + dx, chunk->Y + dy, chunk->Z + dz);
+					if (remeshChunk)
+					{
+						addChunkToGenerateFaces(remeshChunk);
+					}
 				}
 			}
 		}
-		if (anyFace)
-		{
-			chunkPositions[positionsCount] = { X, Y, Z };
-			positionsCount++;
-		}
-	}
-}
-
-void World::addChunkToGenerateFaces(Chunk* chunk)
-{
-	if (chunk->state == Chunk::State::Loaded)
-	{
-		std::lock_guard<std::mutex> lock(generateFacesSetMutex);
-		generateFacesSet.emplace(chunk);
 	}
+	dirtyChunks.clear();
 }
 
 void World::addSurroundingChunksToGenerateFaces(const Chunk* chunk)
@@ -1021,184 +1018,36 @@ void World::setLightingAt(int x, int y, int z, uint8_t power, bool lightOrSky)
 	z &= Settings::CHUNK_SIZE - 1;
 
 	chunk->setLightingAtInBoundaries(x, y, z, power, lightOrSky);
-	addChunkToGenerateFaces(chunk);
 }
 
-void World::lightingFloodFill()
+void World::applyLightingUpdates()
 {
-	// TODO: maybe use queue?
-	// TODO: if not loaded, wait for loading
-	std::lock_guard<std::mutex> lock(Chunk::lightingFloodFillMutex);
-	auto& needToCheck = Chunk::lightingFloodFillVector;
-	while (!needToCheck.empty())
-	{
-		auto light = needToCheck.back();
-		needToCheck.pop_back();
-
-		int globalX = light.pos.x;
-		int globalY = light.pos.y;
-		int globalZ = light.pos.z;
-
-		int chX = floorf((float)globalX / Settings::CHUNK_SIZE);
-		int chY = floorf((float)globalY / Settings::CHUNK_SIZE);
-		int chZ = floorf((float)globalZ / Settings::CHUNK_SIZE);
-		Chunk* chunk = Chunk::getChunkAt(chX, chY, chZ);
-		if (!chunk || chunk->state != Chunk::State::Loaded)
-		{
-			continue;
-		}
-
-		bool blockOrSky = light.blockOrSky;
-
-		int chunkGlobalX = chX * Settings::CHUNK_SIZE;
-		int chunkGlobalY = chY * Settings::CHUNK_SIZE;
-		int chunkGlobalZ = chZ * Settings::CHUNK_SIZE;
-
-		int x = globalX & (Settings::CHUNK_SIZE - 1);
-		int y = globalY & (Settings::CHUNK_SIZE - 1);
-		int z = globalZ & (Settings::CHUNK_SIZE - 1);
-
-		uint8_t currentLightLevel = (chunk->getLightingAtInBoundaries(x, y, z) >> (4 * blockOrSky)) & 15;
-		if (currentLightLevel <= 1)
-		{
-			continue;
-		}
-		for (size_t side = 0; side < 6; side++)
-		{
-			size_t axis = side >> 1;
-			int offCoords[3] = { (int)x, (int)y, (int)z };
-			offCoords[axis] += (side & 1) ? -1 : 1;
-
-			Chunk::BlockAndLighting blockAndLighting = chunk->getBlockAndLightingAtSideCheck(offCoords[0], offCoords[1], offCoords[2], side);
-			if (blockAndLighting.block == Block::Void)
-			{
-				continue;
-			}
-
-			const BlockData& blockData = ALL_BLOCK_DATA[(size_t)blockAndLighting.block];
-			uint8_t lightLevel = (blockAndLighting.lighting >> (4 * blockOrSky)) & 15;
-			if (blockData.transparent && lightLevel + 1 < currentLightLevel)
-			{
-				chunk->setLightingAtSideCheck(offCoords[0], offCoords[1], offCoords[2], side, currentLightLevel - 1, blockOrSky);
-				needToCheck.emplace_back
-				(
-					chunkGlobalX + offCoords[0],
-					chunkGlobalY + offCoords[1],
-					chunkGlobalZ + offCoords[2],
-					blockOrSky
-				);
-			}
-		}
+	// TODO: if place 2 light source close to eachother, after removing them, 1 block light will stay in last removed one
+	std::lock_guard<std::mutex> lock(Chunk::lightingUpdateMutex);
+	PROFILER_ZONE(blockLightZone, "BlockLightUpdate");
+	for (const auto& update : Chunk::lightingUpdateVector)
+	{
+		updateBlockLighting(update);
 	}
-}
+	blockLightZone.end();
 
-void World::darknessFloodFill()
-{
-	std::lock_guard<std::mutex> lock(Chunk::darknessFloodFillMutex);
-	auto& needToCheck = Chunk::darknessFloodFillVector;
-	while (!needToCheck.empty())
-	{
-		auto darkness = needToCheck.back();
-		needToCheck.pop_back();
-
-		int globalX = darkness.pos.x;
-		int globalY = darkness.pos.y;
-		int globalZ = darkness.pos.z;
-		bool blockOrSky = darkness.blockOrSky;
-
-		int chX = floorf((float)globalX / Settings::CHUNK_SIZE);
-		int chY = floorf((float)globalY / Settings::CHUNK_SIZE);
-		int chZ = floorf((float)globalZ / Settings::CHUNK_SIZE);
-		Chunk* chunk = Chunk::getChunkAt(chX, chY, chZ);
-		if (!chunk || chunk->state != Chunk::State::Loaded)
-		{
-			continue;
-		}
-
-		int chunkGlobalX = chX * Settings::CHUNK_SIZE;
-		int chunkGlobalY = chY * Settings::CHUNK_SIZE;
-		int chunkGlobalZ = chZ * Settings::CHUNK_SIZE;
-
-		int x = globalX & (Settings::CHUNK_SIZE - 1);
-		int y = globalY & (Settings::CHUNK_SIZE - 1);
-		int z = globalZ & (Settings::CHUNK_SIZE - 1);
-		
-		for (size_t side = 0; side < 6; side++)
-		{
-			size_t axis = side >> 1;
-			int offCoords[3] = { (int)x, (int)y, (int)z };
-			offCoords[axis] += (side & 1) ? -1 : 1;
-
-			Chunk::BlockAndLighting blockAndLighting = chunk->getBlockAndLightingAtSideCheck(offCoords[0], offCoords[1], offCoords[2], side);
-			if (blockAndLighting.block == Block::Void)
-			{
-				continue;
-			}
-
-			const BlockData& blockData = ALL_BLOCK_DATA[(size_t)blockAndLighting.block];
-			if (!blockData.transparent)
-			{
-				continue;
-			}
-
-			uint8_t lightLevel = (blockAndLighting.lighting >> (4 * blockOrSky)) & 15;
-			if (lightLevel == 0)
-			{
-				continue;
-			}
-
-			if (lightLevel < darkness.lightValue)
-			{
-				chunk->setLightingAtSideCheck(offCoords[0], offCoords[1], offCoords[2], side, 0, blockOrSky);
-				needToCheck.emplace_back
-				(
-					chunkGlobalX + offCoords[0],
-					chunkGlobalY + offCoords[1],
-					chunkGlobalZ + offCoords[2],
-					blockOrSky,
-					lightLevel
-				);
-			}
-			else
-			{
-				std::lock_guard<std::mutex> lock(Chunk::lightingFloodFillMutex);
-				Chunk::lightingFloodFillVector.emplace_back
-				(
-					chunkGlobalX + offCoords[0],
-					chunkGlobalY + offCoords[1],
-					chunkGlobalZ + offCoords[2],
-					blockOrSky
-				);
-			}
-		}
+	PROFILER_ZONE(skyLightZone, "SkyLightUpdate");
+	for (const auto& update : Chunk::lightingUpdateVector)
+	{
+		updateSkyLighting(update);
 	}
+	skyLightZone.end();
+
+	Chunk::lightingUpdateVector.clear();
 }
 
 void World::updateLighting()
 {
-	// TODO: if place 2 light source close to eachother, after removing them, 1 block light will stay in last removed one
-	{
-		std::lock_guard<std::mutex> lock(Chunk::lightingUpdateMutex);
-		Profiler::start(BLOCK_LIGHT_UPDATE_INDEX);
-		for (const auto& update : Chunk::lightingUpdateVector)
-		{
-			updateBlockLighting(update);
-		}
-		Profiler::end(BLOCK_LIGHT_UPDATE_INDEX);
-
-		Profiler::start(SKY_LIGHT_UPDATE_INDEX);
-		for (const auto& update : Chunk::lightingUpdateVector)
-		{
-			updateSkyLighting(update);
-		}
-		Profiler::end(SKY_LIGHT_UPDATE_INDEX);
-
-		Chunk::lightingUpdateVector.clear();
-	}
+	applyLightingUpdates();
 
 	// TODO: add flood fill profiling
-	darknessFloodFill();
-	lightingFloodFill();
+	LightingEngine::propagateDarkness();
+	LightingEngine::propagateLighting();
 }
 
 void World::updateBlockLighting(const LightUpdate& lightUpdate)
@@ -1,17 +1,13 @@
 #pragma once
 #include <vector>
 #include <unordered_set>
+#include <glm/vec2.hpp>
 #include "Chunk.h"
-#include "Camera.h"
-#include "TextureArray.h"
-
-#include "SSBO.h"
-#include "IBO.h"
-#include "VBO.h"
-#include "VAO.h"
+#include "ChunkMeshConsumer.h"
 
 #include "ThreadPool.h"
 #include "AllocatedObjectPool.h"
+#include "LockFreeQueue.h"
 
 struct RaycastHit
 {
@@ -21,6 +17,13 @@ struct RaycastHit
 	Block block = Block::Air;
 };
 
+// changes of not loaded chunk, kept until they are saved
+struct TemporalChunkChanges
+{
+	ChunkDelta delta;
+	Block blocks[Settings::CHUNK_SIZE_CUBED];
+};
+
 struct WorldData
 {
 	glm::vec3 playerPosition = {0, INT_MIN, 0};
@@ -30,6 +33,8 @@ struct WorldData
 	uint16_t worldTime = 12000;
 };
 
+// simulation side of world: chunk streaming, generation, lighting, meshing to CPU buffers and persistence
+// doesn't touch GL, meshes are given to ChunkMeshConsumer when one is set (see WorldRenderer)
 class World
 {
 	struct ChunkDistance
@@ -52,75 +57,77 @@ class World
 	};
 
 	AllocatedObjectPool<Chunk> chunkPool;
-	unsigned int* chunkIDPool;
-	size_t chunkIDPoolIndex;
+	unsigned int* chunkIDPool; // free draw slots are first chunkIDPoolSize items
+	size_t chunkIDPoolSize;
 	glm::ivec3 chunkLoaderPosition;
 	glm::ivec3 lastChunkLoaderPosition;
-	std::vector<Chunk*> releasedLoadingChunks;
+
+	// chunks finished (or cancelled) by generation workers, drained by main thread
+	LockFreeQueue<Chunk*> generatedChunksQueue;
+	size_t chunksInGeneration = 0;
+	std::vector<Chunk*> chunksWaitingForDrawSlot; // generated, but all draw slots were taken, main thread
+
+	// meshes built by workers, applied by main thread
+	AllocatedObjectPool<ChunkMesh> chunkMeshPool;
+	LockFreeQueue<ChunkMesh*> meshedChunksQueue;
+	size_t chunksInMeshing = 0;
 
 	std::vector<Chunk*> chunkGenerateVector;
 	std::unordered_set<Chunk*> generateFacesSet;
+	std::vector<Chunk*> dirtyChunks;
 
-	std::unordered_map<int, std::unordered_map<Block, Vector<uint16_t, Settings::CHUNK_SIZE_CUBED>>> temporalChunkBlockChanges;
-	std::unordered_set<Int3, Int3> temporalSaveDataChunks;
+	ChunkMeshConsumer* meshConsumer = nullptr;
 
-	VAO quadInstanceVAO;
-	VBO quadInstanceVBO;
-	IndirectBuffer indirectBuffer;
-	SSBO chunkPositionSSBO;
-	SSBO chunkPositionIndexSSBO;
-
-	DrawArraysIndirectCommand* drawCommands = nullptr;
-	glm::vec3* chunkPositions = nullptr;
-	unsigned int* chunkPositionIndexes = nullptr;
+	std::unordered_map<uint64_t, TemporalChunkChanges> temporalChunkBlockChanges;
+	std::vector<ChunkDelta::Run> temporalRuns;
+	std::unordered_set<Int3, Int3> temporalSaveDataChunks;
 
 	uint8_t dataShrinkingTick = 0;
 
 	ThreadPool threadPool;
 	std::mutex chunkPoolMutex;
+	std::mutex chunkMeshPoolMutex;
 	std::mutex chunkIDPoolMutex;
 	std::mutex generateFacesSetMutex;
 	std::mutex chunkMapMutex;
 	std::mutex generateChunkVectorMutex;
-	std::mutex releasedLoadingChunksMutex;
 
 
 	Chunk* getChunk(int x, int y, int z);
 	void releaseChunk(Chunk* chunk, bool returnDrawIdToPool);
 
-	void getRenderChunks(std::vector<ChunkDistance>& renderChunks, const Camera& camera) const;
-	void getDrawCommands(const std::vector<ChunkDistance>& renderChunks, const Camera& camera, size_t& commandsCount, size_t& positionsCount, bool transparent);
-
 	void addChunkToGenerateFaces(Chunk* chunk);
 	void addSurroundingChunksToGenerateFaces(const Chunk* chunk);
+	void addDirtyChunksToGenerateFaces();
 
 	uint8_t getLightingAt(int x, int y, int z) const;
 	void setLightingAt(int x, int y, int z, uint8_t power, bool lightOrSky);
-	void lightingFloodFill();
-	void darknessFloodFill();
-	void updateLighting();
-	void updateBlockLighting(const LightUpdate& lightUpdate);
-	void updateSkyLighting(const LightUpdate& lightUpdate);
+	static void updateBlockLighting(const LightUpdate& lightUpdate);
+	static void updateSkyLighting(const LightUpdate& lightUpdate);
 public:
 	uint16_t time = 0;
 
-	TextureArray blockTextures;
-	TextureArray numberTextures;
-
-	uint32_t drawCommandsCount = 0;
-
 	World(const WorldData& worldData);
 	~World();
 
 	void update(const glm::vec3& pos, bool isMoving);
 	void generateChunksBlocks(const glm::vec3& pos, bool isMoving);
-	void generateChunkBlocksThread(Chunk* chunk);
+	void generateChunkBlocksThread(Chunk* chunk, const ChunkColumnData* chunkColumnData);
+	void processGeneratedChunks();
+	void finishGeneratedChunk(Chunk* chunk);
 	void sortGenerateChunksQueue();
 	void generateChunksFaces();
+	void generateChunkFacesThread(ChunkMesh* mesh, ChunkMeshConsumer* consumer);
+	void applyChunksMeshes();
+	void updateMetrics(); // sets gauges of queues, pools and chunk states, main thread
 	RaycastHit raycast(const glm::vec3& startPos, const glm::vec3& dir, float length);
-	void setBlockAt(int x, int y, int z, Block block);
+	bool setBlockAt(int x, int y, int z, Block block); // false when edit is rejected or changes nothing
 	Block getBlockAt(int x, int y, int z) const;
 
+	// lighting doesn't depend on world instance, so it can be driven without GL context
+	static void applyLightingUpdates();
+	static void updateLighting();
+
 	float getDistanceToChunkLoader(const glm::vec3& chunkPos) const;
 	float getSquaredDistanceToChunkLoader(const glm::vec3& chunkPos) const;
 
@@ -130,7 +137,9 @@ public:
 	static void saveWorldData(const WorldData& worldData);
 	static void worldDataGetPlayerY(WorldData& worldData);
 
-	void draw(const Camera& camera);
+	// main thread, set before first update, chunks already meshed aren't given to new consumer
+	void setMeshConsumer(ChunkMeshConsumer* consumer);
+	void waitForTasks(); // main thread, until generation, meshing and lighting tasks are done
 
 	//
 	void regenerateChunks();
@@ -0,0 +1,565 @@
+#include "WorldRenderer.h"
+#include <iostream>
+#include <algorithm>
+#include "GraphicController.h"
+#include "Profiler.h"
+#include "Metrics.h"
+
+#define _USE_MATH_DEFINES
+#include <math.h>
+
+struct QuadInstanceVertex
+{
+	glm::vec3 position;
+
+	QuadInstanceVertex(const glm::vec3& pos) : position(pos)
+	{}
+
+	QuadInstanceVertex(float x, float y, float z) : position(x, y, z)
+	{}
+};
+
+const QuadInstanceVertex quadInstanceVertices[4] =
+{
+	{0.0f, 0.0f, 1.0f},
+	{1.0f, 0.0f, 1.0f},
+	{1.0f, 0.0f, 0.0f},
+	{0.0f, 0.0f, 0.0f}
+};
+
+WorldRenderer::ChunkDistance::ChunkDistance(Chunk* chunk, float distance) : chunk(chunk), distance(distance) {}
+
+static size_t getFrameStreamRegionSize()
+{
+	// solid and transparent pass, visible slots, and alignment padding of every allocation
+	size_t passSize =
+		Settings::MAX_RENDERED_CHUNKS_COUNT * sizeof(glm::vec3) +
+		Settings::MAX_CHUNK_DRAW_COMMANDS_COUNT * (sizeof(unsigned int) + sizeof(DrawArraysIndirectCommand));
+	size_t visibleSlotsSize = (Settings::MAX_RENDERED_CHUNKS_COUNT + 31) / 32 * sizeof(unsigned int);
+	return passSize * 2 + visibleSlotsSize + 7 * 256;
+}
+
+WorldRenderer::WorldRenderer(World& world)
+	: world(world),
+
+	quadInstanceVAO(),
+	quadInstanceVBO((const char*)quadInstanceVertices, 4 * sizeof(QuadInstanceVertex), GL_STATIC_DRAW),
+
+	indirectBuffer(Settings::MAX_CHUNK_DRAW_COMMANDS_COUNT),
+
+	chunkPositionSSBO(Settings::MAX_RENDERED_CHUNKS_COUNT * sizeof(glm::vec3)),
+	chunkPositionIndexSSBO(Settings::MAX_CHUNK_DRAW_COMMANDS_COUNT * sizeof(unsigned int)),
+	frameStreamBuffer(getFrameStreamRegionSize()),
+	meshStagingBuffer(Settings::MESH_STAGING_REGION_SIZE),
+	faceInstancesAllocator(Settings::MAX_RENDERED_CHUNKS_COUNT * Settings::INITIAL_FACE_INSTANCES_PER_CHUNK),
+	chunkCullingMetaSSBO(Settings::MAX_RENDERED_CHUNKS_COUNT * sizeof(ChunkCullingMeta)),
+	cullingCountersSSBOs{ SSBO(2 * sizeof(unsigned int)), SSBO(2 * sizeof(unsigned int)) },
+
+	blockTextures("res/Textures.png", 0, Settings::BLOCK_TEXTURE_SIZE, Settings::BLOCK_TEXTURES_IN_ROW, Settings::BLOCK_TEXTURES_COUNT, Settings::BLOCK_TEXTURES_NUM_CHANNELS, GL_REPEAT, true),
+	numberTextures("res/Numbers.png", 1, 8, 4, 16, 1, GL_CLAMP_TO_BORDER, false)
+{
+	GraphicController::chunkProgram->bind();
+	GraphicController::chunkProgram->setUniformInt("diffuse0", 0);
+	GraphicController::chunkProgram->setUniformInt("numbers", 1);
+
+	//
+	quadInstanceVAO.linkFloat(3, sizeof(QuadInstanceVertex));
+	faceInstancesVBO = new FaceInstancesVBO(faceInstancesAllocator.getCapacity(), quadInstanceVAO.getLayout());
+	VAO::unbind();
+
+	chunkPositionSSBO.bindBase(0);
+	chunkPositionIndexSSBO.bindBase(1);
+
+	//
+	chunkCullingMetas = new ChunkCullingMeta[Settings::MAX_RENDERED_CHUNKS_COUNT];
+	chunkCullingMetaSSBO.setData((const char*)chunkCullingMetas, Settings::MAX_RENDERED_CHUNKS_COUNT * sizeof(ChunkCullingMeta));
+
+	visibleSlotsWordsCount = (Settings::MAX_RENDERED_CHUNKS_COUNT + 31) / 32;
+	visibleSlots = new unsigned int[visibleSlotsWordsCount];
+
+	world.setMeshConsumer(this);
+}
+
+WorldRenderer::~WorldRenderer()
+{
+	// workers may still write faces into meshStagingBuffer
+	world.setMeshConsumer(nullptr);
+	world.waitForTasks();
+
+	//
+	quadInstanceVBO.clean();
+	quadInstanceVAO.clean();
+	indirectBuffer.clean();
+	chunkPositionSSBO.clean();
+	chunkPositionIndexSSBO.clean();
+	chunkCullingMetaSSBO.clean();
+	for (const SSBO& countersSSBO : cullingCountersSSBOs)
+	{
+		countersSSBO.clean();
+	}
+	frameStreamBuffer.clean();
+	meshStagingBuffer.clean();
+	blockTextures.clean();
+	numberTextures.clean();
+
+	faceInstancesVBO->clean();
+	delete faceInstancesVBO;
+
+	delete[] chunkCullingMetas;
+	delete[] visibleSlots;
+}
+
+void WorldRenderer::draw(const Camera& camera)
+{
+	PROFILER_ZONE(zone, "WorldDraw");
+
+	drawCommandsCount = 0;
+
+	// day night cycle
+	float angle = (float)world.time / 24000.0f * 2.0f * (float)M_PI;
+	GraphicController::chunkProgram->bind();
+	GraphicController::chunkProgram->setUniformFloat("dayNightCycleSkyLightingSubtraction", (cosf(angle) + 1.0f) * 0.5f);
+
+	blockTextures.bind();
+	numberTextures.bind();
+
+	findVisibleChunks(camera);
+
+	// draw solid faces
+	size_t indirectOffset = 0;
+	size_t commandsCount = cullSolidChunks(camera, indirectOffset);
+	bool countOnGPU = Settings::DynamicSettings::gpuChunkCulling;
+	auto multiDraw = [countOnGPU, indirectOffset](size_t commandsCount)
+		{
+			if (countOnGPU)
+			{
+				glMultiDrawArraysIndirectCount(GL_TRIANGLE_FAN, nullptr, 0, (GLsizei)commandsCount, 0);
+			}
+			else
+			{
+				glMultiDrawArraysIndirect(GL_TRIANGLE_FAN, (const void*)indirectOffset, commandsCount, 0);
+			}
+		};
+
+	glEnable(GL_DEPTH_TEST);
+	glDisable(GL_BLEND);
+	if (commandsCount > 0)
+	{
+		quadInstanceVAO.bind();
+
+		glEnable(GL_CULL_FACE);
+		glDepthFunc(GL_LESS);
+
+		if (GraphicController::zPrePass)
+		{
+			GraphicController::deferredChunkProgram->bind();
+			glEnable(GL_RASTERIZER_DISCARD);
+			multiDraw(commandsCount);
+
+			GraphicController::chunkProgram->bind();
+			glDisable(GL_RASTERIZER_DISCARD);
+			glDepthFunc(GL_LEQUAL);
+			multiDraw(commandsCount);
+		}
+		else
+		{
+			GraphicController::chunkProgram->bind();
+			multiDraw(commandsCount);
+		}
+	}
+
+	// transparent faces are blended, so they are culled on CPU and drawn from far to near
+	std::vector<ChunkDistance> renderChunks;
+	getRenderChunks(renderChunks, camera);
+	std::sort(renderChunks.begin(), renderChunks.end(), [&](const ChunkDistance& a, const ChunkDistance& b)
+	{
+		return a.distance > b.distance;
+	});
+
+	FrameDrawData drawData;
+	size_t chunkPositionsCount = 0;
+	commandsCount = 0;
+	if (allocateFrameDrawData(drawData))
+	{
+		getDrawCommands(renderChunks, camera, drawData, commandsCount, chunkPositionsCount, true);
+	}
+	drawCommandsCount += commandsCount;
+	glDisable(GL_CULL_FACE);
+	if (commandsCount > 0)
+	{
+		bindFrameDrawData(drawData, commandsCount, chunkPositionsCount);
+	
+		quadInstanceVAO.bind();
+
+		if (GraphicController::zPrePass)
+		{
+			GraphicController::deferredChunkProgram->bind();
+		}
+		else
+		{
+			GraphicController::chunkProgram->bind();
+		}
+		glEnable(GL_RASTERIZER_DISCARD);
+		glDepthFunc(GL_LESS);
+		glMultiDrawArraysIndirect(GL_TRIANGLE_FAN, (const void*)drawData.commandsOffset, commandsCount, 0);
+
+		if (GraphicController::zPrePass)
+		{
+			GraphicController::chunkProgram->bind();
+		}
+		glDisable(GL_RASTERIZER_DISCARD);
+		glDepthFunc(GL_LEQUAL);
+		glEnable(GL_BLEND);
+		glMultiDrawArraysIndirect(GL_TRIANGLE_FAN, (const void*)drawData.commandsOffset, commandsCount, 0);
+	}
+
+	// every command reading uploads of this frame is issued
+	frameStreamBuffer.endFrame();
+	meshStagingBuffer.endFrame();
+}
+
+bool WorldRenderer::allocateFrameDrawData(FrameDrawData& drawData)
+{
+	drawData.positions = (glm::vec3*)frameStreamBuffer.allocate(Settings::MAX_RENDERED_CHUNKS_COUNT * sizeof(glm::vec3), drawData.positionsOffset);
+	drawData.positionIndexes = (unsigned int*)frameStreamBuffer.allocate(Settings::MAX_CHUNK_DRAW_COMMANDS_COUNT * sizeof(unsigned int), drawData.positionIndexesOffset);
+	drawData.commands = (DrawArraysIndirectCommand*)frameStreamBuffer.allocate(Settings::MAX_CHUNK_DRAW_COMMANDS_COUNT * sizeof(DrawArraysIndirectCommand), drawData.commandsOffset);
+	if (!drawData.positions || !drawData.positionIndexes || !drawData.commands)
+	{
+		std::cerr << "Frame stream buffer is full" << std::endl;
+		return false;
+	}
+	return true;
+}
+
+void WorldRenderer::bindFrameDrawData(const FrameDrawData& drawData, size_t commandsCount, size_t positionsCount) const
+{
+	frameStreamBuffer.bindRange(0, drawData.positionsOffset, positionsCount * sizeof(glm::vec3));
+	frameStreamBuffer.bindRange(1, drawData.positionIndexesOffset, commandsCount * sizeof(unsigned int));
+	frameStreamBuffer.bindAsIndirectBuffer();
+}
+
+bool WorldRenderer::allocateFaceInstances(Chunk* chunk, size_t count)
+{
+	size_t offset = faceInstancesAllocator.allocate(count);
+	if (offset == RangeAllocator::INVALID_OFFSET)
+	{
+		// too fragmented or full, meshes are packed together and buffer grows until quarter of it stays free
+		size_t requiredSize = faceInstancesAllocator.getUsedSize() + count;
+		size_t capacity = faceInstancesAllocator.getCapacity();
+		while (capacity < requiredSize + requiredSize / 4)
+		{
+			capacity += capacity / 2;
+		}
+		compactFaceInstances(capacity, chunk);
+		offset = faceInstancesAllocator.allocate(count);
+	}
+	if (offset == RangeAllocator::INVALID_OFFSET)
+	{
+		std::cerr << "Failed to allocate chunk faces" << std::endl;
+		return false;
+	}
+	chunk->drawCommand.offset = (unsigned int)offset;
+	return true;
+}
+
+void WorldRenderer::compactFaceInstances(size_t capacity, const Chunk* pendingChunk)
+{
+	// commands already issued keep reading old buffer, GL deletes it when they are done
+	FaceInstancesVBO* oldVBO = faceInstancesVBO;
+	quadInstanceVAO.bind();
+	faceInstancesVBO = new FaceInstancesVBO(capacity, quadInstanceVAO.getLayout());
+	VAO::unbind();
+
+	size_t offset = 0;
+	for (Chunk* chunk : Chunk::chunkMap)
+	{
+		size_t count = chunk->drawCommand.getFacesCount();
+		if (count == 0 || chunk == pendingChunk)
+		{
+			continue;
+		}
+		faceInstancesVBO->copyData(*oldVBO, chunk->drawCommand.offset, offset, count);
+		chunk->drawCommand.offset = (unsigned int)offset;
+		setCullingMeta(chunk->drawSlot, chunk);
+		offset += count;
+	}
+	faceInstancesAllocator.reset(capacity, offset);
+
+	oldVBO->clean();
+	delete oldVBO;
+}
+
+const RangeAllocator& WorldRenderer::getFaceInstancesAllocator() const
+{
+	return faceInstancesAllocator;
+}
+
+void WorldRenderer::updateMetrics()
+{
+	METRICS_SET("FaceInstancesUsed", faceInstancesAllocator.getUsedSize());
+	METRICS_SET("FaceInstancesCapacity", faceInstancesAllocator.getCapacity());
+
+	// pop-in latency
+	METRICS_SET("ChunkDrawnLatencyP50Us", ChunkLifecycle::getPercentile(ChunkLifecycle::Stage::Drawn, 0.5f));
+	METRICS_SET("ChunkDrawnLatencyP90Us", ChunkLifecycle::getPercentile(ChunkLifecycle::Stage::Drawn, 0.9f));
+	METRICS_SET("ChunkDrawnLatencyP99Us", ChunkLifecycle::getPercentile(ChunkLifecycle::Stage::Drawn, 0.99f));
+}
+
+FaceInstanceData* WorldRenderer::allocateMeshFaces(size_t count, size_t& offset)
+{
+	return (FaceInstanceData*)meshStagingBuffer.allocate(count * sizeof(FaceInstanceData), offset, true);
+}
+
+void WorldRenderer::releaseMeshFaces(size_t offset)
+{
+	meshStagingBuffer.release(offset);
+}
+
+void WorldRenderer::freeChunkMesh(Chunk* chunk)
+{
+	faceInstancesAllocator.free(chunk->drawCommand.offset, chunk->drawCommand.getFacesCount());
+}
+
+void WorldRenderer::applyChunkMesh(Chunk* chunk, const ChunkMesh& mesh)
+{
+	size_t count = chunk->drawCommand.getFacesCount();
+	if (count > 0)
+	{
+		if (allocateFaceInstances(chunk, count))
+		{
+			// mesh is packed in facesCount order like the allocated range, so it goes in one copy
+			if (mesh.isStaged)
+			{
+				faceInstancesVBO->copyData(meshStagingBuffer, mesh.stagingOffset, chunk->drawCommand.offset, count);
+			}
+			else
+			{
+				faceInstancesVBO->setData(mesh.faceInstances.data(), chunk->drawCommand.offset, count);
+			}
+			METRICS_ADD("MeshesUploaded", 1);
+			METRICS_ADD("FacesUploaded", count);
+		}
+		else
+		{
+			// chunk is drawn without faces until its next mesh
+			chunk->drawCommand.resetFaces();
+			chunk->hasAnyFaces = false;
+		}
+	}
+	setCullingMeta(chunk->drawSlot, chunk);
+}
+
+void WorldRenderer::unloadChunk(Chunk* chunk)
+{
+	setCullingMeta(chunk->drawSlot, nullptr);
+}
+
+void WorldRenderer::setCullingMeta(unsigned int slot, const Chunk* chunk)
+{
+	ChunkCullingMeta& meta = chunkCullingMetas[slot];
+	meta = ChunkCullingMeta();
+	if (chunk)
+	{
+		meta.x = chunk->X;
+		meta.y = chunk->Y;
+		meta.z = chunk->Z;
+		meta.offset = chunk->drawCommand.offset;
+		if (chunk->hasAnyFaces)
+		{
+			memcpy(meta.facesCount, chunk->drawCommand.facesCount, sizeof(meta.facesCount));
+		}
+	}
+
+	if (dirtyCullingMetasBegin == dirtyCullingMetasEnd)
+	{
+		dirtyCullingMetasBegin = slot;
+		dirtyCullingMetasEnd = slot + 1;
+		return;
+	}
+	dirtyCullingMetasBegin = std::min(dirtyCullingMetasBegin, (size_t)slot);
+	dirtyCullingMetasEnd = std::max(dirtyCullingMetasEnd, (size_t)slot + 1);
+}
+
+void WorldRenderer::uploadCullingMetas()
+{
+	if (dirtyCullingMetasBegin == dirtyCullingMetasEnd)
+	{
+		return;
+	}
+	chunkCullingMetaSSBO.setData(
+		(const char*)(chunkCullingMetas + dirtyCullingMetasBegin),
+		dirtyCullingMetasBegin * sizeof(ChunkCullingMeta),
+		(dirtyCullingMetasEnd - dirtyCullingMetasBegin) * sizeof(ChunkCullingMeta)
+	);
+	dirtyCullingMetasBegin = 0;
+	dirtyCullingMetasEnd = 0;
+}
+
+size_t WorldRenderer::cullSolidChunks(const Camera& camera, size_t& indirectOffset)
+{
+	glm::vec4 frustumPlanes[6];
+	camera.getFrustumPlanes(frustumPlanes);
+
+	if (!Settings::DynamicSettings::gpuChunkCulling)
+	{
+		// reference path, same logic as chunkCulling.comp, writes straight into mapped memory
+		FrameDrawData drawData;
+		if (!allocateFrameDrawData(drawData))
+		{
+			return 0;
+		}
+		size_t positionsCount;
+		size_t commandsCount = ChunkCulling::cullChunks(
+			chunkCullingMetas, Settings::MAX_RENDERED_CHUNKS_COUNT, visibleSlots,
+			frustumPlanes, camera.position,
+			drawData.commands, drawData.positionIndexes, drawData.positions, positionsCount
+		);
+		drawCommandsCount += commandsCount;
+		if (commandsCount > 0)
+		{
+			bindFrameDrawData(drawData, commandsCount, positionsCount);
+		}
+		indirectOffset = drawData.commandsOffset;
+		return commandsCount;
+	}
+
+	uploadCullingMetas();
+
+	// counters of this buffer were written two frames ago, so reading them rarely waits for GPU
+	const SSBO& countersSSBO = cullingCountersSSBOs[cullingFrame++ & 1];
+	unsigned int counters[2] = { 0, 0 };
+	if (cullingFrame > 2)
+	{
+		countersSSBO.getData((char*)counters, sizeof(counters));
+	}
+	drawCommandsCount += counters[0];
+	counters[0] = 0;
+	counters[1] = 0;
+	countersSSBO.setData((const char*)counters, sizeof(counters));
+
+	Shader* program = GraphicController::chunkCullingProgram;
+	program->bind();
+	program->setUniformFloat4Array("frustumPlanes", &frustumPlanes[0].x, 6);
+	program->setUniformFloat3("camPos", camera.position.x, camera.position.y, camera.position.z);
+	program->setUniformUInt("chunksCount", (unsigned int)Settings::MAX_RENDERED_CHUNKS_COUNT);
+	program->setUniformUInt("chunkSize", (unsigned int)Settings::CHUNK_SIZE);
+
+	size_t visibleSlotsSize = visibleSlotsWordsCount * sizeof(unsigned int);
+	size_t visibleSlotsOffset;
+	char* visibleSlotsData = frameStreamBuffer.allocate(visibleSlotsSize, visibleSlotsOffset);
+	if (!visibleSlotsData)
+	{
+		std::cerr << "Frame stream buffer is full" << std::endl;
+		return 0;
+	}
+	memcpy(visibleSlotsData, visibleSlots, visibleSlotsSize);
+
+	chunkPositionSSBO.bindBase(0);
+	chunkPositionIndexSSBO.bindBase(1);
+	chunkCullingMetaSSBO.bindBase(3);
+	indirectBuffer.bindBase(4);
+	countersSSBO.bindBase(5);
+	frameStreamBuffer.bindRange(6, visibleSlotsOffset, visibleSlotsSize);
+	glDispatchCompute((GLuint)((Settings::MAX_RENDERED_CHUNKS_COUNT + 63) / 64), 1, 1);
+	glMemoryBarrier(GL_COMMAND_BARRIER_BIT | GL_SHADER_STORAGE_BARRIER_BIT | GL_BUFFER_UPDATE_BARRIER_BIT);
+
+	indirectBuffer.bind();
+	countersSSBO.bindAsParameterBuffer();
+	return Settings::MAX_CHUNK_DRAW_COMMANDS_COUNT;
+}
+
+void WorldRenderer::findVisibleChunks(const Camera& camera)
+{
+	visibleChunks.clear();
+	visibilityFrame++;
+
+	Chunk* cameraChunk = nullptr;
+	if (Settings::DynamicSettings::occlusionCulling)
+	{
+		glm::ivec3 chunkPos = glm::floor(camera.position / (float)Settings::CHUNK_SIZE);
+		cameraChunk = Chunk::getChunkAt(chunkPos.x, chunkPos.y, chunkPos.z);
+	}
+
+	// search needs loaded chunk to start from, otherwise only frustum and side culling are left
+	occlusionCulled = cameraChunk && cameraChunk->state == Chunk::State::Loaded;
+	if (occlusionCulled)
+	{
+		glm::vec4 frustumPlanes[6];
+		camera.getFrustumPlanes(frustumPlanes);
+		ChunkVisibility::findVisibleChunks(cameraChunk, frustumPlanes, visibilityFrame, visibleChunks);
+
+		memset(visibleSlots, 0, visibleSlotsWordsCount * sizeof(unsigned int));
+		for (const Chunk* chunk : visibleChunks)
+		{
+			visibleSlots[chunk->drawSlot >> 5] |= 1u << (chunk->drawSlot & 31);
+		}
+	}
+	else
+	{
+		memset(visibleSlots, 0xFF, visibleSlotsWordsCount * sizeof(unsigned int));
+	}
+}
+
+void WorldRenderer::getRenderChunks(std::vector<ChunkDistance>& renderChunks, const Camera& camera) const
+{
+	Box chunkShape(glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(Settings::HALF_CHUNK_SIZE));
+	renderChunks.reserve(Settings::MAX_RENDERED_CHUNKS_COUNT >> 2);
+	for (Chunk* chunk : Chunk::chunkMap)
+	{
+		if (!chunk->hasAnyFaces || (occlusionCulled && chunk->visibilityFrame != visibilityFrame))
+		{
+			continue;
+		}
+
+		chunkShape.center.x = (chunk->X + 0.5f) * Settings::CHUNK_SIZE;
+		chunkShape.center.y = (chunk->Y + 0.5f) * Settings::CHUNK_SIZE;
+		chunkShape.center.z = (chunk->Z + 0.5f) * Settings::CHUNK_SIZE;
+		if (!camera.isOnFrustum(chunkShape))
+		{
+			continue;
+		}
+		auto dpos = chunkShape.center - camera.position;
+		float distance = glm::dot(dpos, dpos);
+		renderChunks.emplace_back(chunk, distance);
+		ChunkLifecycle::record(chunk->lifecycle, ChunkLifecycle::Stage::Drawn);
+	}
+}
+
+void WorldRenderer::getDrawCommands(const std::vector<ChunkDistance>& renderChunks, const Camera& camera, const FrameDrawData& drawData, size_t& commandsCount, size_t& positionsCount, bool transparent) const
+{
+	commandsCount = 0;
+	positionsCount = 0;
+
+	size_t normalOffset = transparent ? 6 : 0;
+	for (const ChunkDistance& pair : renderChunks)
+	{
+		const Chunk* chunk = pair.chunk;
+		float X = chunk->X * Settings::CHUNK_SIZE;
+		float Y = chunk->Y * Settings::CHUNK_SIZE;
+		float Z = chunk->Z * Settings::CHUNK_SIZE;
+
+		const DrawCommand& command = chunk->drawCommand;
+		bool anyFace = false;
+		for (size_t normalID = 0; normalID < 6; normalID++)
+		{
+			GLuint facesCount = command.facesCount[normalID + normalOffset];
+			if (facesCount > 0 && chunk->canSideBeSeen(camera.position, normalID))
+			{
+				size_t index = commandsCount++;
+				drawData.positionIndexes[index] = positionsCount;
+				anyFace = true;
+
+				DrawArraysIndirectCommand& indirectCommand = drawData.commands[index];
+				indirectCommand.count = 4;
+				indirectCommand.first = 0;
+				indirectCommand.instancesCount = facesCount;
+				indirectCommand.baseInstance = command.getGroupOffset(normalID + normalOffset);
+			}
+		}
+		if (anyFace)
+		{
+			drawData.positions[positionsCount] = { X, Y, Z };
+			positionsCount++;
+		}
+	}
+}
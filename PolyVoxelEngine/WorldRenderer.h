@@ -0,0 +1,99 @@
+#pragma once
+#include <vector>
+#include "World.h"
+#include "ChunkMeshConsumer.h"
+#include "Camera.h"
+#include "TextureArray.h"
+
+#include "SSBO.h"
+#include "StreamBuffer.h"
+#include "IBO.h"
+#include "FaceInstancesVBO.h"
+#include "VBO.h"
+#include "VAO.h"
+
+#include "ChunkCulling.h"
+#include "RangeAllocator.h"
+
+// GL side of World, uploads meshes World builds and draws loaded chunks
+// registers itself as mesh consumer of world, so it must be created before first world update and destroyed before world
+class WorldRenderer : public ChunkMeshConsumer
+{
+	struct ChunkDistance
+	{
+		Chunk* chunk = nullptr;
+		float distance = 0.0f;
+
+		ChunkDistance(Chunk* chunk, float distance);
+	};
+
+	// draw pass data in frameStreamBuffer, chunk.vert reads positions through indexes of draw commands
+	struct FrameDrawData
+	{
+		DrawArraysIndirectCommand* commands = nullptr;
+		unsigned int* positionIndexes = nullptr;
+		glm::vec3* positions = nullptr;
+		size_t commandsOffset = 0;
+		size_t positionIndexesOffset = 0;
+		size_t positionsOffset = 0;
+	};
+
+	World& world;
+
+	VAO quadInstanceVAO;
+	VBO quadInstanceVBO;
+	IndirectBuffer indirectBuffer;
+	SSBO chunkPositionSSBO;
+	SSBO chunkPositionIndexSSBO;
+
+	StreamBuffer frameStreamBuffer; // draw data written by CPU every frame
+	StreamBuffer meshStagingBuffer; // meshing workers write faces here, main thread copies them to faceInstancesVBO
+
+	// ranges of faceInstancesVBO, each mesh takes exactly its faces count
+	FaceInstancesVBO* faceInstancesVBO = nullptr;
+	RangeAllocator faceInstancesAllocator;
+
+	// culling data of every draw slot, resident on GPU, only changed slots are uploaded
+	SSBO chunkCullingMetaSSBO;
+	SSBO cullingCountersSSBOs[2]; // draw count and positions count, frames alternate, so stats read is two frames old
+	ChunkCullingMeta* chunkCullingMetas = nullptr;
+	size_t dirtyCullingMetasBegin = 0;
+	size_t dirtyCullingMetasEnd = 0;
+	size_t cullingFrame = 0;
+
+	// cave culling result of this frame, bit per draw slot
+	unsigned int* visibleSlots = nullptr;
+	size_t visibleSlotsWordsCount = 0;
+	std::vector<Chunk*> visibleChunks;
+	unsigned int visibilityFrame = 0;
+	bool occlusionCulled = false; // false when every chunk counts as visible this frame
+
+	void getRenderChunks(std::vector<ChunkDistance>& renderChunks, const Camera& camera) const;
+	void getDrawCommands(const std::vector<ChunkDistance>& renderChunks, const Camera& camera, const FrameDrawData& drawData, size_t& commandsCount, size_t& positionsCount, bool transparent) const;
+	bool allocateFrameDrawData(FrameDrawData& drawData);
+	void bindFrameDrawData(const FrameDrawData& drawData, size_t commandsCount, size_t positionsCount) const;
+	bool allocateFaceInstances(Chunk* chunk, size_t count);
+	void compactFaceInstances(size_t capacity, const Chunk* pendingChunk); // moves meshes to new buffer one after another, pendingChunk has no range yet
+	void setCullingMeta(unsigned int slot, const Chunk* chunk); // nullptr clears slot
+	void uploadCullingMetas();
+	size_t cullSolidChunks(const Camera& camera, size_t& indirectOffset); // returns commands count, or max count when culled on GPU
+	void findVisibleChunks(const Camera& camera);
+public:
+	TextureArray blockTextures;
+	TextureArray numberTextures;
+
+	uint32_t drawCommandsCount = 0;
+
+	WorldRenderer(World& world);
+	~WorldRenderer();
+
+	void draw(const Camera& camera);
+	const RangeAllocator& getFaceInstancesAllocator() const;
+	void updateMetrics(); // sets gauges of face instances and pop-in latency
+
+	FaceInstanceData* allocateMeshFaces(size_t count, size_t& offset) override;
+	void releaseMeshFaces(size_t offset) override;
+	void freeChunkMesh(Chunk* chunk) override;
+	void applyChunkMesh(Chunk* chunk, const ChunkMesh& mesh) override;
+	void unloadChunk(Chunk* chunk) override;
+};
@@ -3,10 +3,54 @@
 #include "SoundEngine.h"
 #include "GraphicController.h"
 #include "HardwareUsageInfo.h"
+#include "Replay.h"
+#include <iostream>
+#include <string>
 
+// --replay path [--draw] [--csv path] plays flythrough trace instead of opening menu
+static bool parseReplayArguments(int argc, char** argv, ReplaySettings& settings)
+{
+	for (int i = 1; i < argc; i++)
+	{
+		std::string arg = argv[i];
+		if (arg == "--draw")
+		{
+			settings.draw = true;
+			continue;
+		}
+		if (i + 1 >= argc)
+		{
+			std::cerr << "Missing value for argument: " << arg << std::endl;
+			return false;
+		}
+		std::string value = argv[++i];
 
-int main()
+		if (arg == "--replay")
+		{
+			settings.tracePath = value;
+		}
+		else if (arg == "--csv")
+		{
+			settings.csvPath = value;
+		}
+		else
+		{
+			std::cerr << "Unknown argument: " << arg << std::endl;
+			return false;
+		}
+	}
+	return true;
+}
+
+int main(int argc, char** argv)
 {
+	ReplaySettings replaySettings;
+	if (!parseReplayArguments(argc, argv, replaySettings))
+	{
+		std::cerr << "Usage: PolyVoxelEngine [--replay path [--draw] [--csv path]]" << std::endl;
+		return 1;
+	}
+
 	{
 		HWND hwnd = GetConsoleWindow();
 		ShowWindow(hwnd, 1); // show console
@@ -69,13 +113,21 @@ int main()
 		}
 	}
 	
-	// menu
-	Menu menu;
-	menu.run();
+	int exitCode = 0;
+	if (!replaySettings.tracePath.empty())
+	{
+		exitCode = Replay::run(replaySettings);
+	}
+	else
+	{
+		// menu
+		Menu menu;
+		menu.run();
+	}
 
 	GraphicController::clean();
 	HardwareUsageInfo::destroy();
 	TextRenderer::destroy();
 	Sound::SoundEngine::clean();
-	return 0;
+	return exitCode;
 }
\ No newline at end of file
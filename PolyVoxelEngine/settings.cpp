@@ -36,6 +36,11 @@ namespace Settings
 {
 	int DynamicSettings::generateChunksPerTickStationary = 200;
 	int DynamicSettings::generateChunksPerTickMoving = 100;
+	bool DynamicSettings::binaryGreedyMeshing = true;
+	int DynamicSettings::caveNoiseLatticeStep = 4;
+	bool DynamicSettings::gpuChunkCulling = true;
+	bool DynamicSettings::occlusionCulling = true;
+	bool DynamicSettings::chunkPersistence = true;
 
 	int CHUNK_LOAD_RADIUS = 5;
 	size_t MAX_RENDERED_CHUNKS_COUNT = calcVolume(CHUNK_LOAD_RADIUS);
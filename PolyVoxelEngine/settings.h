@@ -13,16 +13,24 @@ namespace Settings
 	{
 		static int generateChunksPerTickStationary;
 		static int generateChunksPerTickMoving;
+		static bool binaryGreedyMeshing;
+		static int caveNoiseLatticeStep; // cave noise is sampled every N voxels and interpolated, 1 samples every voxel
+		static bool gpuChunkCulling; // solid chunk faces are culled by compute shader, otherwise by ChunkCulling on CPU
+		static bool occlusionCulling; // chunks hidden behind solid chunks are skipped, see ChunkVisibility
+		static bool chunkPersistence; // saved chunk changes and sky light height maps are loaded and new ones saved, replay runs on generated terrain only
 	};
 
 	// World
 	const std::string worldPath = "Worlds/Test";
 	const std::string WORLD_DATA_PATH = worldPath + "/data.bin";
+	constexpr int WORLD_TICK_RATE = 20;
+	constexpr int PLAYER_TICK_RATE = 40;
 	
 	// Chunk
 	extern int CHUNK_LOAD_RADIUS;
 	constexpr int CHUNK_SIZE = 16;
 	constexpr size_t MAX_ENTITIES_PER_CHUNK = 256;
+	constexpr int NEAR_GENERATION_RADIUS = 4; // closer chunks are generated before meshing
 
 	// Physic
 	constexpr float GRAVITY = -40.0f;
@@ -54,12 +62,17 @@ namespace Settings
 	constexpr int CHUNK_SIZE_SQUARED = CHUNK_SIZE * CHUNK_SIZE;
 	constexpr int CHUNK_SIZE_CUBED = CHUNK_SIZE_SQUARED * CHUNK_SIZE;
 	//constexpr size_t SINGLE_TYPE_FACE_INSTANCES_PER_CHUNK = (CHUNK_SIZE_CUBED / 2 * 6);
-	constexpr size_t FACE_INSTANCES_PER_CHUNK = (CHUNK_SIZE_CUBED / 2 * 6) + (CHUNK_SIZE_SQUARED / 2 * 6); // solid + additionalTransparent
+	constexpr size_t FACE_INSTANCES_PER_CHUNK = (CHUNK_SIZE_CUBED / 2 * 6) + (CHUNK_SIZE_SQUARED / 2 * 6); // solid + additionalTransparent, worst case mesh, size of meshing scratch
+	constexpr size_t INITIAL_FACE_INSTANCES_PER_CHUNK = 512; // face buffer starts at this times rendered chunks and grows when meshes need more
+	constexpr size_t MESH_STAGING_REGION_SIZE = 4 * 1024 * 1024; // bytes of meshes per frame in flight, meshes that don't fit are uploaded with glBufferSubData
 	extern size_t MAX_RENDERED_CHUNKS_COUNT;
 	extern size_t MAX_CHUNK_DRAW_COMMANDS_COUNT;
 
 	const std::string chunkSavesPath = worldPath + "/Chunks/";
 	const std::string skyLightMaxHeightMapSavesPath = worldPath + "/SLMH/";
+	const std::string PROFILER_TRACE_PATH = "ProfilerTrace.json"; // written on key T, open in chrome://tracing or ui.perfetto.dev
+	const std::string METRICS_PATH = "Metrics.csv"; // recorded while toggled by key K, .jsonl extension writes json lines
+	const std::string FLYTHROUGH_TRACE_PATH = "Flythrough.trace"; // recorded while toggled by key R, played by --replay
 
 	const float MAX_RENDER_DISTANCE = float((CHUNK_LOAD_RADIUS - 1) * CHUNK_SIZE);
 	const float fogDensity = calculateFogDensity(MAX_RENDER_DISTANCE, fogGradient);